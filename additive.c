@@ -0,0 +1,240 @@
+#include "additive.h"
+#include "diag.h"
+#include "irq.h"
+#include "msp.h"
+#include "synth.h"
+#include "tablecache.h"
+
+/* Additive.c: harmonic synthesis
+ *
+ * The output is the sum of the first additive_count() harmonics, each with
+ * its own amplitude and phase. The host link sets each harmonic
+ * (HOST_HARMONIC) and the keypad how many are summed. The renderer plays a
+ * precomputed single cycle table so the per sample cost does not depend on
+ * the number of harmonics.
+ *
+ * When a harmonic changes, the table is rebuilt in the background by the
+ * DEFER_ADDITIVE job. Each run of the job adds one harmonic (one row of the
+ * inverse DFT) into an accumulator. This lets the renderer job get in
+ * between harmonics. Once all harmonics are summed, the result is scaled to
+ * full range into a table from tablecache.c. The renderer swaps the new
+ * table in at the next cycle boundary, so a change never tears a cycle.
+ *
+ * Finished tables stay in the cache, and settings that were used recently
+ * switch straight to their table without a build. diag counts the cache hits
+ * and misses and the cycles from a change of settings until its table is
+ * ready and until it is played.
+ */
+
+static const int16_t* playing;           // table played by the renderer
+static const int16_t* next_table = 0;    // swapped in at the cycle boundary
+static int16_t* building = 0;            // cache entry being built
+static table_key build_key;              // settings of the build
+
+static int32_t accumulator[ADDITIVE_TABLE_SIZE];
+static volatile int rebuild = 0;  // settings changed since the build started
+static int next_harmonic = 0;     // next harmonic to add, 0 when idle
+static volatile uint32_t change_start;  // DWT->CYCCNT at the last change
+
+static uint8_t amplitude[ADDITIVE_HARMONICS];  // percent
+static uint16_t phase_deg[ADDITIVE_HARMONICS];
+static volatile int count = 1;  // harmonics that are summed
+
+static void additive_step(void);
+
+/* additive_init:
+load a sawtooth like 1/n harmonic series, play only the fundamental and
+build the first table
+*/
+void additive_init(void)
+{
+  int i;
+
+  for (i = 0; i < ADDITIVE_HARMONICS; i++) {
+    amplitude[i] = 100 / (i + 1);
+    phase_deg[i] = 0;
+  }
+  count = 1;
+  table_cache_init();
+  playing = 0;
+  next_table = 0;
+  irq_set_deferred(DEFER_ADDITIVE, additive_step);
+
+  // build the first table in place before the renderer starts
+  change_start = DWT->CYCCNT;
+  rebuild = 1;
+  do {
+    additive_step();
+  } while (next_harmonic);
+  additive_cycle_boundary();
+}
+
+// request the table for the new settings in the background, a table still
+// waiting for the cycle boundary is for the old ones and is dropped
+static void request_rebuild(void)
+{
+  next_table = 0;
+  change_start = DWT->CYCCNT;
+  rebuild = 1;
+  irq_defer(DEFER_ADDITIVE);
+}
+
+/* additive_set_harmonic
+set the amplitude (percent of the others' scale) and phase of harmonic
+1 - ADDITIVE_HARMONICS
+*/
+void additive_set_harmonic(int harmonic, uint16_t amplitude_pct,
+                           uint16_t phase)
+{
+  uint32_t primask;
+
+  if (harmonic < 1 || harmonic > ADDITIVE_HARMONICS) {
+    return;
+  }
+  if (amplitude_pct > 100) {
+    amplitude_pct = 100;
+  }
+  // the job must not pick up half of a change
+  primask = __get_PRIMASK();
+  __disable_irq();
+  amplitude[harmonic - 1] = amplitude_pct;
+  phase_deg[harmonic - 1] = phase % 360;
+  request_rebuild();
+  __set_PRIMASK(primask);
+}
+
+// set how many harmonics are summed, 1 - ADDITIVE_HARMONICS
+void additive_set_count(int harmonics)
+{
+  if (harmonics < 1) {
+    harmonics = 1;
+  }
+  if (harmonics > ADDITIVE_HARMONICS) {
+    harmonics = ADDITIVE_HARMONICS;
+  }
+  if (harmonics != count) {
+    count = harmonics;
+    request_rebuild();
+  }
+}
+
+int additive_count(void)
+{
+  return count;
+}
+
+// returns the single cycle table the renderer plays, Q15
+const int16_t* additive_table(void)
+{
+  return playing;
+}
+
+/* additive_cycle_boundary
+called by the renderer when the phase accumulator wraps. Swaps in the
+table for the latest settings once it is ready.
+*/
+void additive_cycle_boundary(void)
+{
+  if (next_table) {
+    playing = next_table;
+    next_table = 0;
+    diag.table_switch_cycles = DWT->CYCCNT - change_start;
+  }
+}
+
+// hand a finished table to the renderer
+static void table_ready(const int16_t* table)
+{
+  next_table = (table == playing) ? 0 : table;
+  diag.table_ready_cycles = DWT->CYCCNT - change_start;
+}
+
+// snapshot the settings a build works from
+static void make_key(table_key* key)
+{
+  int i;
+
+  key->count = count;
+  for (i = 0; i < ADDITIVE_HARMONICS; i++) {
+    key->amplitude_pct[i] = i < count ? amplitude[i] : 0;
+    key->phase_deg[i] = i < count ? phase_deg[i] : 0;
+  }
+}
+
+// scale the accumulator to full range into the table being built
+static void finish_table(void)
+{
+  int32_t peak = 1;
+  int32_t value;
+  int i;
+
+  for (i = 0; i < ADDITIVE_TABLE_SIZE; i++) {
+    value = accumulator[i] < 0 ? -accumulator[i] : accumulator[i];
+    if (value > peak) {
+      peak = value;
+    }
+  }
+  for (i = 0; i < ADDITIVE_TABLE_SIZE; i++) {
+    building[i] = (int16_t)(((int64_t)accumulator[i] * SINE_MAX) / peak);
+  }
+  table_cache_commit(building, &build_key);
+}
+
+/* additive_step
+run one step of the table build. A step either starts a new build, or
+finds the table in the cache, or adds one harmonic. The job defers itself
+until the build is finished.
+*/
+static void additive_step(void)
+{
+  const int16_t* cached;
+  uint32_t step, phase;
+  int32_t amp;
+  int i;
+
+  if (rebuild) {
+    // (re)start; a table waiting for the cycle boundary is dropped, it is
+    // for older settings
+    rebuild = 0;
+    next_table = 0;
+    make_key(&build_key);
+    cached = table_cache_find(&build_key);
+    if (cached) {
+      diag.table_hits++;
+      next_harmonic = 0;
+      table_ready(cached);
+      return;
+    }
+    diag.table_misses++;
+    building = table_cache_claim(playing);
+    next_harmonic = 1;
+    for (i = 0; i < ADDITIVE_TABLE_SIZE; i++) {
+      accumulator[i] = 0;
+    }
+  }
+  if (!next_harmonic) {
+    return;
+  }
+
+  // add sin(h * x + offset) scaled by its amplitude for every table point
+  amp = build_key.amplitude_pct[next_harmonic - 1];
+  step = (uint32_t)next_harmonic << (32 - ADDITIVE_TABLE_BITS);
+  phase = (uint32_t)build_key.phase_deg[next_harmonic - 1] *
+          (0xFFFFFFFFUL / 360);
+  if (amp) {
+    for (i = 0; i < ADDITIVE_TABLE_SIZE; i++) {
+      accumulator[i] += synth_sine(phase, SINE_16BIT) * amp;
+      phase += step;
+    }
+  }
+
+  if (next_harmonic < build_key.count) {
+    next_harmonic++;
+    irq_defer(DEFER_ADDITIVE);
+  }
+  else {
+    finish_table();
+    next_harmonic = 0;
+    table_ready(building);
+  }
+}
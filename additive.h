@@ -0,0 +1,20 @@
+#ifndef ADDITIVE_H
+#define ADDITIVE_H
+
+#include <stdint.h>
+
+// highest harmonic that can be set
+#define ADDITIVE_HARMONICS 16
+// points per single cycle table, must be a power of 2
+#define ADDITIVE_TABLE_SIZE 256
+#define ADDITIVE_TABLE_BITS 8
+
+void additive_init(void);
+void additive_set_harmonic(int harmonic, uint16_t amplitude_pct,
+                           uint16_t phase_deg);
+void additive_set_count(int count);
+int additive_count(void);
+const int16_t* additive_table(void);
+void additive_cycle_boundary(void);
+
+#endif
@@ -0,0 +1,318 @@
+#include "analysis.h"
+#include <math.h>
+#include <string.h>
+
+/* Analysis.c: measurements on a block of captured samples
+ *
+ * Plain C without any device headers, so the same code can be built on a
+ * host and fed with a capture block.
+ *
+ * The frequency comes from the rising crossings of the mid level. A
+ * crossing only counts after the signal dropped clearly below the mid level,
+ * so noise and ripple near it do not add cycles, and each crossing is placed
+ * between two samples by linear interpolation.
+ *
+ * THD is estimated with one Goertzel filter per harmonic of the measured
+ * frequency over a Hann windowed block. The harmonics rarely fall on a bin
+ * centre, which is what the window is for, but the result is still only
+ * good to about a percent.
+ *
+ * For the SNR a sine is least squares fitted to the block, first with the
+ * frequency as a parameter as in IEEE 1057, as the crossings are not
+ * nearly exact enough to cancel the fundamental. Then the fundamental and
+ * the same harmonics are fitted at that frequency, and whatever power the
+ * fit leaves over is noise. Blocks longer than ANALYSIS_MAX_SAMPLES are
+ * cut to it for this.
+ */
+
+#define PI 3.14159265f
+// offset, cos and sin of the fundamental and harmonics, and the frequency
+#define FIT_TERMS (2 + 2 * (ANALYSIS_HARMONICS + 1))
+// Gauss-Newton steps on the frequency before the SNR fit
+#define FIT_ITERATIONS 3
+
+/* crossing_frequency
+find the rising mid level crossings. Returns the frequency in cycles per
+sample, or 0 with fewer than two crossings, and the position of the first
+and last crossing.
+*/
+static float crossing_frequency(const uint16_t* samples, int count, int low,
+                                int high, float* first_out, float* last_out)
+{
+  int mid = (low + high) / 2;
+  int hysteresis = (high - low) / 8;
+  int armed = 0;
+  int crossings = 0;
+  float first = 0, last = 0, position;
+  int i;
+
+  for (i = 1; i < count; i++) {
+    if (samples[i] < mid - hysteresis) {
+      armed = 1;
+    }
+    else if (armed && samples[i] >= mid) {
+      // samples[i - 1] is still below mid, or the crossing would be earlier
+      position = i - 1 + (float)(mid - samples[i - 1]) /
+                             (samples[i] - samples[i - 1]);
+      if (crossings == 0) {
+        first = position;
+      }
+      last = position;
+      crossings++;
+      armed = 0;
+    }
+  }
+  if (crossings < 2) {
+    return 0;
+  }
+  *first_out = first;
+  *last_out = last;
+  return (crossings - 1) / (last - first);
+}
+
+/* solve
+solve the n x n normal equations m x = v by elimination with partial
+pivoting, x is left in v. Returns 0 if they are singular.
+*/
+static int solve(float m[][FIT_TERMS], float* v, int n)
+{
+  float t, f;
+  int i, j, k, pivot;
+
+  for (i = 0; i < n; i++) {
+    pivot = i;
+    for (j = i + 1; j < n; j++) {
+      if (fabsf(m[j][i]) > fabsf(m[pivot][i])) {
+        pivot = j;
+      }
+    }
+    if (m[pivot][i] == 0) {
+      return 0;
+    }
+    for (k = 0; k < n; k++) {
+      t = m[i][k];
+      m[i][k] = m[pivot][k];
+      m[pivot][k] = t;
+    }
+    t = v[i];
+    v[i] = v[pivot];
+    v[pivot] = t;
+    for (j = i + 1; j < n; j++) {
+      f = m[j][i] / m[i][i];
+      for (k = i; k < n; k++) {
+        m[j][k] -= f * m[i][k];
+      }
+      v[j] -= f * v[i];
+    }
+  }
+  for (i = n - 1; i >= 0; i--) {
+    for (k = i + 1; k < n; k++) {
+      v[i] -= m[i][k] * v[k];
+    }
+    v[i] /= m[i][i];
+  }
+  return 1;
+}
+
+/* fit_terms
+fill row with the fit terms for sample i: the offset, then the cos and sin
+of the fundamental and harmonics - 1 harmonics at frequency cycles per
+sample. With slope, the coefficients of a previous fit, the last term is
+how that fit changes with the frequency.
+*/
+static int fit_terms(float* row, int i, int count, float frequency,
+                     int harmonics, const float* slope)
+{
+  float cycles, angle, change = 0;
+  int h, n = 0;
+
+  row[n++] = 1;
+  for (h = 1; h <= harmonics; h++) {
+    // the phase is taken modulo a cycle before it is made an angle, a float
+    // angle of hundreds of radians is too coarse
+    cycles = frequency * h * i;
+    angle = 2 * PI * (cycles - floorf(cycles));
+    row[n++] = cosf(angle);
+    row[n++] = sinf(angle);
+    if (slope) {
+      // d/df of a cos + b sin, without the 2 pi i
+      change += h * (slope[n - 1] * row[n - 2] - slope[n - 2] * row[n - 1]);
+    }
+  }
+  if (slope) {
+    // centred and scaled by the length so the term is no bigger than the
+    // others
+    row[n++] = 2 * PI * (i - count / 2) / count * change;
+  }
+  return n;
+}
+
+/* fit
+least squares fit of the fit_terms() to the mean free samples. The
+coefficients are returned in coeff, and the residual sum of squares.
+*/
+static float fit(const float* x, int count, float frequency, int harmonics,
+                 const float* slope, float* coeff, int* ok)
+{
+  float m[FIT_TERMS][FIT_TERMS], row[FIT_TERMS];
+  float residual = 0, r;
+  int i, j, k, n = 0;
+
+  memset(m, 0, sizeof(m));
+  memset(coeff, 0, FIT_TERMS * sizeof(float));
+  for (i = 0; i < count; i++) {
+    n = fit_terms(row, i, count, frequency, harmonics, slope);
+    for (j = 0; j < n; j++) {
+      coeff[j] += row[j] * x[i];
+      for (k = 0; k <= j; k++) {
+        m[j][k] += row[j] * row[k];
+      }
+    }
+  }
+  for (j = 0; j < n; j++) {
+    for (k = j + 1; k < n; k++) {
+      m[j][k] = m[k][j];
+    }
+  }
+  *ok = solve(m, coeff, n);
+  if (!*ok) {
+    return 0;
+  }
+  for (i = 0; i < count; i++) {
+    fit_terms(row, i, count, frequency, harmonics, slope);
+    r = x[i];
+    for (j = 0; j < n; j++) {
+      r -= coeff[j] * row[j];
+    }
+    residual += r * r;
+  }
+  return residual;
+}
+
+/* snr
+returns the SNR of the samples at about frequency cycles per sample, in
+tenths of dB, with used - 1 harmonics left out of the noise
+*/
+static uint32_t snr(const uint16_t* samples, int count, float mean,
+                    float frequency, int used)
+{
+  static float x[ANALYSIS_MAX_SAMPLES];
+  float coeff[FIT_TERMS], slope[FIT_TERMS];
+  float signal, noise;
+  int i, ok;
+
+  if (count > ANALYSIS_MAX_SAMPLES) {
+    count = ANALYSIS_MAX_SAMPLES;
+  }
+  for (i = 0; i < count; i++) {
+    x[i] = samples[i] - mean;
+  }
+
+  // the crossings are not close enough for the fit to cancel the
+  // fundamental, refine the frequency first. Each step fits at the last
+  // frequency, then fits the change of that fit with the frequency.
+  for (i = 0; i < FIT_ITERATIONS; i++) {
+    fit(x, count, frequency, used, 0, slope, &ok);
+    if (!ok) {
+      return 0;
+    }
+    fit(x, count, frequency, used, slope, coeff, &ok);
+    if (!ok) {
+      return 0;
+    }
+    frequency += coeff[2 * used + 1] / count;
+  }
+
+  noise = fit(x, count, frequency, used, 0, coeff, &ok);
+  signal = (coeff[1] * coeff[1] + coeff[2] * coeff[2]) / 2 * count;
+  if (!ok || noise >= signal) {
+    return 0;
+  }
+  if (noise * 1e12f <= signal) {
+    return ANALYSIS_SNR_MAX_DDB;
+  }
+  return (uint32_t)(100 * log10f(signal / noise) + 0.5f);
+}
+
+/* analyse
+measure a block of count ADC samples of the given resolution, taken at
+sample_rate, where full scale is full_scale_mv.
+*/
+void analyse(const uint16_t* samples, int count, uint32_t sample_rate,
+             uint32_t full_scale_mv, int bits, analysis_result* result)
+{
+  float coeff[ANALYSIS_HARMONICS + 1];
+  float s1[ANALYSIS_HARMONICS + 1], s2[ANALYSIS_HARMONICS + 1];
+  float frequency, mean, x, s, power, fundamental, harmonics;
+  float first = 0, last = 0;
+  uint32_t sum = 0;
+  int low = 0xFFFF, high = 0;
+  int start, end;
+  int i, h, used;
+
+  for (i = 0; i < count; i++) {
+    if (samples[i] < low) {
+      low = samples[i];
+    }
+    if (samples[i] > high) {
+      high = samples[i];
+    }
+  }
+  result->amplitude_mv = ((high - low) * full_scale_mv >> bits) / 2;
+
+  // the mean is taken over whole cycles when there are any, a partial cycle
+  // would pull it towards one side
+  frequency = crossing_frequency(samples, count, low, high, &first, &last);
+  start = 0;
+  end = count;
+  if (frequency != 0) {
+    start = (int)first;
+    end = (int)last;
+  }
+  for (i = start; i < end; i++) {
+    sum += samples[i];
+  }
+  mean = (float)sum / (end - start);
+  result->offset_mv = (int32_t)(mean * full_scale_mv) >> bits;
+  result->frequency_dhz = (uint32_t)(frequency * sample_rate * 10 + 0.5f);
+  result->thd_permille = 0;
+  result->snr_ddb = 0;
+  if (frequency == 0) {
+    return;
+  }
+
+  // harmonics at or above Nyquist are left out
+  used = 0;
+  for (h = 0; h <= ANALYSIS_HARMONICS && frequency * (h + 1) < 0.5f; h++) {
+    coeff[h] = 2 * cosf(2 * PI * frequency * (h + 1));
+    s1[h] = 0;
+    s2[h] = 0;
+    used++;
+  }
+
+  for (i = 0; i < count; i++) {
+    x = (samples[i] - mean) * (0.5f - 0.5f * cosf(2 * PI * i / (count - 1)));
+    for (h = 0; h < used; h++) {
+      s = x + coeff[h] * s1[h] - s2[h];
+      s2[h] = s1[h];
+      s1[h] = s;
+    }
+  }
+
+  fundamental = 0;
+  harmonics = 0;
+  for (h = 0; h < used; h++) {
+    power = s1[h] * s1[h] + s2[h] * s2[h] - coeff[h] * s1[h] * s2[h];
+    if (h == 0) {
+      fundamental = power;
+    }
+    else {
+      harmonics += power;
+    }
+  }
+  if (fundamental > 0) {
+    result->thd_permille = (uint32_t)(1000 * sqrtf(harmonics / fundamental) +
+                                      0.5f);
+  }
+  result->snr_ddb = snr(samples, count, mean, frequency, used);
+}
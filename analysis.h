@@ -0,0 +1,24 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <stdint.h>
+
+// harmonics above the fundamental included in the THD estimate
+#define ANALYSIS_HARMONICS 4
+// samples used for the SNR, the self-test capture length
+#define ANALYSIS_MAX_SAMPLES 1024
+// reported when no noise is left at all
+#define ANALYSIS_SNR_MAX_DDB 1200
+
+typedef struct analysis_result {
+  int32_t offset_mv;        // mean level
+  int32_t amplitude_mv;     // half the peak to peak swing
+  uint32_t frequency_dhz;   // tenths of Hz, 0 if less than a cycle was seen
+  uint32_t thd_permille;    // harmonics 2 - 5 against the fundamental
+  uint32_t snr_ddb;  // tenths of dB, fundamental against all but harmonics
+} analysis_result;
+
+void analyse(const uint16_t* samples, int count, uint32_t sample_rate,
+             uint32_t full_scale_mv, int bits, analysis_result* result);
+
+#endif
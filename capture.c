@@ -0,0 +1,57 @@
+#include "capture.h"
+#include "ramfunc.h"
+
+/* Capture.c: DAC output capture
+ *
+ * Records the DAC words sent by the sample ISR into a RAM block, so the
+ * analog output can be checked without a scope. A test runner attached over
+ * the debug link waits for capture.sequence to change and then dumps the
+ * capture symbol. The block is self describing (magic, sample rate and word
+ * count), so it can be turned into a WAV file on the host. The GAIN and SHDN
+ * bits are kept in each word so DAC setup errors show up in the dump.
+ *
+ * A capture is one shot: capture_arm() starts it and it stops by itself once
+ * CAPTURE_SIZE words are recorded.
+ */
+
+capture_block capture;
+
+static volatile int armed = 0;
+
+void capture_init(uint32_t sample_rate)
+{
+  capture.magic = CAPTURE_MAGIC;
+  capture.sample_rate = sample_rate;
+  capture.count = 0;
+  capture.sequence = 0;
+  armed = 0;
+}
+
+// change the sample rate recorded in the block
+void capture_set_rate(uint32_t sample_rate)
+{
+  capture.sample_rate = sample_rate;
+}
+
+// start a new capture with the next sample
+void capture_arm(void)
+{
+  armed = 0;
+  capture.count = 0;
+  armed = 1;
+}
+
+/* capture_sample
+record one DAC word if a capture is running. Called by the sample ISR.
+*/
+RAMFUNC void capture_sample(uint16_t word)
+{
+  if (!armed) {
+    return;
+  }
+  capture.words[capture.count++] = word;
+  if (capture.count == CAPTURE_SIZE) {
+    armed = 0;
+    capture.sequence++;
+  }
+}
@@ -0,0 +1,26 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+// DAC words kept per capture
+#define CAPTURE_SIZE 2048
+// marks a valid capture block in memory dumps
+#define CAPTURE_MAGIC 0x43415054UL  // "CAPT"
+
+typedef struct capture_block {
+  uint32_t magic;
+  uint32_t sample_rate;  // Hz, to convert the dump to audio
+  volatile uint32_t count;     // words captured so far
+  volatile uint32_t sequence;  // incremented each time a capture completes
+  uint16_t words[CAPTURE_SIZE];  // raw DAC SPI words, control bits included
+} capture_block;
+
+extern capture_block capture;
+
+void capture_init(uint32_t sample_rate);
+void capture_set_rate(uint32_t sample_rate);
+void capture_arm(void);
+void capture_sample(uint16_t word);
+
+#endif
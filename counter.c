@@ -0,0 +1,206 @@
+#include "counter.h"
+#include "dco.h"
+#include "irq.h"
+#include "msp.h"
+#include "sched.h"
+
+/* Counter.c: reciprocal frequency counter
+ *
+ * TIMER_A1 runs continuously from SMCLK and CCR1 captures the time of every
+ * rising edge on COUNTER_PIN. The overflow interrupt extends the 16 bit
+ * timer to 32 bits. A reading counts the edges of a gate and the time from
+ * the first to the last of them, and works out frequency = edges / time. It
+ * does not count a fixed time like a plain counter, so the resolution is one
+ * SMCLK tick of the whole gate at any input frequency, about 0.04 ppm for a
+ * 1 s gate, and even a 1 Hz input reads to the mHz.
+ *
+ * Each gate starts at the last edge of the one before, so no edge is lost
+ * between readings. A gate lasts COUNTER_GATE_MS, or for inputs slower
+ * than that until the first edge after it. SMCLK is the DCO, and the time
+ * is corrected by the error dco.c measured.
+ *
+ * Every edge costs an interrupt. Above about 100 kHz capturing is stopped
+ * for the rest of the gate, and the reading is COUNTER_OVERRANGE. That is
+ * the top of the range: Timer_A can not divide a capture input, and
+ * counting the edges in a gate needs them on TA1CLK (P7.2) as the timer
+ * clock, not on this pin. The LCD shows >100kHz and HOST_MEASURE answers
+ * "out of range".
+ */
+
+#define IV_CAPTURE 0x02   // TA1IV: CCR1 capture
+#define IV_OVERFLOW 0x0E  // TA1IV: timer overflow
+
+static volatile int running = 0;
+static volatile uint32_t overflows;  // upper 16 bits of the time
+static volatile int started = 0;     // first_edge is valid
+static volatile uint32_t first_edge;
+static volatile uint32_t last_edge;
+static volatile uint32_t edges;  // edges after first_edge
+static volatile int overrange = 0;
+static uint32_t gate_start;  // ms
+static counter_result latest;
+
+/* counter_start
+start measuring the signal on COUNTER_PIN. Needs SMCLK at 24 MHz.
+*/
+void counter_start(void)
+{
+  COUNTER_PORT->DIR &= ~COUNTER_PIN;
+  COUNTER_PORT->SEL0 |= COUNTER_PIN;  // TA1.1 capture input
+  COUNTER_PORT->SEL1 &= ~COUNTER_PIN;
+
+  overflows = 0;
+  started = 0;
+  edges = 0;
+  overrange = 0;
+  latest.status = COUNTER_NO_SIGNAL;
+  latest.frequency_mhz = 0;
+  latest.period_ns = 0;
+  gate_start = sched_now();
+
+  TIMER_A1->CCTL[COUNTER_CCR] = TIMER_A_CCTLN_CM_1 | TIMER_A_CCTLN_CCIS_0 |
+                                TIMER_A_CCTLN_SCS | TIMER_A_CCTLN_CAP |
+                                TIMER_A_CCTLN_CCIE;
+  TIMER_A1->CTL = TIMER_A_CTL_SSEL__SMCLK | TIMER_A_CTL_MC__CONTINUOUS |
+                  TIMER_A_CTL_CLR | TIMER_A_CTL_IE;
+  irq_enable(TA1_N_IRQn, IRQ_PRIO_TIMING);
+  running = 1;
+}
+
+// stop the timer and release the input
+void counter_stop(void)
+{
+  running = 0;
+  TIMER_A1->CTL = TIMER_A_CTL_MC__STOP;
+  TIMER_A1->CCTL[COUNTER_CCR] = 0;
+  COUNTER_PORT->SEL0 &= ~COUNTER_PIN;
+}
+
+// returns 1 while the counter is measuring
+int counter_running(void)
+{
+  return running;
+}
+
+// works out the reading from edges periods that took ticks SMCLK cycles
+static void measure(uint32_t count, uint32_t ticks)
+{
+  uint64_t clock = MHZ_24 + (int64_t)MHZ_24 * dco_error_ppm() / 1000000;
+
+  latest.status = COUNTER_OK;
+  latest.frequency_mhz = (uint32_t)(count * clock * 1000 / ticks);
+  latest.period_ns = (uint32_t)((uint64_t)ticks * 1000000000 / clock / count);
+}
+
+/* counter_poll
+end the gate once it has lasted COUNTER_GATE_MS and take the reading.
+Returns 1 if there is a new reading for counter_read(). Run as a task.
+*/
+int counter_poll(void)
+{
+  uint32_t now = sched_now();
+  uint32_t primask, count, ticks;
+  int over;
+
+  if (!running || now - gate_start < COUNTER_GATE_MS) {
+    return 0;
+  }
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  count = edges;
+  ticks = last_edge - first_edge;
+  over = overrange;
+  if (over) {
+    // start again with the next edge
+    overrange = 0;
+    started = 0;
+    TIMER_A1->CCTL[COUNTER_CCR] &= ~TIMER_A_CCTLN_COV;
+    TIMER_A1->CCTL[COUNTER_CCR] |= TIMER_A_CCTLN_CCIE;
+  }
+  else if (count) {
+    // the next gate starts at the last edge of this one
+    first_edge = last_edge;
+    edges = 0;
+  }
+  else if (now - gate_start < COUNTER_TIMEOUT_MS) {
+    // a slow input, wait for the next edge
+    __set_PRIMASK(primask);
+    return 0;
+  }
+  else {
+    started = 0;
+  }
+  __set_PRIMASK(primask);
+  gate_start = now;
+
+  if (over) {
+    latest.status = COUNTER_OVERRANGE;
+  }
+  else if (count) {
+    measure(count, ticks);
+  }
+  else {
+    latest.status = COUNTER_NO_SIGNAL;
+  }
+  return 1;
+}
+
+// copies the last reading
+void counter_read(counter_result* result)
+{
+  *result = latest;
+}
+
+// returns how far the reading is above expected_hz, in ppm
+int32_t counter_error_ppm(const counter_result* result, uint32_t expected_hz)
+{
+  int64_t expected_mhz = (int64_t)expected_hz * 1000;
+
+  return (int32_t)(((int64_t)result->frequency_mhz - expected_mhz) *
+                   1000000 / expected_mhz);
+}
+
+// edge captures and timer overflows
+void TA1_N_IRQHandler(void)
+{
+  uint16_t capture;
+  uint32_t high, time;
+
+  switch (TIMER_A1->IV) {
+    case IV_CAPTURE:
+      capture = TIMER_A1->CCR[COUNTER_CCR];
+      high = overflows;
+      if ((TIMER_A1->CTL & TIMER_A_CTL_IFG) && capture < 0x8000) {
+        high++;  // the timer wrapped before the edge, its interrupt waits
+      }
+      time = (high << 16) | capture;
+
+      if (TIMER_A1->CCTL[COUNTER_CCR] & TIMER_A_CCTLN_COV) {
+        // an edge came before the last one was read, the count is wrong
+        overrange = 1;
+      }
+      else if (!started) {
+        first_edge = time;
+        edges = 0;
+        started = 1;
+      }
+      else {
+        last_edge = time;
+        edges++;
+        if (edges % COUNTER_CHECK_EDGES == 0 &&
+            time - first_edge < edges * COUNTER_MIN_TICKS) {
+          overrange = 1;
+        }
+      }
+      if (overrange) {
+        TIMER_A1->CCTL[COUNTER_CCR] &= ~TIMER_A_CCTLN_CCIE;
+      }
+      break;
+    case IV_OVERFLOW:
+      overflows++;
+      break;
+    default:
+      break;
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef COUNTER_H
+#define COUNTER_H
+
+#include <stdint.h>
+
+// signal input on P7.7, TA1 CCR1 (CCI1A)
+#define COUNTER_PORT P7
+#define COUNTER_PIN BIT7
+#define COUNTER_CCR 1
+
+// a reading is made at least this often, from all edges since the last one
+#define COUNTER_GATE_MS 1000
+// without two edges in this time there is no signal, so the lowest
+// frequency is 0.25 Hz
+#define COUNTER_TIMEOUT_MS 4000
+// edges closer than this many SMCLK ticks (above 100 kHz) would take too
+// much CPU time, capturing stops until the next gate
+#define COUNTER_MIN_TICKS 240
+// the edge rate is checked every this many edges
+#define COUNTER_CHECK_EDGES 64
+// the loopback check fails further off the generator frequency than this
+#define COUNTER_LOOPBACK_PPM 100
+
+typedef enum counter_status {
+  COUNTER_NO_SIGNAL,
+  COUNTER_OK,
+  COUNTER_OVERRANGE,  // faster than COUNTER_MIN_TICKS allows, or edges lost
+} counter_status;
+
+typedef struct counter_result {
+  counter_status status;
+  uint32_t frequency_mhz;  // mHz
+  uint32_t period_ns;      // ns
+} counter_result;
+
+void counter_start(void);
+void counter_stop(void);
+int counter_running(void);
+int counter_poll(void);
+void counter_read(counter_result* result);
+int32_t counter_error_ppm(const counter_result* result, uint32_t expected_hz);
+
+#endif
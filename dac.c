@@ -0,0 +1,71 @@
+#include "dac.h"
+#include "ramfunc.h"
+#include "trace.h"
+
+/* Dac.c: MCP4921 style 12 bit SPI DAC on eUSCI_B0
+ *
+ * Each sample is sent as one 16 bit word: the GAIN and SHDN control bits in
+ * the top nibble followed by the 12 bit level. DAC_pack() builds the word so
+ * it can be prepared ahead of time and DAC_write_word() only has to shift it
+ * out. DAC_write_word() is on the sample ISR path and runs from SRAM.
+ */
+
+void DAC_init(void)
+{
+  DAC_PORT->SEL0 |= BIT5 | BIT6 | BIT7;  // Set DAC_PORT.5, DAC_PORT.6, and
+                                         // DAC_PORT.7 as SPI pins functionality
+
+  DAC_CS_PORT->DIR |= DAC_CS_PIN;  // set as output for CS
+
+  EUSCI_B0->CTLW0 |= EUSCI_B_CTLW0_SWRST;
+  EUSCI_B0->CTLW0 = EUSCI_B_CTLW0_SWRST | EUSCI_B_CTLW0_MST |
+                    EUSCI_B_CTLW0_SYNC | EUSCI_B_CTLW0_CKPL |
+                    EUSCI_B_CTLW0_UCSSEL_2 | EUSCI_B_CTLW0_MSB;
+
+  EUSCI_B0->BRW = 0x02;  // div by 2 fBitClock = fBRCLK / UCBRx
+  EUSCI_B0->CTLW0 &= ~EUSCI_B_CTLW0_SWRST;  // Initialize USCI state machine
+}
+
+/* DAC_pack
+returns the SPI word for a 12 bit level with the gain / shutdown control bits
+set
+*/
+uint16_t DAC_pack(unsigned int level)
+{
+  return ((GAIN | SHDN) << 8) | (level & 0x0FFF);
+}
+
+RAMFUNC void DAC_write_word(uint16_t word)
+{
+  uint8_t hiByte, loByte;
+  unsigned int polls = 0;
+  loByte = 0xFF & word;  // mask just low 8 bits
+  hiByte = word >> 8;    // control bits and D11-D8
+
+  DAC_CS_PORT->OUT &= ~DAC_CS_PIN;  // set CS low
+
+  // wait for TXBUF to be empty before writing high byte
+  while (!(EUSCI_B0->IFG & EUSCI_B_IFG_TXIFG))
+    polls++;
+  EUSCI_B0->TXBUF = hiByte;
+
+  // wait for TXBUF to be empty before writing low byte
+  while (!(EUSCI_B0->IFG & EUSCI_B_IFG_TXIFG))
+    polls++;
+  EUSCI_B0->TXBUF = loByte;
+
+  // wait for RXBUF to be empty before changing CS
+  while (!(EUSCI_B0->IFG & EUSCI_B_IFG_RXIFG))
+    polls++;
+
+  DAC_CS_PORT->OUT |= DAC_CS_PIN;  // set CS high
+
+  if (polls > SPI_STALL_POLLS) {
+    trace(TRACE_SPI_STALL, 0, polls);
+  }
+}
+
+void DAC_write(unsigned int level)
+{
+  DAC_write_word(DAC_pack(level));
+}
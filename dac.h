@@ -0,0 +1,22 @@
+#include "msp.h"
+
+// DAC declarations
+#define DAC_PORT P1
+#define DAC_CS_PORT P4
+#define DAC_CS_PIN BIT4
+#define GAIN BIT5
+#define SHDN BIT4
+// TXIFG/RXIFG polls after which a DAC write is traced as an SPI stall
+#define SPI_STALL_POLLS 32
+
+// voltage constants
+#define VOLT 1241
+#define DC_BIAS 2048
+#define VOLT_MAX 4095
+#define AMPLITUDE (VOLT_MAX - DC_BIAS)
+
+// dac functions
+void DAC_init(void);
+uint16_t DAC_pack(unsigned int level);
+void DAC_write_word(uint16_t word);
+void DAC_write(unsigned int level);
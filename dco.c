@@ -1,5 +1,36 @@
 #include "dco.h"
+#include "irq.h"
 #include "msp432p401r.h"
+
+/* Dco.c: DCO setup and calibration
+ *
+ * The DCO is only accurate to a few percent, and every frequency the
+ * generator produces is derived from it. dco_calibrate_start() measures it
+ * in the background against the 32768 Hz ACLK: TIMER_A3 runs from ACLK and
+ * interrupts once per DCO_CAL_WINDOW, and the DWT cycle counter says how
+ * many MCLK (= DCO) cycles fit in the window.
+ *
+ * While the DCO is more than DCO_TRIM_PPM off, every measurement moves
+ * DCOTUNE one step towards the target. The remaining error is published by
+ * dco_error_ppm() and folded into the phase increments by the renderer. The
+ * interrupt only takes the cycle count, dco_calibrate_poll() does the rest
+ * from a scheduler task.
+ *
+ * ACLK starts out on REFO, which is itself only good to about 1 %. The LFXT
+ * crystal is started at the same time and ACLK moves over to it once it has
+ * run without a fault for a whole window.
+ */
+
+#define DCOTUNE_MAX 511  // DCOTUNE is a signed 10 bit field
+
+static int32_t target_hz = 0;
+static volatile int32_t error_ppm = 0;
+static uint32_t window_start;
+static int lfxt_in_use = 0;
+static volatile int skip_window = 0;  // the window straddled a change
+static volatile uint32_t window_cycles;  // DCO cycles in the last window
+static volatile int window_ready = 0;
+
 void set_DCO(int frequency)
 {
   CS->KEY = CS_KEY_VAL;  // Unlock CS module for register access
@@ -24,3 +55,112 @@ void set_DCO(int frequency)
   CS->CTL1 = CS_CTL1_SELA_2 | CS_CTL1_SELS_3 | CS_CTL1_SELM_3;
   CS->KEY = 0;  // Lock CS module
 }
+
+/* dco_calibrate_start
+start measuring and trimming the DCO against ACLK. freq is the frequency
+set with set_DCO(), which also clears the trim, so call this again after
+every set_DCO(). Needs the DWT cycle counter from trace_init().
+*/
+void dco_calibrate_start(int freq)
+{
+  target_hz = freq;
+  error_ppm = 0;
+
+  LFXT_PORT->SEL0 |= LFXT_PINS;  // crystal function
+  CS->KEY = CS_KEY_VAL;
+  CS->CTL2 |= CS_CTL2_LFXT_EN | CS_CTL2_LFXTDRIVE_3;
+  CS->CLRIFG = CS_CLRIFG_CLR_LFXTIFG;
+  CS->KEY = 0;
+  lfxt_in_use = 0;
+  window_ready = 0;
+  skip_window = 1;  // the first window starts at an unknown point
+
+  TIMER_A3->CCR[0] = DCO_CAL_WINDOW - 1;
+  TIMER_A3->CCTL[0] = TIMER_A_CCTLN_CCIE;
+  TIMER_A3->CTL = TIMER_A_CTL_SSEL__ACLK | TIMER_A_CTL_MC__UP |
+                  TIMER_A_CTL_CLR;
+  window_start = DWT->CYCCNT;
+  irq_enable(TA3_0_IRQn, IRQ_PRIO_TIMING);
+}
+
+// returns how far the DCO is above its frequency in ppm, after trimming
+int32_t dco_error_ppm(void)
+{
+  return error_ppm;
+}
+
+// moves ACLK to the crystal once it has run a whole window without a fault
+static void check_lfxt(void)
+{
+  CS->KEY = CS_KEY_VAL;
+  if (CS->IFG & CS_IFG_LFXTIFG) {
+    CS->CLRIFG = CS_CLRIFG_CLR_LFXTIFG;
+  }
+  else {
+    CS->CTL1 = (CS->CTL1 & ~CS_CTL1_SELA_MASK) | CS_CTL1_SELA_0;
+    lfxt_in_use = 1;
+    skip_window = 1;
+  }
+  CS->KEY = 0;
+}
+
+// step DCOTUNE by one towards the target frequency
+static void trim(int32_t ppm)
+{
+  int32_t tune = CS->CTL0 & CS_CTL0_DCOTUNE_MASK;
+
+  if (tune > DCOTUNE_MAX) {
+    tune -= 2 * (DCOTUNE_MAX + 1);  // sign extend
+  }
+  tune += (ppm > 0) ? -1 : 1;
+  if (tune > DCOTUNE_MAX || tune < -DCOTUNE_MAX) {
+    return;
+  }
+  CS->KEY = CS_KEY_VAL;
+  CS->CTL0 = (CS->CTL0 & ~CS_CTL0_DCOTUNE_MASK) |
+             ((uint32_t)tune & CS_CTL0_DCOTUNE_MASK);
+  CS->KEY = 0;
+}
+
+/* dco_calibrate_poll
+evaluate a finished measurement window: trim the DCO, update the error
+estimate and check on the crystal. Run as a task, it does nothing until
+the next window has ended.
+*/
+void dco_calibrate_poll(void)
+{
+  int64_t measured_hz;
+  int32_t ppm;
+
+  if (!window_ready) {
+    return;
+  }
+  window_ready = 0;
+  if (!lfxt_in_use) {
+    check_lfxt();
+  }
+
+  measured_hz = (int64_t)window_cycles * ACLK_HZ / DCO_CAL_WINDOW;
+  ppm = (int32_t)((measured_hz - target_hz) * 1000000 / target_hz);
+  error_ppm = ppm;
+  if (ppm > DCO_TRIM_PPM || ppm < -DCO_TRIM_PPM) {
+    trim(ppm);
+    skip_window = 1;  // the trim lands part way into the current window
+  }
+}
+
+// takes the cycle count at the end of each window
+void TA3_0_IRQHandler(void)
+{
+  uint32_t now = DWT->CYCCNT;
+
+  TIMER_A3->CCTL[0] &= ~TIMER_A_CCTLN_CCIFG;
+  if (skip_window) {
+    skip_window = 0;
+  }
+  else {
+    window_cycles = now - window_start;
+    window_ready = 1;
+  }
+  window_start = now;
+}
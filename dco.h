@@ -1,7 +1,23 @@
+#include <stdint.h>
+
 #define MHZ_1_5 1500000
 #define MHZ_3 3000000
 #define MHZ_6 6000000
 #define MHZ_12 12000000
 #define MHZ_24 24000000
 
+// reference for the DCO calibration, LFXT or REFO on ACLK
+#define ACLK_HZ 32768
+// ACLK ticks per calibration measurement, 1 s
+#define DCO_CAL_WINDOW 32768
+// the DCO is trimmed while it is further off than this, the rest of the
+// error is corrected in the phase increments
+#define DCO_TRIM_PPM 1500
+// LFXT on PJ.0 / PJ.1
+#define LFXT_PORT PJ
+#define LFXT_PINS (BIT0 | BIT1)
+
 void set_DCO(int freq);
+void dco_calibrate_start(int freq);
+int32_t dco_error_ppm(void);
+void dco_calibrate_poll(void);
@@ -0,0 +1,33 @@
+#include "diag.h"
+#include "render.h"
+
+volatile diagnostics diag;
+
+// clears all counters and restarts the low water marks
+void diag_reset(void)
+{
+  diag.underruns = 0;
+  diag.queue_fill = 0;
+  diag.queue_min_fill = SAMPLE_QUEUE_SIZE;
+  diag.isr_cycles = 0;
+  diag.isr_cycles_max = 0;
+  diag.isr_cycles_total = 0;
+  diag.isr_overruns = 0;
+  diag.render_cycles = 0;
+  diag.render_samples = 0;
+  diag.sample_latency_min = 0xFFFF;
+  diag.sample_latency_max = 0;
+  diag.table_hits = 0;
+  diag.table_misses = 0;
+  diag.table_ready_cycles = 0;
+  diag.table_switch_cycles = 0;
+  diag.stack_overflow = 0;
+}
+
+// restarts the sample ISR latency and run time extremes only
+void diag_reset_timing(void)
+{
+  diag.sample_latency_min = 0xFFFF;
+  diag.sample_latency_max = 0;
+  diag.isr_cycles_max = 0;
+}
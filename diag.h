@@ -0,0 +1,48 @@
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <stdint.h>
+
+/* Run time diagnostics. Counters are only ever incremented or overwritten by
+ * the code that owns them and can be read at any time, e.g. from the
+ * debugger's expression view.
+ */
+typedef struct diagnostics {
+  // sample queue
+  uint32_t underruns;       // samples the ISR found the queue empty
+  uint16_t queue_fill;      // samples queued when the renderer last ran
+  uint16_t queue_min_fill;  // lowest queue_fill since diag_reset()
+
+  // sample ISR run time in MCLK cycles
+  uint32_t isr_cycles;      // last sample
+  uint32_t isr_cycles_max;  // longest since diag_reset()
+  uint32_t isr_cycles_total;  // running total, for the average load
+  uint32_t isr_overruns;    // samples that ran into the next period
+
+  // renderer run time, running totals for the average cost per sample
+  uint32_t render_cycles;
+  uint32_t render_samples;
+
+  // sample timing, SMCLK ticks from the compare event to the ISR reading
+  // the timer; the spread between the two is the sample clock jitter
+  uint16_t sample_latency_min;
+  uint16_t sample_latency_max;
+
+  // additive synthesis table cache
+  uint32_t table_hits;           // settings found in the cache
+  uint32_t table_misses;         // settings that needed a table build
+  uint32_t table_ready_cycles;   // last change of settings to table ready
+  uint32_t table_switch_cycles;  // last change of settings to table played
+
+  // shared MSP stack, see stack.c
+  uint32_t stack_used;      // high water mark in bytes
+  uint32_t stack_free;      // stack that was never touched
+  uint8_t stack_overflow;   // a fault hit the stack guard
+} diagnostics;
+
+extern volatile diagnostics diag;
+
+void diag_reset(void);
+void diag_reset_timing(void);
+
+#endif
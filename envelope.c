@@ -0,0 +1,236 @@
+#include "envelope.h"
+#include <math.h>
+#include "irq.h"
+#include "msp.h"
+
+/* Envelope.c: ADSR amplitude envelope
+ *
+ * The envelope scales the output amplitude around DC_BIAS. It is advanced
+ * once every ENV_DECIMATION samples by the renderer (the control rate), so
+ * the per sample cost is the single multiply that applies the gain.
+ *
+ * Each segment is computed incrementally. Linear segments add a fixed step
+ * per tick. Exponential segments move a fixed fraction of the remaining
+ * distance towards a target set ENV_OVERSHOOT past the end of the segment,
+ * so they finish in a finite time. The fraction is chosen so that a full
+ * scale segment takes the requested time.
+ *
+ * The gate comes from envelope_gate() (key press) or from edges on the
+ * ENV_GATE_PIN input, whichever changed last.
+ */
+
+#define ENV_ONE (1L << 30)            // full gain in Q30
+#define ENV_OVERSHOOT (ENV_ONE / 8)  // exponential target past the segment end
+
+typedef enum env_stage {
+  ENV_IDLE,
+  ENV_ATTACK,
+  ENV_DECAY,
+  ENV_SUSTAIN,
+  ENV_RELEASE,
+} env_stage;
+
+static uint32_t control_rate;  // envelope ticks per second
+static env_params current;     // last settings, to redo on a rate change
+static volatile int gate = 0;   // requested gate
+static int gate_seen = 0;       // gate the envelope last reacted to
+
+// segment settings, written by envelope_set() with interrupts masked
+static env_shape shape;
+static uint32_t attack_ticks, decay_ticks, release_ticks;
+static int32_t attack_coeff, decay_coeff, release_coeff;  // Q30
+static int32_t sustain;                                   // Q30
+
+static env_stage stage = ENV_IDLE;
+static int32_t level = 0;  // current gain, Q30
+static int32_t step;       // linear change per tick in the current segment
+
+// multiplies two Q30 values
+static int32_t mul_q30(int32_t a, int32_t b)
+{
+  return (int32_t)(((int64_t)a * b) >> 30);
+}
+
+// converts a time in ms to control ticks, at least one
+static uint32_t ms_to_ticks(uint16_t ms)
+{
+  uint32_t ticks = (uint32_t)ms * control_rate / 1000;
+  return ticks ? ticks : 1;
+}
+
+// returns the per tick fraction that covers a full scale exponential
+// segment in the given number of ticks
+static int32_t exp_coeff(uint32_t ticks)
+{
+  float rate = logf((float)(ENV_ONE + ENV_OVERSHOOT) / ENV_OVERSHOOT) / ticks;
+  return (int32_t)((1.0f - expf(-rate)) * ENV_ONE);
+}
+
+// start a segment, working out the linear step from the current level
+static void enter(env_stage next)
+{
+  stage = next;
+  switch (stage) {
+    case ENV_ATTACK:
+      step = (ENV_ONE - level) / (int32_t)attack_ticks;
+      break;
+    case ENV_DECAY:
+      step = (level - sustain) / (int32_t)decay_ticks;
+      break;
+    case ENV_RELEASE:
+      step = level / (int32_t)release_ticks;
+      break;
+    default:
+      break;
+  }
+  if (step == 0) {
+    step = 1;
+  }
+}
+
+/* envelope_init:
+set the control rate, load the default shape and set up the external gate
+input. The gate starts open so the output ramps up once at power on.
+*/
+void envelope_init(uint32_t rate)
+{
+  env_params defaults = {50, 0, 100, 50, ENV_LINEAR};
+
+  control_rate = rate;
+  envelope_set(&defaults);
+
+  ENV_GATE_PORT->DIR &= ~ENV_GATE_PIN;
+  ENV_GATE_PORT->REN |= ENV_GATE_PIN;  // pull-down, an open input is closed
+  ENV_GATE_PORT->OUT &= ~ENV_GATE_PIN;
+  ENV_GATE_PORT->IES &= ~ENV_GATE_PIN;  // rising edge first
+  ENV_GATE_PORT->IFG &= ~ENV_GATE_PIN;
+  ENV_GATE_PORT->IE |= ENV_GATE_PIN;
+  irq_enable(PORT3_IRQn, IRQ_PRIO_UI);
+
+  gate_seen = 0;
+  level = 0;
+  stage = ENV_IDLE;
+  gate = 1;
+}
+
+// change the envelope times, sustain level and segment shape
+void envelope_set(const env_params* params)
+{
+  uint32_t primask = __get_PRIMASK();
+  uint32_t attack, decay, release;
+  int32_t attack_c, decay_c, release_c;
+
+  current = *params;
+  attack = ms_to_ticks(params->attack_ms);
+  decay = ms_to_ticks(params->decay_ms);
+  release = ms_to_ticks(params->release_ms);
+  attack_c = exp_coeff(attack);
+  decay_c = exp_coeff(decay);
+  release_c = exp_coeff(release);
+
+  __disable_irq();
+  shape = params->shape;
+  attack_ticks = attack;
+  decay_ticks = decay;
+  release_ticks = release;
+  attack_coeff = attack_c;
+  decay_coeff = decay_c;
+  release_coeff = release_c;
+  sustain = (int32_t)(ENV_ONE / 100) * params->sustain_pct;
+  __set_PRIMASK(primask);
+}
+
+/* envelope_set_rate
+change the control rate and work the segment times out again for it. A
+segment that is under way keeps its old step until it ends.
+*/
+void envelope_set_rate(uint32_t rate)
+{
+  env_params params = current;
+
+  control_rate = rate;
+  envelope_set(&params);
+}
+
+// open (1) or close (0) the gate
+void envelope_gate(int on)
+{
+  gate = on;
+}
+
+int envelope_gate_on(void)
+{
+  return gate;
+}
+
+/* envelope_tick
+advance the envelope by one control tick and return the gain to apply to
+the next ENV_DECIMATION samples, 0 - ENV_GAIN_ONE. Called by the renderer.
+*/
+int32_t envelope_tick(void)
+{
+  if (gate != gate_seen) {
+    gate_seen = gate;
+    enter(gate_seen ? ENV_ATTACK : ENV_RELEASE);
+  }
+
+  switch (stage) {
+    case ENV_ATTACK:
+      if (shape == ENV_EXPONENTIAL) {
+        level += mul_q30(ENV_ONE + ENV_OVERSHOOT - level, attack_coeff);
+      }
+      else {
+        level += step;
+      }
+      if (level >= ENV_ONE) {
+        level = ENV_ONE;
+        enter(ENV_DECAY);
+      }
+      break;
+    case ENV_DECAY:
+      if (shape == ENV_EXPONENTIAL) {
+        level -= mul_q30(level - sustain + ENV_OVERSHOOT, decay_coeff);
+      }
+      else {
+        level -= step;
+      }
+      if (level <= sustain) {
+        level = sustain;
+        stage = ENV_SUSTAIN;
+      }
+      break;
+    case ENV_RELEASE:
+      if (shape == ENV_EXPONENTIAL) {
+        level -= mul_q30(level + ENV_OVERSHOOT, release_coeff);
+      }
+      else {
+        level -= step;
+      }
+      if (level <= 0) {
+        level = 0;
+        stage = ENV_IDLE;
+      }
+      break;
+    case ENV_SUSTAIN:
+      level = sustain;  // follow sustain changes
+      break;
+    default:
+      break;
+  }
+  return level >> 15;
+}
+
+// external gate edge, follows the pin level
+void PORT3_IRQHandler(void)
+{
+  ENV_GATE_PORT->IFG &= ~ENV_GATE_PIN;
+  if (ENV_GATE_PORT->IES & ENV_GATE_PIN) {
+    // falling edge
+    envelope_gate(0);
+    ENV_GATE_PORT->IES &= ~ENV_GATE_PIN;
+  }
+  else {
+    envelope_gate(1);
+    ENV_GATE_PORT->IES |= ENV_GATE_PIN;
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <stdint.h>
+
+// samples rendered per envelope update
+#define ENV_DECIMATION 32
+// full scale of the gain returned by envelope_tick()
+#define ENV_GAIN_ONE (1 << 15)
+
+// external gate input, active high
+#define ENV_GATE_PORT P3
+#define ENV_GATE_PIN BIT0
+
+typedef enum env_shape {
+  ENV_LINEAR,
+  ENV_EXPONENTIAL,
+} env_shape;
+
+typedef struct env_params {
+  uint16_t attack_ms;
+  uint16_t decay_ms;
+  uint16_t sustain_pct;  // 0 - 100 % of full amplitude
+  uint16_t release_ms;
+  env_shape shape;
+} env_params;
+
+void envelope_init(uint32_t control_rate);
+void envelope_set(const env_params* params);
+void envelope_set_rate(uint32_t rate);
+void envelope_gate(int on);
+int envelope_gate_on(void);
+int32_t envelope_tick(void);
+
+#endif
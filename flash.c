@@ -0,0 +1,77 @@
+#include "flash.h"
+#include "msp.h"
+
+/* Flash.c: main flash erase and program
+ *
+ * Only sectors in bank 1 are written, so code keeps running from bank 0
+ * while a sector is erased or programmed. Interrupts stay enabled and the
+ * sample ISR runs from SRAM. Each call lifts the write protection of its
+ * sector only for as long as it needs it.
+ */
+
+// returns the BANK1_MAIN_WEPROT bit of a bank 1 sector
+static uint32_t sector_bit(uint32_t address)
+{
+  return 1UL << ((address - FLASH_BANK1) / FLASH_SECTOR_SIZE);
+}
+
+/* flash_erase_sector
+erase the bank 1 sector that holds address. Returns 1 on success.
+*/
+int flash_erase_sector(uint32_t address)
+{
+  int ok;
+
+  if (address < FLASH_BANK1) {
+    return 0;
+  }
+  FLCTL->BANK1_MAIN_WEPROT &= ~sector_bit(address);
+
+  FLCTL->CLRIFG = FLCTL_CLRIFG_ERASE;
+  FLCTL->ERASE_SECTADDR = address;
+  // sector erase of main memory
+  FLCTL->ERASE_CTLSTAT &= ~(FLCTL_ERASE_CTLSTAT_MODE |
+                            FLCTL_ERASE_CTLSTAT_TYPE_MASK);
+  FLCTL->ERASE_CTLSTAT |= FLCTL_ERASE_CTLSTAT_START;
+  while (!(FLCTL->IFG & FLCTL_IFG_ERASE))
+    ;
+  ok = !(FLCTL->ERASE_CTLSTAT & FLCTL_ERASE_CTLSTAT_ADDR_ERR);
+  FLCTL->ERASE_CTLSTAT |= FLCTL_ERASE_CTLSTAT_CLR_STAT;
+  FLCTL->CLRIFG = FLCTL_CLRIFG_ERASE;
+
+  FLCTL->BANK1_MAIN_WEPROT |= sector_bit(address);
+  return ok;
+}
+
+/* flash_program
+program count 32 bit words into erased bank 1 flash starting at address,
+which must be word aligned and inside one sector. Returns 1 on success.
+*/
+int flash_program(uint32_t address, const uint32_t* words, int count)
+{
+  volatile uint32_t* dest = (volatile uint32_t*)address;
+  int ok = 1;
+  int i;
+
+  if (address < FLASH_BANK1 || (address & 3)) {
+    return 0;
+  }
+  FLCTL->BANK1_MAIN_WEPROT &= ~sector_bit(address);
+  FLCTL->PRG_CTLSTAT = FLCTL_PRG_CTLSTAT_ENABLE;  // immediate word mode
+
+  for (i = 0; i < count; i++) {
+    FLCTL->CLRIFG = FLCTL_CLRIFG_PRG | FLCTL_CLRIFG_PRG_ERR;
+    dest[i] = words[i];
+    while (!(FLCTL->IFG & (FLCTL_IFG_PRG | FLCTL_IFG_PRG_ERR)))
+      ;
+    if (FLCTL->IFG & FLCTL_IFG_PRG_ERR) {
+      ok = 0;
+      break;
+    }
+  }
+
+  FLCTL->CLRIFG = FLCTL_CLRIFG_PRG | FLCTL_CLRIFG_PRG_ERR;
+  FLCTL->PRG_CTLSTAT = 0;
+  FLCTL->BANK1_MAIN_WEPROT |= sector_bit(address);
+  return ok;
+}
@@ -0,0 +1,14 @@
+#ifndef FLASH_H
+#define FLASH_H
+
+#include <stdint.h>
+
+// erase unit of the main flash
+#define FLASH_SECTOR_SIZE 0x1000
+// start of flash bank 1, sectors from here on are in BANK1_MAIN_WEPROT
+#define FLASH_BANK1 0x00020000UL
+
+int flash_erase_sector(uint32_t address);
+int flash_program(uint32_t address, const uint32_t* words, int count);
+
+#endif
@@ -0,0 +1,113 @@
+#include "fmt.h"
+
+/* Fmt.c: small number formatting for the LCD
+ *
+ * Replaces sprintf for the few formats the display needs: integers, fixed
+ * point values and values with a unit. Nothing is allocated and there is no
+ * division by anything but 10, so a field costs a few hundred cycles at most.
+ */
+
+// longest unsigned 32 bit value plus sign
+#define FMT_DIGITS 11
+
+/* fmt_str
+copy text and pad with spaces to width
+*/
+char* fmt_str(char* out, const char* text, int width)
+{
+  while (*text) {
+    *out++ = *text++;
+    width--;
+  }
+  while (width-- > 0) {
+    *out++ = ' ';
+  }
+  return out;
+}
+
+/* fmt_uint
+write value in decimal, right aligned in width using pad as the fill
+character
+*/
+char* fmt_uint(char* out, uint32_t value, int width, char pad)
+{
+  char digits[FMT_DIGITS];
+  int count = 0;
+
+  do {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+
+  while (width-- > count) {
+    *out++ = pad;
+  }
+  while (count) {
+    *out++ = digits[--count];
+  }
+  return out;
+}
+
+/* fmt_fixed
+write a fixed point value that is scaled by 10^decimals, e.g. 1250 with 3
+decimals is written as 1.250
+*/
+char* fmt_fixed(char* out, int32_t value, int decimals, int width)
+{
+  char digits[FMT_DIGITS + 1];
+  char* end = digits;
+  uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+  int count, i;
+
+  if (value < 0) {
+    *end++ = '-';
+  }
+  // at least one digit before the point
+  end = fmt_uint(end, magnitude, decimals + 1, '0');
+
+  count = end - digits + (decimals ? 1 : 0);
+  while (width-- > count) {
+    *out++ = ' ';
+  }
+  for (i = 0; i < end - digits; i++) {
+    if (decimals && i == end - digits - decimals) {
+      *out++ = '.';
+    }
+    *out++ = digits[i];
+  }
+  return out;
+}
+
+// write a signed integer right aligned in width
+char* fmt_int(char* out, int32_t value, int width)
+{
+  return fmt_fixed(out, value, 0, width);
+}
+
+/* fmt_hz
+write a frequency with a unit, switching to kHz with two decimals at
+10 kHz and above, e.g. 500Hz or 12.50kHz
+*/
+char* fmt_hz(char* out, uint32_t hz, int width)
+{
+  if (hz < 10000) {
+    out = fmt_uint(out, hz, width - 2, ' ');
+    return fmt_str(out, "Hz", 0);
+  }
+  out = fmt_fixed(out, hz / 10, 2, width - 3);
+  return fmt_str(out, "kHz", 0);
+}
+
+// write a percentage, e.g. 50%
+char* fmt_percent(char* out, uint32_t percent, int width)
+{
+  out = fmt_uint(out, percent, width - 1, ' ');
+  return fmt_str(out, "%", 0);
+}
+
+// write a voltage given in millivolts with two decimals, e.g. 1.65V
+char* fmt_volts(char* out, int32_t millivolts, int width)
+{
+  out = fmt_fixed(out, millivolts / 10, 2, width - 1);
+  return fmt_str(out, "V", 0);
+}
@@ -0,0 +1,15 @@
+#include <stdint.h>
+
+/* All fmt_ functions write into out without a terminating NUL and return
+ * the position after the last character written, so fields can be chained
+ * straight into an LCD line. width pads the field to at least that many
+ * characters (0 for no padding); numbers are right aligned, text is left
+ * aligned.
+ */
+char* fmt_str(char* out, const char* text, int width);
+char* fmt_uint(char* out, uint32_t value, int width, char pad);
+char* fmt_int(char* out, int32_t value, int width);
+char* fmt_fixed(char* out, int32_t value, int decimals, int width);
+char* fmt_hz(char* out, uint32_t hz, int width);
+char* fmt_percent(char* out, uint32_t percent, int width);
+char* fmt_volts(char* out, int32_t millivolts, int width);
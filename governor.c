@@ -0,0 +1,107 @@
+#include "governor.h"
+#include "diag.h"
+#include "fmt.h"
+#include "lcd.h"
+#include "render.h"
+#include "trace.h"
+
+/* Governor.c: sample rate governor
+ *
+ * Each sample costs the sample ISR plus its share of the renderer. The
+ * governor compares the average of that cost over each poll with the sample
+ * period, both in 24 MHz cycles. When samples get too expensive, or the ISR
+ * overran or found the queue empty, the sample rate drops one level. The
+ * renderer scales the phase increments to the new rate, so the output stays
+ * on frequency with fewer samples per cycle. Once the load would fit at the
+ * next faster rate for a while, the rate goes back up.
+ *
+ * Every change is traced as TRACE_GOVERNOR and shown on the first LCD line,
+ * e.g. "27k" at full rate and "20k*" below it.
+ *
+ * governor_hold() keeps the full rate, e.g. while sync.c shares the sample
+ * clock with other boards.
+ */
+
+static const uint16_t periods[GOVERNOR_LEVELS] = GOVERNOR_PERIODS;
+static int level = 0;
+static int calm = 0;  // polls in a row with room for the faster rate
+static int held = 0;  // stay at the full rate
+
+// counters at the last poll
+static uint32_t last_isr_cycles;
+static uint32_t last_render_cycles;
+static uint32_t last_samples;
+static uint32_t last_underruns;
+static uint32_t last_overruns;
+
+static void set_level(int next)
+{
+  level = next;
+  calm = 0;
+  render_set_sample_period(periods[level]);
+  trace(TRACE_GOVERNOR, level, periods[level]);
+  governor_status(LCD_line(0) + GOVERNOR_LCD_COLUMN);
+}
+
+/* governor_poll
+measure the load since the last poll and change the sample rate if needed.
+Run as a task.
+*/
+void governor_poll(void)
+{
+  uint32_t isr_cycles = diag.isr_cycles_total;
+  uint32_t render_cycles = diag.render_cycles;
+  uint32_t samples = diag.render_samples;
+  uint32_t underruns = diag.underruns;
+  uint32_t overruns = diag.isr_overruns;
+  uint32_t cost;
+  int trouble;
+
+  if (samples == last_samples) {
+    return;
+  }
+  cost = (isr_cycles - last_isr_cycles + render_cycles - last_render_cycles) /
+         (samples - last_samples);
+  trouble = underruns != last_underruns || overruns != last_overruns;
+
+  last_isr_cycles = isr_cycles;
+  last_render_cycles = render_cycles;
+  last_samples = samples;
+  last_underruns = underruns;
+  last_overruns = overruns;
+  if (held) {
+    return;
+  }
+
+  if ((trouble || cost * 100 > periods[level] * GOVERNOR_HIGH_PCT) &&
+      level < GOVERNOR_LEVELS - 1) {
+    set_level(level + 1);
+  }
+  else if (level > 0 && cost * 100 < periods[level - 1] * GOVERNOR_LOW_PCT) {
+    if (++calm >= GOVERNOR_CALM_WINDOWS) {
+      set_level(level - 1);
+    }
+  }
+  else {
+    calm = 0;
+  }
+}
+
+/* governor_hold
+go back to the full rate and stay there while hold is 1
+*/
+void governor_hold(int hold)
+{
+  held = hold;
+  if (hold && level) {
+    set_level(0);
+  }
+}
+
+// writes the sample rate in kHz, marked with * while it is lowered
+char* governor_status(char* out)
+{
+  out = fmt_uint(out, (MHZ_24 / periods[level] + 500) / 1000, 0, ' ');
+  out = fmt_str(out, level ? "k*" : "k ", 0);
+  return out;
+}
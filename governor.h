@@ -0,0 +1,20 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+// sample rates to fall back to, in SMCLK ticks per sample
+#define GOVERNOR_PERIODS {SAMPLE_PERIOD, 1184, 1776, 2664}
+#define GOVERNOR_LEVELS 4
+// slow down when a sample costs more than this share of its period
+#define GOVERNOR_HIGH_PCT 80
+// speed up when a sample would cost less than this share of the faster
+// period, for GOVERNOR_CALM_WINDOWS measurements in a row
+#define GOVERNOR_LOW_PCT 50
+#define GOVERNOR_CALM_WINDOWS 20
+// where the status goes on the first LCD line
+#define GOVERNOR_LCD_COLUMN 15
+
+void governor_poll(void);
+void governor_hold(int hold);
+char* governor_status(char* out);
+
+#endif
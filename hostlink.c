@@ -0,0 +1,296 @@
+#include "hostlink.h"
+#include "additive.h"
+#include "counter.h"
+#include "diag.h"
+#include "fmt.h"
+#include "render.h"
+#include "selftest.h"
+#include "sequence.h"
+#include "stack.h"
+#include "sync.h"
+#include "uart.h"
+
+/* Hostlink.c: commands from a host computer over the UART
+ *
+ * A command is one byte, and HOST_LOAD and HOST_HARMONIC are followed by
+ * their data:
+ *
+ *   'L' len_lo len_hi <len bytes of seq_step records> sum
+ *                     store a sequence in flash, sum is the low byte of the
+ *                     sum of the record bytes
+ *   'P'               play the stored sequence from the start
+ *   'S'               stop the sequence
+ *   'R'               send the RAM report as text lines, see stack.c
+ *   'T'               run the loopback self-test, the results go to the LCD
+ *                     and the answer is HOST_ERROR if the test failed
+ *   'Y'               lead synchronised boards, see sync.c
+ *   'F'               follow the leader's sample clock
+ *   'N'               stop sharing the sample clock
+ *   'C'               switch the frequency counter on or off, see counter.c
+ *   'M'               send the last counter reading as a text line, the
+ *                     answer is HOST_ERROR unless it is within
+ *                     COUNTER_LOOPBACK_PPM of the generator frequency, so
+ *                     a cable from the output to the counter input checks
+ *                     the output frequency. Above 100 kHz the line is
+ *                     "F=out of range", without a signal "F=no signal".
+ *   'H' n pct deg_lo deg_hi
+ *                     set the amplitude (percent) and phase (degrees) of
+ *                     harmonic n of the additive synthesis, see additive.c;
+ *                     '#' and '*' choose how many harmonics are heard
+ *   'J'               send the sample ISR timing since the last 'J' as a
+ *                     text line and start over: the least and most cycles
+ *                     from the compare event to the ISR, and its longest
+ *                     run, e.g. "LAT=12-61 ISR=318"
+ *
+ * Each command is answered with HOST_OK or HOST_ERROR once it is done. The
+ * host must wait for the answer before sending the next command, bytes that
+ * arrive while a command is still being carried out are dropped.
+ *
+ * Bytes are parsed in the receive interrupt so nothing is lost while the main
+ * loop is busy. The command itself is carried out by hostlink_poll(), or
+ * hostlink_commit() for HOST_LOAD, since writing flash takes far too long
+ * for an interrupt.
+ */
+
+typedef enum rx_state {
+  RX_COMMAND,
+  RX_LENGTH_LO,
+  RX_LENGTH_HI,
+  RX_DATA,
+  RX_SUM,
+  RX_ARGS,  // fixed size arguments of HOST_HARMONIC
+  RX_BUSY,  // waiting for hostlink_poll()
+} rx_state;
+
+#define HARMONIC_ARGS 4
+
+static seq_step upload[SEQ_MAX_STEPS];
+static volatile rx_state state = RX_COMMAND;
+static volatile uint8_t command;
+static volatile uint8_t command_ok;
+static uint16_t length;
+static uint16_t received;
+static uint8_t sum;
+static uint8_t args[HARMONIC_ARGS];
+
+// receive interrupt, collects one command
+static void receive(uint8_t byte)
+{
+  uint8_t* data = (uint8_t*)upload;
+
+  switch (state) {
+    case RX_COMMAND:
+      command = byte;
+      command_ok = 1;
+      received = 0;
+      if (byte == HOST_LOAD) {
+        state = RX_LENGTH_LO;
+      }
+      else if (byte == HOST_HARMONIC) {
+        state = RX_ARGS;
+      }
+      else {
+        state = RX_BUSY;
+      }
+      break;
+    case RX_LENGTH_LO:
+      length = byte;
+      state = RX_LENGTH_HI;
+      break;
+    case RX_LENGTH_HI:
+      length |= (uint16_t)byte << 8;
+      received = 0;
+      sum = 0;
+      // the data is still read when it does not fit, to stay in step
+      command_ok = length % sizeof(seq_step) == 0 && length != 0 &&
+                   length <= sizeof(upload);
+      state = length ? RX_DATA : RX_SUM;
+      break;
+    case RX_DATA:
+      if (received < sizeof(upload)) {
+        data[received] = byte;
+      }
+      sum += byte;
+      if (++received == length) {
+        state = RX_SUM;
+      }
+      break;
+    case RX_SUM:
+      if (byte != sum) {
+        command_ok = 0;
+      }
+      state = RX_BUSY;
+      break;
+    case RX_ARGS:
+      args[received++] = byte;
+      if (received == HARMONIC_ARGS) {
+        state = RX_BUSY;
+      }
+      break;
+    case RX_BUSY:
+      break;
+  }
+}
+
+static void send_line(const char* line, int length)
+{
+  uart_write((const uint8_t*)line, length);
+}
+
+// sends the counter reading, returns 1 if it matches the generator
+static int send_measurement(void)
+{
+  counter_result result;
+  char line[48];
+  char* end;
+  int32_t ppm;
+
+  counter_read(&result);
+  if (!counter_running()) {
+    return 0;
+  }
+  if (result.status == COUNTER_OVERRANGE) {
+    end = fmt_str(line, "F=out of range\r\n", 0);
+    send_line(line, end - line);
+    return 0;
+  }
+  if (result.status != COUNTER_OK) {
+    end = fmt_str(line, "F=no signal\r\n", 0);
+    send_line(line, end - line);
+    return 0;
+  }
+  ppm = counter_error_ppm(&result, render_frequency());
+  end = fmt_str(line, "F=", 0);
+  end = fmt_fixed(end, result.frequency_mhz, 3, 0);
+  end = fmt_str(end, "Hz T=", 0);
+  end = fmt_uint(end, result.period_ns, 0, ' ');
+  end = fmt_str(end, "ns E=", 0);
+  end = fmt_int(end, ppm, 0);
+  end = fmt_str(end, "ppm\r\n", 0);
+  send_line(line, end - line);
+  return ppm <= COUNTER_LOOPBACK_PPM && ppm >= -COUNTER_LOOPBACK_PPM;
+}
+
+/* send_timing
+sends the sample ISR latency range and longest run time, all in 24 MHz
+cycles, and restarts them. The latency is TA0R when the ISR reads it, the
+timer counts the same clock as MCLK from the compare event on. The run time
+is timed with the DWT cycle counter.
+*/
+static void send_timing(void)
+{
+  char line[40];
+  char* end;
+
+  end = fmt_str(line, "LAT=", 0);
+  end = fmt_uint(end, diag.sample_latency_min, 0, ' ');
+  end = fmt_str(end, "-", 0);
+  end = fmt_uint(end, diag.sample_latency_max, 0, ' ');
+  end = fmt_str(end, " ISR=", 0);
+  end = fmt_uint(end, diag.isr_cycles_max, 0, ' ');
+  end = fmt_str(end, "\r\n", 0);
+  diag_reset_timing();
+  send_line(line, end - line);
+}
+
+// sets a harmonic from the HOST_HARMONIC arguments, returns 0 if they are
+// out of range
+static int set_harmonic(void)
+{
+  uint16_t phase = args[2] | (uint16_t)args[3] << 8;
+
+  if (args[0] < 1 || args[0] > ADDITIVE_HARMONICS || args[1] > 100 ||
+      phase >= 360) {
+    return 0;
+  }
+  additive_set_harmonic(args[0], args[1], phase);
+  return 1;
+}
+
+// start listening for commands
+void hostlink_init(void)
+{
+  state = RX_COMMAND;
+  uart_init(receive);
+}
+
+/* hostlink_poll
+carry out a command once it has been received completely and answer it.
+Run as a task. Loading a sequence is left to hostlink_commit().
+*/
+void hostlink_poll(void)
+{
+  analysis_result result;
+  int ok;
+
+  if (state != RX_BUSY || command == HOST_LOAD) {
+    return;
+  }
+  ok = command_ok;
+  switch (command) {
+    case HOST_PLAY:
+      render_sequence(1);
+      break;
+    case HOST_STOP:
+      render_sequence(0);
+      break;
+    case HOST_REPORT:
+      ram_report(send_line);
+      break;
+    case HOST_LEAD:
+      sync_set_mode(SYNC_LEADER);
+      break;
+    case HOST_FOLLOW:
+      sync_set_mode(SYNC_FOLLOWER);
+      break;
+    case HOST_ALONE:
+      sync_set_mode(SYNC_OFF);
+      break;
+    case HOST_COUNTER:
+      if (counter_running()) {
+        counter_stop();
+      }
+      else {
+        counter_start();
+      }
+      break;
+    case HOST_MEASURE:
+      ok = send_measurement();
+      break;
+    case HOST_HARMONIC:
+      ok = set_harmonic();
+      break;
+    case HOST_TIMING:
+      send_timing();
+      break;
+    case HOST_TEST:
+      if (sync_current() == SYNC_FOLLOWER) {
+        ok = 0;  // the ADC trigger needs TA0 in up mode
+        break;
+      }
+      ok = selftest_run(&result);
+      selftest_show(&result, ok);
+      break;
+    default:
+      ok = 0;
+      break;
+  }
+  uart_putc(ok ? HOST_OK : HOST_ERROR);
+  state = RX_COMMAND;
+}
+
+/* hostlink_commit
+write a received sequence to flash and answer the load command. Run as a
+task with a long deadline, erasing the sector takes tens of ms.
+*/
+void hostlink_commit(void)
+{
+  int ok;
+
+  if (state != RX_BUSY || command != HOST_LOAD) {
+    return;
+  }
+  ok = command_ok && sequence_store(upload, length / sizeof(seq_step));
+  uart_putc(ok ? HOST_OK : HOST_ERROR);
+  state = RX_COMMAND;
+}
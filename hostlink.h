@@ -0,0 +1,24 @@
+#ifndef HOSTLINK_H
+#define HOSTLINK_H
+
+// single byte commands and replies, see hostlink.c
+#define HOST_LOAD 'L'
+#define HOST_PLAY 'P'
+#define HOST_STOP 'S'
+#define HOST_TEST 'T'
+#define HOST_REPORT 'R'
+#define HOST_LEAD 'Y'
+#define HOST_FOLLOW 'F'
+#define HOST_ALONE 'N'
+#define HOST_COUNTER 'C'
+#define HOST_MEASURE 'M'
+#define HOST_HARMONIC 'H'
+#define HOST_TIMING 'J'
+#define HOST_OK 'K'
+#define HOST_ERROR 'E'
+
+void hostlink_init(void);
+void hostlink_poll(void);
+void hostlink_commit(void);
+
+#endif
@@ -0,0 +1,107 @@
+#include "irq.h"
+#include "ramfunc.h"
+
+/* Irq.c: interrupt priorities and deferred work
+ *
+ * Every interrupt is enabled through irq_enable() with one of the IRQ_PRIO_
+ * levels from irq.h, so the whole priority plan is in one place. Handlers
+ * that have non-urgent follow-up work call irq_defer(). This marks a job and
+ * pends PendSV, and the job then runs at the lowest priority once every
+ * other handler has returned.
+ *
+ * Defining IRQ_STRESS_TEST starts two Timer32 interrupts at the UI and
+ * communication priorities that burn CPU time at a high rate, like a key
+ * press and UART storm. HOST_TIMING sends the sample ISR's least and most
+ * latency and its longest run since it was last sent. Two 'J' commands a
+ * while apart give the figures under the storm, and the same without
+ * IRQ_STRESS_TEST the baseline they are compared with.
+ */
+
+static deferred_fn deferred[DEFER_COUNT];
+static volatile uint8_t deferred_pending[DEFER_COUNT];
+
+#ifdef IRQ_STRESS_TEST
+#define STRESS_KEY_PERIOD 2400   // 10 kHz at 24 MHz
+#define STRESS_UART_PERIOD 2087  // about 11.5 kHz, a 115200 baud byte rate
+#define STRESS_WORK_CYCLES 400   // cycles burnt per stress interrupt
+
+static void stress_init(void)
+{
+  TIMER32_1->LOAD = STRESS_KEY_PERIOD;
+  TIMER32_1->CONTROL = TIMER32_CONTROL_SIZE | TIMER32_CONTROL_MODE |
+                       TIMER32_CONTROL_IE | TIMER32_CONTROL_ENABLE;
+  TIMER32_2->LOAD = STRESS_UART_PERIOD;
+  TIMER32_2->CONTROL = TIMER32_CONTROL_SIZE | TIMER32_CONTROL_MODE |
+                       TIMER32_CONTROL_IE | TIMER32_CONTROL_ENABLE;
+  irq_enable(T32_INT1_IRQn, IRQ_PRIO_UI);
+  irq_enable(T32_INT2_IRQn, IRQ_PRIO_COMM);
+}
+
+void T32_INT1_IRQHandler(void)
+{
+  TIMER32_1->INTCLR = 0;
+  __delay_cycles(STRESS_WORK_CYCLES);
+}
+
+void T32_INT2_IRQHandler(void)
+{
+  TIMER32_2->INTCLR = 0;
+  __delay_cycles(STRESS_WORK_CYCLES);
+}
+#endif
+
+/* irq_init:
+set the priority of the system exceptions used by the firmware. Call before
+enabling interrupts.
+*/
+void irq_init(void)
+{
+  NVIC_SetPriority(PendSV_IRQn, IRQ_PRIO_DEFERRED);
+#ifdef IRQ_STRESS_TEST
+  stress_init();
+#endif
+}
+
+// set the priority of a peripheral interrupt and enable it in the NVIC
+void irq_enable(IRQn_Type irq, uint32_t priority)
+{
+  NVIC_SetPriority(irq, priority);
+  NVIC_ClearPendingIRQ(irq);
+  NVIC_EnableIRQ(irq);
+}
+
+// register the function run for a deferred job
+void irq_set_deferred(deferred_job job, deferred_fn fn)
+{
+  deferred[job] = fn;
+}
+
+/* irq_defer
+request that a job runs from PendSV. Safe to call from any context, a job
+requested several times before it runs only runs once.
+*/
+RAMFUNC void irq_defer(deferred_job job)
+{
+  deferred_pending[job] = 1;
+  SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+void PendSV_Handler(void)
+{
+  int job = 0;
+
+  // restart from the first job whenever one runs, so the most urgent job is
+  // never left waiting behind a slow one
+  while (job < DEFER_COUNT) {
+    if (deferred_pending[job]) {
+      deferred_pending[job] = 0;
+      if (deferred[job]) {
+        deferred[job]();
+      }
+      job = 0;
+    }
+    else {
+      job++;
+    }
+  }
+}
@@ -0,0 +1,30 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "msp.h"
+
+/* Interrupt priority plan. The MSP432 implements 3 priority bits and 0 is
+ * the most urgent. Nothing may share or outrank the sample clock.
+ */
+#define IRQ_PRIO_SAMPLE 0    // TA0_0 sample clock
+#define IRQ_PRIO_DMA 1       // DMA and SPI completion
+#define IRQ_PRIO_TIMING 2    // capture and calibration timers
+#define IRQ_PRIO_UI 5        // keypad, LCD and other user interface timers
+#define IRQ_PRIO_COMM 6      // UART and other host communication
+#define IRQ_PRIO_DEFERRED 7  // PendSV, runs the deferred jobs
+
+// work that is run from PendSV, lower numbers run first
+typedef enum deferred_job {
+  DEFER_RENDER,    // refill the sample queue
+  DEFER_ADDITIVE,  // rebuild the additive synthesis table
+  DEFER_COUNT,
+} deferred_job;
+
+typedef void (*deferred_fn)(void);
+
+void irq_init(void);
+void irq_enable(IRQn_Type irq, uint32_t priority);
+void irq_set_deferred(deferred_job job, deferred_fn fn);
+void irq_defer(deferred_job job);
+
+#endif
@@ -1,19 +1,54 @@
 #include "keypad.h"
+#include "lcd.h"
+#include "trace.h"
 /* Keypad.c: Matrix keypad scanning
  *
- * This program scans a 4x3 matrix keypad and returns the number of the
- * key that is pressed. The getkey() function is non-blocking, so it will
- * return 0xFF if no key is pressed to allow 0 to be used for key 0.
- * * key will return 10 and # will return 12.
+ * keypad_scan() reads the whole 4x3 matrix in one pass and returns it as a
+ * bitmask, one bit per key, so any number of keys can be held and each one
+ * is seen on its own (rollover). Column c drives the key bits 4c - 4c+3 for
+ * its rows, see keypad_char().
  *
- * The getkey() function assumes that only a single key is pressed. If keys
- * on multiple columns are pressed, the key on the farthest left column will
- * be detected and the others will be ignored. If multiple keys in the same
- * column are pressed, the function will return an incorrect value.
+ * The column pins keep their output latch high and only the one column
+ * being read is switched to an output, so two keys in the same row never
+ * short a high column to a low one. When nothing was held at the last scan,
+ * a single read with all columns driven finds an idle keypad after one
+ * settling delay. While keys are held the three columns are read directly,
+ * without that first read.
  *
+ * The keypad has no diodes: with three corners of a rectangle held, the
+ * fourth key reads as pressed too. keypad_ghosted() flags such scans so the
+ * caller can ignore them.
  *
+ * keypad_update() debounces the scans and turns them into actions. A key
+ * acts when it goes down, except *: held together with a digit it selects
+ * a shortcut instead, so on its own it acts when released. * and #, which
+ * step a setting, repeat every KEY_REPEAT_MS while held.
+ *
+ * keypad_getkey() is kept for single key use and returns the first held key
+ * in the old numbering. The * key will return 10 and # will return 12, and
+ * it returns 0xFF if no key is pressed to allow 0 to be used for key 0.
  */
 
+#define ROWS (ROW1 | ROW2 | ROW3 | ROW4)
+#define COLS (COL1 | COL2 | COL3)
+#define KEYPAD_SETTLE 25  // cycles for the rows to follow a column
+
+static const uint8_t column_pins[KEYPAD_COLS] = {COL1, COL2, COL3};
+static const char key_chars[KEYPAD_KEYS + 1] = "147*2580369#";
+static uint16_t last_scan = 0;
+
+// keypad_update() state
+static key_action on_key = 0;       // a key acts
+static key_action on_shortcut = 0;  // a digit pressed while * is held
+static uint16_t raw_last = 0;       // raw state of the last scan
+static uint16_t held = 0;           // debounced state
+static int stable = 0;              // scans raw_last has read the same
+static uint32_t update_ms;          // time of the scan being handled
+static char repeat_key = 0;         // key repeated while held, 0 for none
+static uint32_t repeat_at;
+static int star_held = 0;
+static int star_used = 0;           // the held * made a shortcut or repeated
+
 /* this function initializes Port 4 that is connected to the keypad.
  * All pins are configured as GPIO input pin. The row pins have
  * the pull-down resistors enabled.
@@ -24,72 +59,215 @@ void keypad_init(void)
   KEYPAD_PORT->REN |=
       (ROW1 | ROW2 | ROW3 | ROW4);  // enable resistor for row pins
   KEYPAD_PORT->OUT &= ~(ROW1 | ROW2 | ROW3 | ROW4);  // make row pins pull-down
+  KEYPAD_PORT->OUT |= COLS;  // a column drives high once it is an output
+  last_scan = 0;
 }
 
-/*
- * This is a non-blocking function to read the keypad.
+// returns the row pins read as 4 bits, row 1 in bit 0
+static uint16_t read_rows(void)
+{
+  uint8_t rows;
 
- *
- */
-uint8_t keypad_getkey(void)
+  __delay_cycles(KEYPAD_SETTLE);  // wait for signals to settle
+  rows = KEYPAD_PORT->IN;
+  return (rows & (ROW1 | ROW2 | ROW3)) | ((rows & ROW4) ? 8 : 0);
+}
+
+/* keypad_scan
+read all keys, returns a bitmask with bit 4 * column + row set for each key
+that is down. Ghost keys are included, see keypad_ghosted().
+*/
+uint16_t keypad_scan(void)
 {
-  uint8_t row, col, key;
+  uint16_t mask = 0;
+  int col;
 
-  /* check to see any key pressed */
-  KEYPAD_PORT->DIR |= (COL1 | COL2 | COL3);  // make the column pins outputs
-  KEYPAD_PORT->OUT |= (COL1 | COL2 | COL3);  // drive all column pins high
-  __delay_cycles(25);                        // wait for signals to settle
+  if (!last_scan) {
+    KEYPAD_PORT->DIR |= COLS;
+    mask = read_rows();
+    KEYPAD_PORT->DIR &= ~COLS;
+    if (!mask) {
+      return 0;
+    }
+    mask = 0;
+  }
+  for (col = 0; col < KEYPAD_COLS; col++) {
+    KEYPAD_PORT->DIR = (KEYPAD_PORT->DIR & ~COLS) | column_pins[col];
+    mask |= read_rows() << (col * KEYPAD_ROWS);
+  }
+  KEYPAD_PORT->DIR &= ~COLS;  // disable the column outputs
 
-  row = KEYPAD_PORT->IN & (ROW1 | ROW2 | ROW3 | ROW4);  // read all row pins
+  last_scan = mask;
+  return mask;
+}
 
-  if (row == 0)  // if all rows are low, no key pressed
-    return 0xFF;
+/* keypad_ghosted
+returns 1 if mask can not be trusted: two columns share two or more rows,
+so one of the four keys may only be seen through the other three
+*/
+int keypad_ghosted(uint16_t mask)
+{
+  uint16_t col1 = mask & 0xF;
+  uint16_t col2 = (mask >> 4) & 0xF;
+  uint16_t col3 = (mask >> 8) & 0xF;
+  uint16_t shared;
 
-  /* If a key is pressed, it gets here to find out which key.
-   * It activates one column at a time and reads the input to see
-   * which row is active. */
+  shared = col1 & col2;
+  if (shared & (shared - 1)) {
+    return 1;
+  }
+  shared = col1 & col3;
+  if (shared & (shared - 1)) {
+    return 1;
+  }
+  shared = col2 & col3;
+  return (shared & (shared - 1)) != 0;
+}
 
-  for (col = 0; col < 3; col++) {
-    // zero out bits 6-4
-    KEYPAD_PORT->OUT &= ~(COL1 | COL2 | COL3);
+// returns the character printed on the key for bit number bit of a scan
+char keypad_char(int bit)
+{
+  return key_chars[bit];
+}
 
-    // shift a 1 into the correct column depending on which to turn on
-    KEYPAD_PORT->OUT |= (COL1 << col);
-    __delay_cycles(25);  // wait for signals to settle
+// returns the scan bit for a key character, 0 if there is no such key
+uint16_t keypad_mask(char key)
+{
+  int bit;
 
-    row = KEYPAD_PORT->IN &
-          (ROW1 | ROW2 | ROW3 | ROW4);  // mask only the row pins
+  for (bit = 0; bit < KEYPAD_KEYS; bit++) {
+    if (key_chars[bit] == key) {
+      return 1 << bit;
+    }
+  }
+  return 0;
+}
+
+/* keypad_edges
+call handler once for every key that is down in after but not in before
+(pressed = 1) or the other way round (pressed = 0), releases first
+*/
+void keypad_edges(uint16_t before, uint16_t after, key_handler handler)
+{
+  uint16_t changed = before ^ after;
+  int bit;
 
-    if (row != 0)
-      break;  // if the input is non-zero, key detected
+  for (bit = 0; bit < KEYPAD_KEYS; bit++) {
+    if ((changed & before) & (1 << bit)) {
+      handler(key_chars[bit], 0);
+    }
+  }
+  for (bit = 0; bit < KEYPAD_KEYS; bit++) {
+    if ((changed & after) & (1 << bit)) {
+      handler(key_chars[bit], 1);
+    }
   }
+}
 
-  KEYPAD_PORT->OUT &= ~(COL1 | COL2 | COL3);  // drive all columns low
-  KEYPAD_PORT->DIR &= ~(COL1 | COL2 | COL3);  // disable the column outputs
+// act on a debounced key edge, see keypad_update()
+static void key_edge(char key, int pressed)
+{
+  trace(TRACE_KEY, key, pressed);
+  if (!pressed) {
+    if (key == repeat_key) {
+      repeat_key = 0;
+    }
+    if (key == '*') {
+      star_held = 0;
+      if (!star_used) {
+        on_key('*');
+      }
+    }
+    return;
+  }
 
-  if (col == 3)
-    return 0xFF;  // if we get here, no key was detected
+  repeat_at = update_ms + KEY_REPEAT_MS;
+  if (key == '*') {
+    star_held = 1;
+    star_used = 0;
+    repeat_key = '*';
+  }
+  else if (star_held && key >= '0' && key <= '9') {
+    star_used = 1;
+    repeat_key = 0;
+    on_shortcut(key);
+  }
+  else {
+    repeat_key = key == '#' ? key : 0;
+    on_key(key);
+  }
+}
 
-  // rows are read in binary, so powers of 2 (1,2,4,8)
-  // use these shortcuts for log2(row) + 1
-  //+1 is because rows are 1-indexed
-  if (row == 4)
-    row = 3;
-  if (row == 16)
-    row = 4;
+/* keypad_actions
+set what keypad_update() calls: key for a key that acts, shortcut for a
+digit pressed while * is held. Forgets the keys held so far.
+*/
+void keypad_actions(key_action key, key_action shortcut)
+{
+  on_key = key;
+  on_shortcut = shortcut;
+  raw_last = 0;
+  held = 0;
+  stable = 0;
+  repeat_key = 0;
+  star_held = 0;
+  star_used = 0;
+}
 
-  /*******************************************************************
-   * IF MULTIPLE KEYS IN A COLUMN ARE PRESSED THIS WILL BE INCORRECT *
-   *******************************************************************/
+/* keypad_update
+take a scan made at now_ms. Key edges are acted on once the whole keypad
+has read the same for KEY_STABLE_SCANS scans, ghosted scans are skipped.
+Call every KEY_SCAN_MS.
+*/
+void keypad_update(uint16_t raw, uint32_t now_ms)
+{
+  update_ms = now_ms;
+  if (keypad_ghosted(raw)) {
+    // one of the keys may be a ghost, wait for a scan that can be trusted
+    stable = 0;
+    return;
+  }
+  if (raw != raw_last) {
+    raw_last = raw;
+    stable = 0;
+    return;
+  }
+  if (stable < KEY_STABLE_SCANS) {
+    stable++;
+    if (stable == KEY_STABLE_SCANS && raw != held) {
+      keypad_edges(held, raw, key_edge);
+      held = raw;
+    }
+    return;
+  }
+  if (repeat_key && (int32_t)(now_ms - repeat_at) >= 0) {
+    if (repeat_key == '*') {
+      star_used = 1;  // no extra step on release
+    }
+    on_key(repeat_key);
+    repeat_at += KEY_REPEAT_MS;
+  }
+}
 
-  // calculate the key value based on the row and columns where detected
-  if (col == 0)
-    key = row * 3 - 2;
-  if (col == 1)
-    key = row * 3 - 1;
-  if (col == 2)
-    key = row * 3;
+/*
+ * This is a non-blocking function to read the keypad.
+ * Returns the first key down, or NO_KEY if there is none or the scan
+ * is ghosted.
+ */
+uint8_t keypad_getkey(void)
+{
+  uint16_t mask = keypad_scan();
+  uint8_t key;
+  int bit;
 
+  if (!mask || keypad_ghosted(mask)) {
+    return NO_KEY;
+  }
+  bit = 0;
+  while (!(mask & (1 << bit)))
+    bit++;
+  // rows are numbered from 1, keys count along each row
+  key = (bit % KEYPAD_ROWS) * KEYPAD_COLS + bit / KEYPAD_ROWS + 1;
   if (key == 11)
     key = 0;  // fix for 0 key
 
@@ -11,7 +11,28 @@
 
 #define NO_KEY 255
 
+#define KEYPAD_ROWS 4
+#define KEYPAD_COLS 3
+#define KEYPAD_KEYS (KEYPAD_ROWS * KEYPAD_COLS)
+
+// scan period and debouncing for keypad_update()
+#define KEY_SCAN_MS 5
+#define KEY_STABLE_SCANS 4
+#define KEY_REPEAT_MS 300
+
+// called for each key that goes down (pressed = 1) or up (pressed = 0)
+typedef void (*key_handler)(char key, int pressed);
+// called by keypad_update() for a key that acts
+typedef void (*key_action)(char key);
+
 void keypad_init(void);
 uint8_t keypad_getkey(void);
+uint16_t keypad_scan(void);
+int keypad_ghosted(uint16_t mask);
+char keypad_char(int bit);
+uint16_t keypad_mask(char key);
+void keypad_edges(uint16_t before, uint16_t after, key_handler handler);
+void keypad_actions(key_action key, key_action shortcut);
+void keypad_update(uint16_t raw, uint32_t now_ms);
 char key_to_char(uint8_t key);
 char keypad_getkey_blocking(void);
@@ -1,5 +1,12 @@
 #include "lcd.h"
-#include <string.h>
+
+/* Text is drawn into frame and LCD_flush() sends only the characters that
+ * differ from shown, the copy of what the display currently holds.
+ */
+static char frame[LCD_LINES][LCD_LINESIZE];
+static char shown[LCD_LINES][LCD_LINESIZE];
+static const unsigned char line_address[LCD_LINES] = {CURSOR_FIRST_LINE,
+                                                      CURSOR_SECOND_LINE};
 
 /*LCD_init:
 Initialize the LCD port for use with LCD, sends setup commands and clears
@@ -7,6 +14,8 @@ display
 */
 void LCD_init(void)
 {
+  int i, j;
+
   LCD_PORT->DIR = 0xFF; /* make P4 pins output for data and controls */
   delayMs(30);          /* initialization sequence */
   LCD_nibble_write(0x30, 0);
@@ -22,6 +31,14 @@ void LCD_init(void)
   LCD_command(0x06);          /* move cursor right after each char */
   LCD_command(CLEAR_DISPLAY); /* clear screen, move cursor to home */
   LCD_command(0x0F);          /* turn on display, cursor blinking */
+
+  // the display is blank after CLEAR_DISPLAY
+  for (i = 0; i < LCD_LINES; i++) {
+    LCD_clear_line(i);
+    for (j = 0; j < LCD_LINESIZE; j++) {
+      shown[i][j] = ' ';
+    }
+  }
 }
 
 /* With 4-bit mode, each command or data is sent twice with upper
@@ -83,30 +100,73 @@ char intToChar(uint8_t number)
   return number + '0';
 }
 
-// write strings to lcd. If argument is null, that line will not be updated
+// write strings to lcd. If argument is null, that line will not be updated.
+// Strings longer than LCD_LINESIZE are cut off.
 void LCD_write_strings(char top_line[], char bottom_line[])
 {
-  int i;
-  //  printf("top line: %s\n", top_line ? top_line : "<empty>");
-  //  printf("bottom line: %s\n", bottom_line ? bottom_line : "<empty>");
-
-  // write top line if provided
-  if (top_line) {
-    LCD_command(CURSOR_FIRST_LINE);
-    if (strlen(top_line) > LCD_LINESIZE) {
-      printf("top_line too big!");
+  char* lines[LCD_LINES];
+  char* text;
+  int i, j;
+
+  lines[0] = top_line;
+  lines[1] = bottom_line;
+  for (i = 0; i < LCD_LINES; i++) {
+    text = lines[i];
+    if (!text) {
+      continue;
     }
-    for (i = 0; i < strlen(top_line); i++) {
-      LCD_data(top_line[i]);
+    for (j = 0; j < LCD_LINESIZE && text[j]; j++) {
+      frame[i][j] = text[j];
     }
-  }
-  if (bottom_line) {
-    LCD_command(CURSOR_SECOND_LINE);
-    if (strlen(bottom_line) > LCD_LINESIZE) {
-      printf("bottom_line too big!");
+    for (; j < LCD_LINESIZE; j++) {
+      frame[i][j] = ' ';
     }
-    for (i = 0; i < strlen(bottom_line); i++) {
-      LCD_data(bottom_line[i]);
+  }
+  LCD_flush();
+}
+
+/* LCD_line
+returns the framebuffer for a line (0 is the top line) to draw into. The
+buffer holds LCD_LINESIZE characters and is not NUL terminated. Call
+LCD_flush() to show the changes.
+*/
+char* LCD_line(int line)
+{
+  return frame[line];
+}
+
+// fill a framebuffer line with spaces
+void LCD_clear_line(int line)
+{
+  int i;
+
+  for (i = 0; i < LCD_LINESIZE; i++) {
+    frame[line][i] = ' ';
+  }
+}
+
+/* LCD_flush
+send the framebuffer characters that changed since the last flush. The
+cursor is only moved when the next changed character is not the one after
+the last written.
+*/
+void LCD_flush(void)
+{
+  int line, col;
+  int cursor;  // column the display will write next, -1 if unknown
+
+  for (line = 0; line < LCD_LINES; line++) {
+    cursor = -1;
+    for (col = 0; col < LCD_LINESIZE; col++) {
+      if (frame[line][col] == shown[line][col]) {
+        continue;
+      }
+      if (cursor != col) {
+        LCD_command(line_address[line] + col);
+      }
+      LCD_data(frame[line][col]);
+      shown[line][col] = frame[line][col];
+      cursor = col + 1;
     }
   }
 }
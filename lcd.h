@@ -18,6 +18,7 @@
 
 // constants
 #define LCD_LINESIZE 20
+#define LCD_LINES 2
 
 char intToChar(uint8_t number);
 void delayMs(int n);
@@ -27,3 +28,6 @@ void LCD_clear(void);
 void LCD_data(unsigned char data);
 void LCD_init(void);
 void LCD_write_strings(char top_line[], char bottom_line[]);
+char* LCD_line(int line);
+void LCD_clear_line(int line);
+void LCD_flush(void);
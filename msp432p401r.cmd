@@ -44,7 +44,9 @@
 
 MEMORY
 {
-    MAIN       (RX) : origin = 0x00000000, length = 0x00040000
+    MAIN       (RX) : origin = 0x00000000, length = 0x0003F000
+    /* last sector of bank 1, written at run time by sequence.c             */
+    SEQ_STORE  (R)  : origin = 0x0003F000, length = 0x00001000
     INFO       (RX) : origin = 0x00200000, length = 0x00004000
 #ifdef  __TI_COMPILER_VERSION__
 #if     __TI_COMPILER_VERSION__ >= 15009000
@@ -54,11 +56,11 @@ MEMORY
     SRAM_DATA  (RW) : origin = 0x20000000
     } length = 0x00010000
 #else
-    /* Hint: If the user wants to use ram functions, please observe that SRAM_CODE             */
-    /* and SRAM_DATA memory areas are overlapping. You need to take measures to separate       */
-    /* data from code in RAM. This is only valid for Compiler version earlier than 15.09.0.STS.*/ 
-    SRAM_CODE  (RWX): origin = 0x01000000, length = 0x00010000
-    SRAM_DATA  (RW) : origin = 0x20000000, length = 0x00010000
+    /* SRAM_CODE and SRAM_DATA are two views of the same SRAM. Older compilers */
+    /* do not support ALIAS, so the first 4 KB are reserved for RAM functions */
+    /* and data starts after them.                                            */
+    SRAM_CODE  (RWX): origin = 0x01000000, length = 0x00001000
+    SRAM_DATA  (RW) : origin = 0x20001000, length = 0x0000F000
 #endif
 #endif
 }
@@ -120,17 +122,19 @@ SECTIONS
     .TI.crctab    : > MAIN
 #endif
 
-    .vtable :   > 0x20000000
-    .data   :   > SRAM_DATA
-    .bss    :   > SRAM_DATA
-    .sysmem :   > SRAM_DATA
+    .vtable :   > SRAM_DATA
+    .data   :   > SRAM_DATA, SIZE(__data_size)
+    .bss    :   > SRAM_DATA, SIZE(__bss_size)
+    .sysmem :   > SRAM_DATA, SIZE(__sysmem_size)
+    /* stack.c paints the stack at reset and guards its lowest 32 bytes      */
     .stack  :   > SRAM_DATA (HIGH)
 
-#ifdef  __TI_COMPILER_VERSION__
-#if     __TI_COMPILER_VERSION__ >= 15009000
-    .TI.ramfunc : {} load=MAIN, run=SRAM_CODE, table(BINIT)
-#endif
-#endif
+    /* RAM functions are stored in flash and copied to SRAM_CODE by          */
+    /* Reset_Handler before _c_int00 runs, see ramfunc.h                      */
+    .TI.ramfunc : {} load=MAIN, run=SRAM_CODE,
+                     LOAD_START(__ramfunc_load_start),
+                     RUN_START(__ramfunc_run_start),
+                     SIZE(__ramfunc_size)
 }
 
 /* Symbolic definition of the WDTCTL register for RTS */
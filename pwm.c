@@ -0,0 +1,104 @@
+#include "pwm.h"
+#include "dco.h"
+
+/* Pwm.c: hardware square / pulse output
+ *
+ * TIMER_A2 runs in up mode from SMCLK and drives TA2.3 in reset/set mode:
+ * the pin goes high when the timer restarts and low when it reaches the
+ * duty compare value. Edges need no CPU time and have no interrupt jitter,
+ * and the high time can be any whole number of timer ticks short of the
+ * whole period. At 24 MHz that reaches 500 kHz with 48 steps of duty, and
+ * low frequencies use the input dividers to fit the 16 bit timer.
+ */
+
+#define PWM_CLOCK MHZ_24
+#define PWM_MAX_TICKS 65535UL  // keeps a 100% duty compare in 16 bits
+
+static uint32_t period = 0;  // timer ticks per output cycle
+
+void pwm_init(void)
+{
+  pwm_stop();
+}
+
+/* pwm_start
+start the output at the given frequency in Hz and duty cycle (0.0 - 1.0).
+The clock is divided only as far as needed to fit the period into the
+timer, to keep the finest duty resolution. The period is worked out from
+the calibrated SMCLK frequency, see dco.c.
+*/
+void pwm_start(uint32_t frequency, float duty_cycle)
+{
+  uint32_t clock = PWM_CLOCK + (int64_t)PWM_CLOCK * dco_error_ppm() / 1000000;
+  uint32_t ticks = clock / frequency;
+  uint32_t needed = (ticks + PWM_MAX_TICKS - 1) / PWM_MAX_TICKS;
+  uint32_t id, ex;
+
+  // ID divides by 1, 2, 4 or 8 and EX0 by 1 - 8
+  if (needed <= 8) {
+    id = 0;
+    ex = needed ? needed : 1;
+  }
+  else {
+    id = 3;
+    ex = (needed + 7) / 8;
+    if (ex > 8) {
+      ex = 8;  // below about 6 Hz, run as slow as possible
+    }
+  }
+  ticks /= (1UL << id) * ex;
+  if (ticks > PWM_MAX_TICKS) {
+    ticks = PWM_MAX_TICKS;
+  }
+  if (ticks < 2) {
+    ticks = 2;
+  }
+  period = ticks;
+
+  TIMER_A2->CTL = TIMER_A_CTL_MC__STOP | TIMER_A_CTL_CLR;
+  TIMER_A2->EX0 = ex - 1;
+  TIMER_A2->CCR[0] = period - 1;
+  TIMER_A2->CCTL[PWM_CCR] = TIMER_A_CCTLN_OUTMOD_7;  // reset/set
+  pwm_set_duty_ticks((uint32_t)(duty_cycle * period + 0.5f));
+
+  PWM_PORT->DIR |= PWM_PIN;
+  PWM_PORT->SEL0 |= PWM_PIN;  // TA2.3 function
+  PWM_PORT->SEL1 &= ~PWM_PIN;
+
+  TIMER_A2->CTL = TIMER_A_CTL_SSEL__SMCLK | (id << TIMER_A_CTL_ID_OFS) |
+                  TIMER_A_CTL_MC__UP | TIMER_A_CTL_CLR;
+}
+
+/* pwm_set_duty_ticks
+set the high time of each cycle in timer ticks, kept to 1 - pwm_period_ticks()
+- 1 so the output always has both edges. At 500 kHz 1% rounds to no pulse at
+all and 99% to a steady high, both become a one tick pulse or gap.
+*/
+void pwm_set_duty_ticks(uint32_t ticks)
+{
+  if (period >= 2) {
+    if (ticks < 1) {
+      ticks = 1;
+    }
+    else if (ticks > period - 1) {
+      ticks = period - 1;
+    }
+  }
+  TIMER_A2->CCR[PWM_CCR] = ticks;
+}
+
+// returns the number of timer ticks in one output cycle
+uint32_t pwm_period_ticks(void)
+{
+  return period;
+}
+
+// stop the timer and hold the output low
+void pwm_stop(void)
+{
+  TIMER_A2->CTL = TIMER_A_CTL_MC__STOP;
+  PWM_PORT->SEL0 &= ~PWM_PIN;
+  PWM_PORT->SEL1 &= ~PWM_PIN;
+  PWM_PORT->OUT &= ~PWM_PIN;
+  PWM_PORT->DIR |= PWM_PIN;
+}
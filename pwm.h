@@ -0,0 +1,13 @@
+#include <stdint.h>
+#include "msp.h"
+
+// TA2.3 output
+#define PWM_PORT P6
+#define PWM_PIN BIT6
+#define PWM_CCR 3
+
+void pwm_init(void);
+void pwm_start(uint32_t frequency, float duty_cycle);
+void pwm_set_duty_ticks(uint32_t ticks);
+uint32_t pwm_period_ticks(void);
+void pwm_stop(void);
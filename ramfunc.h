@@ -0,0 +1,12 @@
+/* Functions marked RAMFUNC are linked into .TI.ramfunc, loaded from flash
+ * and copied to SRAM_CODE by Reset_Handler, so they run without flash wait
+ * states. Define RAMFUNC_DISABLE to build them into flash instead, e.g. to
+ * compare diag.isr_cycles_max between the two placements.
+ */
+#if defined(RAMFUNC_DISABLE)
+#define RAMFUNC
+#elif defined(__TI_COMPILER_VERSION__) && __TI_COMPILER_VERSION__ >= 15009000
+#define RAMFUNC __attribute__((ramfunc))
+#else
+#define RAMFUNC __attribute__((section(".TI.ramfunc")))
+#endif
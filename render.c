@@ -0,0 +1,491 @@
+#include "render.h"
+#include "additive.h"
+#include "capture.h"
+#include "dac.h"
+#include "diag.h"
+#include "envelope.h"
+#include "irq.h"
+#include "msp.h"
+#include "pwm.h"
+#include "ramfunc.h"
+#include "sequence.h"
+#include "synth.h"
+#include "trace.h"
+
+/* Render.c: background sample renderer
+ *
+ * Samples are computed ahead of time as the DEFER_RENDER job, which runs from
+ * PendSV at the lowest interrupt priority, and pushed as ready made DAC words
+ * into a single producer / single consumer queue. The sample ISR only pops a
+ * word and writes it, so expensive waveforms do not add to its run time. The
+ * ISR defers a refill whenever the queue drops to SAMPLE_QUEUE_LOW.
+ *
+ * The queue indices are free running: the renderer only writes head and the
+ * ISR only writes tail, so no locking is needed. head - tail is the number of
+ * queued samples.
+ *
+ * A new configuration is handed over with render_set_config() and swapped in
+ * by the renderer before the next sample it renders. The hardware square wave
+ * is started and stopped at the same point.
+ *
+ * The sample rate can be lowered by governor.c. A new rate takes effect at a
+ * marked position in the queue: samples rendered before the change still
+ * play at the old rate, and render_pop() moves the sample clock over when it
+ * reaches the first sample rendered for the new one.
+ *
+ * A sequence is played by asking sequence.c for the next step whenever the
+ * current one has lasted its number of samples, and swapping the step in
+ * like a new configuration. A configuration from render_set_config() stops
+ * a running sequence.
+ *
+ * The ADSR envelope is advanced every ENV_DECIMATION samples and its gain is
+ * applied to each sample around DC_BIAS, scaled by the configured amplitude.
+ * At the same rate the active phase increment is recomputed whenever the DCO
+ * calibration has a new error estimate.
+ *
+ * For synchronised boards (sync.c) the phase can be reset at a given queue
+ * index. render_phase_reset() picks an index RENDER_SYNC_DELAY samples ahead
+ * and marks the sample now at the head for the leader's pulse, and a
+ * follower calls render_phase_reset_ahead() from the sample ISR once it has
+ * told the pulse apart, with the ticks since it rose. While the clock is
+ * shared the DCO error is ignored.
+ *
+ * Levels carry LEVEL_FRAC_BITS below the DAC resolution up to the output
+ * stage in quantize(), so small amplitudes and envelope ramps are not cut to
+ * whole codes early. The stage rounds, or adds TPDF dither to break up the
+ * stair steps into noise, optionally with error feedback that shapes that
+ * noise towards half the sample rate, away from the output frequencies.
+ */
+
+// the DAC only resolves 12 bits, so the cheaper sine polynomial is enough
+#define SINE_PRECISION SINE_12BIT
+
+// fractional bits of the levels between the waveform and the output stage
+#define LEVEL_FRAC_BITS 4
+#define FINE(level) ((int32_t)(level) << LEVEL_FRAC_BITS)
+// error feedback is limited to this much, so clipping at the rails can not
+// wind it up
+#define SHAPE_ERROR_MAX FINE(1)
+
+#define SEQ_REQUEST_PLAY 1
+#define SEQ_REQUEST_STOP 2
+
+static uint16_t sample_queue[SAMPLE_QUEUE_SIZE];
+static volatile uint32_t queue_head = 0;  // written by the renderer only
+static volatile uint32_t queue_tail = 0;  // written by the sample ISR only
+
+static gen_config active;            // used by the renderer
+static gen_config pending;           // next configuration from main
+static volatile int config_pending = 0;
+static volatile int sequence_request = 0;  // SEQ_REQUEST_ from main
+static volatile uint32_t period_request = 0;  // new sample period, 0 if none
+static uint32_t sample_period = SAMPLE_PERIOD;  // period being rendered for
+static volatile uint32_t switch_period = 0;  // period the ISR is to switch to
+static volatile uint32_t switch_at;          // at this queue index
+static uint32_t step_samples = 0;  // samples left in the sequence step, 0 idle
+static uint32_t phase = 0;  // phase accumulator, one cycle is 2^32 counts
+static int32_t gain = 0;     // envelope gain, Q15
+static int control_count = 0;  // samples until the next envelope tick
+static int32_t dco_ppm = 0;    // DCO error the active phase_inc was made for
+static int32_t shape_error[2];  // last two quantisation errors, fine levels
+static uint32_t dither_seed = 1;
+static volatile int shared_clock = 0;   // sample clock shared by sync.c
+static volatile int reset_request = 0;  // render_phase_reset() was called
+static volatile int reset_pending = 0;  // phase goes to 0 at reset_at
+static volatile uint32_t reset_at;
+static volatile int pulse_pending = 0;  // leader pulses when pulse_at plays
+static volatile uint32_t pulse_at;
+
+/* render_init:
+set the first configuration, fill the queue and register the renderer as a
+deferred job. Call before the sample timer is started.
+*/
+void render_init(const gen_config* config)
+{
+  active = *config;
+  phase = 0;
+  envelope_init(SAMPLE_RATE / ENV_DECIMATION);
+  gain = 0;
+  control_count = 0;
+  step_samples = 0;
+  queue_head = 0;
+  queue_tail = 0;
+  diag_reset();
+  irq_set_deferred(DEFER_RENDER, render_fill);
+  additive_init();
+  sequence_init();
+  render_fill();
+}
+
+/* render_set_config
+hand a new configuration to the renderer. The copy is done with interrupts
+masked so the renderer never sees a half written configuration.
+*/
+void render_set_config(const gen_config* config)
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  pending = *config;
+  config_pending = 1;
+  sequence_request = SEQ_REQUEST_STOP;
+  __set_PRIMASK(primask);
+  irq_defer(DEFER_RENDER);
+}
+
+/* render_sequence
+start the stored sequence from its first step, or stop it. A stopped
+sequence leaves the output at the settings of its last step.
+*/
+void render_sequence(int play)
+{
+  sequence_request = play ? SEQ_REQUEST_PLAY : SEQ_REQUEST_STOP;
+  irq_defer(DEFER_RENDER);
+}
+
+// returns the frequency of the waveform being rendered, in Hz
+int render_frequency(void)
+{
+  return active.frequency;
+}
+
+// returns 1 while a sequence is playing or about to start
+int render_sequence_running(void)
+{
+  return step_samples != 0 || sequence_request == SEQ_REQUEST_PLAY;
+}
+
+// DCO error the phase increments are corrected for
+static int32_t clock_ppm(void)
+{
+  return shared_clock ? 0 : dco_error_ppm();
+}
+
+/* render_phase_increment
+returns the phase accumulator step for frequency Hz. The sample clock is
+derived from the DCO, so the step is scaled by the measured DCO error to
+keep the output on frequency.
+*/
+uint32_t render_phase_increment(uint32_t frequency)
+{
+  uint64_t inc = ((uint64_t)frequency << 32) / render_sample_rate();
+
+  return (uint32_t)(inc * 1000000 / (1000000 + clock_ppm()));
+}
+
+/* render_share_clock
+set shared to 1 while the sample clock is shared with other boards. The
+phase increments then leave out this board's DCO error, so all boards step
+their phase alike. The renderer picks the change up at its next envelope
+tick.
+*/
+void render_share_clock(int shared)
+{
+  shared_clock = shared;
+}
+
+/* render_phase_reset
+reset the phase RENDER_SYNC_DELAY samples after the sample now being
+rendered, and mark that sample for render_pulse_due().
+*/
+void render_phase_reset(void)
+{
+  reset_request = 1;
+  irq_defer(DEFER_RENDER);
+}
+
+/* render_set_sample_period
+change the sample clock to period SMCLK ticks. The renderer rescales the
+phase increment and envelope from the next sample it renders, and the
+sample ISR moves the clock over when it reaches that sample, so the
+output frequency does not jump.
+*/
+void render_set_sample_period(uint32_t period)
+{
+  period_request = period;
+  irq_defer(DEFER_RENDER);
+}
+
+// returns the sample period the renderer is working to, in SMCLK ticks
+uint32_t render_sample_period(void)
+{
+  return sample_period;
+}
+
+// returns the sample rate the renderer is working to, in Hz
+uint32_t render_sample_rate(void)
+{
+  return MHZ_24 / sample_period;
+}
+
+// move to the requested sample period from the next queued sample
+static void change_period(void)
+{
+  sample_period = period_request;
+  period_request = 0;
+  switch_at = queue_head;
+  switch_period = sample_period;
+  active.phase_inc = render_phase_increment(active.frequency);
+  envelope_set_rate(render_sample_rate() / ENV_DECIMATION);
+  capture_set_rate(render_sample_rate());
+}
+
+// switch to a new configuration, restarting the cycle on a new wave
+static void use_config(const gen_config* config)
+{
+  if (config->wave != active.wave) {
+    phase = 0;
+  }
+  if (config->wave == PULSE) {
+    pwm_start(config->frequency, config->duty_cycle);
+  }
+  else if (active.wave == PULSE) {
+    pwm_stop();
+  }
+  active = *config;
+  trace(TRACE_CONFIG, active.wave, active.frequency);
+}
+
+// handle a pending configuration, sequence, sample period or phase reset
+// request
+static void take_requests(void)
+{
+  if (period_request) {
+    change_period();
+  }
+  if (reset_request) {
+    reset_request = 0;
+    reset_at = queue_head + RENDER_SYNC_DELAY;
+    reset_pending = 1;
+    pulse_at = queue_head;
+    pulse_pending = 1;
+  }
+  if (config_pending) {
+    config_pending = 0;
+    use_config(&pending);
+  }
+  if (sequence_request == SEQ_REQUEST_PLAY) {
+    sequence_rewind();
+    step_samples = 1;  // the first step starts with this sample
+  }
+  else if (sequence_request == SEQ_REQUEST_STOP) {
+    step_samples = 0;
+  }
+  sequence_request = 0;
+}
+
+// move on to the next step of the sequence
+static void next_step(void)
+{
+  gen_config config = active;
+
+  if (sequence_next(&config, &step_samples)) {
+    use_config(&config);
+  }
+  else {
+    step_samples = 0;  // sequence ended, keep the last settings
+  }
+}
+
+// compute the level for the next sample of the active configuration, in
+// DAC codes with LEVEL_FRAC_BITS fractional bits
+static int32_t render_sample(void)
+{
+  int32_t level;
+  uint32_t next_phase;
+
+  switch (active.wave) {
+    case SQUARE:
+      level = FINE(DC_BIAS) + FINE(AMPLITUDE) * synth_square(phase,
+                                                           active.phase_inc,
+                                                           active.duty_cycle);
+      break;
+    case SINE:
+      level = FINE(DC_BIAS) +
+              ((AMPLITUDE * synth_sine(phase, SINE_PRECISION)) >>
+               (15 - LEVEL_FRAC_BITS));
+      break;
+    case SAWTOOTH:
+      level = FINE(DC_BIAS) +
+              FINE(AMPLITUDE) * synth_sawtooth(phase, active.phase_inc);
+      break;
+    case ADDITIVE:
+      level = FINE(DC_BIAS) +
+              ((AMPLITUDE * wavetable_lookup(additive_table(),
+                                             ADDITIVE_TABLE_BITS, phase,
+                                             active.interp)) >>
+               (15 - LEVEL_FRAC_BITS));
+      break;
+    default:
+      level = FINE(DC_BIAS);
+      break;
+  }
+
+  next_phase = phase + active.phase_inc;
+  if (next_phase < phase) {
+    // a new cycle starts with the next sample
+    additive_cycle_boundary();
+  }
+  phase = next_phase;
+  return level;
+}
+
+// returns triangular dither of just under +-1 LSB, in fine levels
+static int32_t tpdf(void)
+{
+  dither_seed = dither_seed * 1664525 + 1013904223;
+  return (int32_t)(dither_seed >> (32 - LEVEL_FRAC_BITS)) +
+         (int32_t)((dither_seed >> (32 - 2 * LEVEL_FRAC_BITS)) &
+                   (FINE(1) - 1)) -
+         (FINE(1) - 1);
+}
+
+/* quantize
+output stage: reduce a fine level to a 12 bit DAC code as chosen by
+active.output
+*/
+static int quantize(int32_t fine)
+{
+  int32_t wanted = fine;
+  int32_t error;
+  int level;
+
+  // error feedback moves the quantisation noise up out of the audio band,
+  // first order by 1 - z^-1 and second order by (1 - z^-1)^2
+  if (active.output == OUTPUT_SHAPE1) {
+    wanted = fine - shape_error[0];
+  }
+  else if (active.output == OUTPUT_SHAPE2) {
+    wanted = fine - 2 * shape_error[0] + shape_error[1];
+  }
+
+  fine = wanted;
+  if (active.output != OUTPUT_ROUND) {
+    fine += tpdf();
+  }
+  level = (fine + FINE(1) / 2) >> LEVEL_FRAC_BITS;
+  if (level < 0) {
+    level = 0;
+  }
+  if (level > VOLT_MAX) {
+    level = VOLT_MAX;
+  }
+
+  error = FINE(level) - wanted;
+  if (error > SHAPE_ERROR_MAX) {
+    error = SHAPE_ERROR_MAX;
+  }
+  if (error < -SHAPE_ERROR_MAX) {
+    error = -SHAPE_ERROR_MAX;
+  }
+  shape_error[1] = shape_error[0];
+  shape_error[0] = error;
+  return level;
+}
+
+/* render_fill
+top the sample queue up to full. Runs as a deferred job, but may also be
+called directly before the sample timer is running.
+*/
+void render_fill(void)
+{
+  uint32_t start = DWT->CYCCNT;
+  uint32_t fill = queue_head - queue_tail;
+  int level;
+
+  diag.queue_fill = fill;
+  if (fill < diag.queue_min_fill) {
+    diag.queue_min_fill = fill;
+  }
+
+  while (queue_head - queue_tail < SAMPLE_QUEUE_SIZE) {
+    if (config_pending || sequence_request || period_request ||
+        reset_request) {
+      take_requests();
+    }
+    if (reset_pending && (int32_t)(queue_head - reset_at) >= 0) {
+      reset_pending = 0;
+      phase = 0;
+      additive_cycle_boundary();
+    }
+    if (step_samples && --step_samples == 0) {
+      next_step();
+    }
+    if (control_count == 0) {
+      control_count = ENV_DECIMATION;
+      gain = envelope_tick() * active.amplitude / 100;
+      if (dco_ppm != clock_ppm()) {
+        // follow the DCO calibration
+        dco_ppm = clock_ppm();
+        active.phase_inc = render_phase_increment(active.frequency);
+      }
+    }
+    control_count--;
+
+    level = quantize(FINE(DC_BIAS) +
+                     (((render_sample() - FINE(DC_BIAS)) * gain) >> 15));
+    sample_queue[queue_head & (SAMPLE_QUEUE_SIZE - 1)] = DAC_pack(level);
+    queue_head++;
+  }
+
+  // the cost per sample, for the governor
+  diag.render_cycles += DWT->CYCCNT - start;
+  diag.render_samples += SAMPLE_QUEUE_SIZE - fill;
+}
+
+/* render_pop
+take the next DAC word off the queue. Returns 1 on success or 0 if the
+renderer fell behind and the queue is empty. Only the sample ISR may call
+this.
+*/
+RAMFUNC int render_pop(uint16_t* word)
+{
+  uint32_t tail = queue_tail;
+
+  if (tail == queue_head) {
+    return 0;
+  }
+  if (switch_period && tail == switch_at) {
+    // the first sample rendered for the new rate, the timer has just
+    // restarted so a shorter period can not be missed
+    TIMER_A0->CCR[0] = switch_period - 1;
+    switch_period = 0;
+  }
+  *word = sample_queue[tail & (SAMPLE_QUEUE_SIZE - 1)];
+  queue_tail = tail + 1;
+  return 1;
+}
+
+// returns the number of samples waiting in the queue
+RAMFUNC uint32_t render_queue_fill(void)
+{
+  return queue_head - queue_tail;
+}
+
+/* render_pulse_due
+returns 1 once, when the sample just popped is the one marked by
+render_phase_reset(). Only the sample ISR may call this.
+*/
+RAMFUNC int render_pulse_due(void)
+{
+  if (pulse_pending && queue_tail - 1 == pulse_at) {
+    pulse_pending = 0;
+    return 1;
+  }
+  return 0;
+}
+
+// returns 1 while a sample marked by render_phase_reset() has not played
+RAMFUNC int render_pulse_pending(void)
+{
+  return pulse_pending;
+}
+
+/* render_phase_reset_ahead
+reset the phase RENDER_SYNC_DELAY samples after the sample popped age ticks
+ago, 0 for the one just popped. Only the sample ISR may call this.
+*/
+RAMFUNC void render_phase_reset_ahead(uint32_t age)
+{
+  reset_at = queue_tail - 1 - age + RENDER_SYNC_DELAY;
+  reset_pending = 1;
+}
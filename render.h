@@ -0,0 +1,66 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdint.h>
+#include "dco.h"
+#include "wavetable.h"
+
+// sample clock: SMCLK (24 MHz) ticks per sample, TIMER_A0 runs in up mode.
+// This is the fastest rate, the governor may slow the clock down from it.
+#define SAMPLE_PERIOD 888
+#define SAMPLE_RATE (MHZ_24 / SAMPLE_PERIOD)
+
+// samples rendered ahead of the sample ISR, must be a power of 2
+#define SAMPLE_QUEUE_SIZE 64
+// the ISR asks for a refill once the queue drops to this many samples
+#define SAMPLE_QUEUE_LOW (SAMPLE_QUEUE_SIZE / 2)
+// samples between a sync pulse and the phase reset it stands for, more than
+// the queue holds
+#define RENDER_SYNC_DELAY (2 * SAMPLE_QUEUE_SIZE)
+
+typedef enum wave_type {
+  SQUARE,
+  SAWTOOTH,
+  SINE,
+  ADDITIVE,
+  PULSE,  // hardware PWM output, the DAC holds DC_BIAS
+} wave_type;
+
+// how the renderer reduces its levels to 12 bit DAC codes
+typedef enum output_mode {
+  OUTPUT_ROUND,   // round to the nearest code
+  OUTPUT_TPDF,    // triangular dither of +-1 LSB, then round
+  OUTPUT_SHAPE1,  // dither with first order noise shaping
+  OUTPUT_SHAPE2,  // dither with second order noise shaping
+} output_mode;
+
+// everything the renderer needs to produce a waveform
+typedef struct gen_config {
+  wave_type wave;
+  int frequency;
+  float duty_cycle;
+  uint32_t phase_inc;  // phase accumulator step per sample
+  interp_mode interp;  // table lookup interpolation
+  int amplitude;       // 0 - 100 % of full scale
+  output_mode output;  // output stage
+} gen_config;
+
+void render_init(const gen_config* config);
+void render_set_config(const gen_config* config);
+void render_fill(void);
+int render_pop(uint16_t* word);
+uint32_t render_queue_fill(void);
+uint32_t render_phase_increment(uint32_t frequency);
+void render_set_sample_period(uint32_t period);
+uint32_t render_sample_period(void);
+uint32_t render_sample_rate(void);
+void render_sequence(int play);
+int render_sequence_running(void);
+int render_frequency(void);
+void render_share_clock(int shared);
+void render_phase_reset(void);
+int render_pulse_due(void);
+int render_pulse_pending(void);
+void render_phase_reset_ahead(uint32_t age);
+
+#endif
@@ -0,0 +1,172 @@
+#include "sched.h"
+#include "sched_port.h"
+
+/* Sched.c: foreground task scheduler
+ *
+ * Everything that is not time critical runs as a task from the main loop.
+ * Tasks run to completion, each one is released every period_ms and must
+ * be done within deadline_ms of its release. Of the released tasks the one
+ * with the earliest deadline runs first. A task that is held up for more
+ * than a whole period skips the releases it missed instead of running
+ * several times back to back.
+ *
+ * Each run is timed with the DWT cycle counter for the statistics in
+ * sched_task, so a slow task shows up as a high cycles_max and as misses of
+ * the tasks it held up.
+ *
+ * With nothing released the CPU sleeps until the next interrupt, at the
+ * latest the 1 ms SysTick. The time spent asleep is counted as idle.
+ *
+ * The tick interrupt, the cycle counter and the sleep in idle() are the
+ * device specific parts, and are reached through the hooks in
+ * sched_port.h. The rest is plain C, so it also runs in the host tests.
+ */
+
+static sched_task tasks[SCHED_MAX_TASKS];
+static int task_count = 0;
+static volatile uint32_t ticks = 0;
+static uint32_t idle_cycles = 0;
+
+/* sched_init
+start the 1 ms system tick from the CPU clock. Interrupts must be enabled
+for the tick to run.
+*/
+void sched_init(uint32_t cpu_hz)
+{
+  task_count = 0;
+  ticks = 0;
+  idle_cycles = 0;
+  sched_port_init(cpu_hz);
+}
+
+/* sched_add
+add a task, first released on the next tick. Returns its id for
+sched_task_info(), or -1 if the table is full.
+*/
+int sched_add(const char* name, sched_fn run, uint32_t period_ms,
+              uint32_t deadline_ms)
+{
+  sched_task* task;
+
+  if (task_count == SCHED_MAX_TASKS) {
+    return -1;
+  }
+  task = &tasks[task_count];
+  task->name = name;
+  task->run = run;
+  task->period_ms = period_ms;
+  task->deadline_ms = deadline_ms;
+  task->release = ticks + 1;
+  task->runs = 0;
+  task->misses = 0;
+  task->cycles_max = 0;
+  task->cycles_total = 0;
+  return task_count++;
+}
+
+// returns the ms since sched_init
+uint32_t sched_now(void)
+{
+  return ticks;
+}
+
+const sched_task* sched_task_info(int id)
+{
+  return &tasks[id];
+}
+
+// returns the CPU cycles spent asleep, to compare against
+// sched_port_cycles()
+uint32_t sched_idle_cycles(void)
+{
+  return idle_cycles;
+}
+
+// returns the released task with the earliest deadline, or 0
+static sched_task* next_task(uint32_t now)
+{
+  sched_task* best = 0;
+  int i;
+
+  for (i = 0; i < task_count; i++) {
+    // tick counts are compared as differences so they may wrap
+    if ((int32_t)(now - tasks[i].release) < 0) {
+      continue;
+    }
+    if (!best || (int32_t)(tasks[i].release + tasks[i].deadline_ms -
+                           best->release - best->deadline_ms) < 0) {
+      best = &tasks[i];
+    }
+  }
+  return best;
+}
+
+// sleep until the next interrupt unless a task was released meanwhile
+static void idle(void)
+{
+  uint32_t start;
+
+  sched_port_lock();
+  if (!next_task(ticks)) {
+    start = sched_port_cycles();
+    sched_port_sleep();
+    idle_cycles += sched_port_cycles() - start;
+  }
+  sched_port_unlock();
+}
+
+// run one task and book its run time and deadline
+static void run_task(sched_task* task)
+{
+  uint32_t start = sched_port_cycles();
+  uint32_t cycles;
+
+  task->run();
+
+  cycles = sched_port_cycles() - start;
+  task->runs++;
+  task->cycles_total += cycles;
+  if (cycles > task->cycles_max) {
+    task->cycles_max = cycles;
+  }
+  if ((int32_t)(ticks - task->release) > (int32_t)task->deadline_ms) {
+    task->misses++;
+  }
+
+  task->release += task->period_ms;
+  if ((int32_t)(ticks - task->release) >= (int32_t)task->period_ms) {
+    task->release = ticks + 1;  // skip the releases that were missed
+  }
+}
+
+/* sched_step
+run the released task with the earliest deadline, or sleep until the next
+interrupt if there is none
+*/
+void sched_step(void)
+{
+  sched_task* task = next_task(ticks);
+
+  if (task) {
+    run_task(task);
+  }
+  else {
+    idle();
+  }
+}
+
+/* sched_run
+run the tasks forever.
+*/
+void sched_run(void)
+{
+  while (1) {
+    sched_step();
+  }
+}
+
+// advance the clock by a tick, called from the tick interrupt
+void sched_tick(void)
+{
+  ticks++;
+}
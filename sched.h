@@ -0,0 +1,34 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+
+#define SCHED_TICK_HZ 1000
+#define SCHED_MAX_TASKS 12
+
+typedef void (*sched_fn)(void);
+
+typedef struct sched_task {
+  const char* name;
+  sched_fn run;
+  uint32_t period_ms;
+  uint32_t deadline_ms;  // after its release the task must be done by then
+  uint32_t release;      // tick at which the task is next due
+  // statistics
+  uint32_t runs;
+  uint32_t misses;      // runs that finished after their deadline
+  uint32_t cycles_max;  // longest run in CPU cycles
+  uint32_t cycles_total;
+} sched_task;
+
+void sched_init(uint32_t cpu_hz);
+int sched_add(const char* name, sched_fn run, uint32_t period_ms,
+              uint32_t deadline_ms);
+uint32_t sched_now(void);
+const sched_task* sched_task_info(int id);
+uint32_t sched_idle_cycles(void);
+void sched_step(void);
+void sched_run(void);
+void sched_tick(void);
+
+#endif
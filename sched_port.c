@@ -0,0 +1,44 @@
+#include "sched_port.h"
+#include "irq.h"
+#include "sched.h"
+
+/* Sched_port.c: MSP432 clock and sleep for the scheduler
+ *
+ * The tick is the Cortex-M SysTick, run times come from the DWT cycle
+ * counter and idle sleeps with WFI. The cycle counter is enabled by
+ * trace_init().
+ */
+
+void sched_port_init(uint32_t cpu_hz)
+{
+  SysTick->LOAD = cpu_hz / SCHED_TICK_HZ - 1;
+  SysTick->VAL = 0;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk |
+                  SysTick_CTRL_ENABLE_Msk;
+  NVIC_SetPriority(SysTick_IRQn, IRQ_PRIO_UI);
+}
+
+uint32_t sched_port_cycles(void)
+{
+  return DWT->CYCCNT;
+}
+
+void sched_port_lock(void)
+{
+  __disable_irq();
+}
+
+void sched_port_unlock(void)
+{
+  __enable_irq();
+}
+
+void sched_port_sleep(void)
+{
+  __WFI();  // wakes on a pending interrupt even with PRIMASK set
+}
+
+void SysTick_Handler(void)
+{
+  sched_tick();
+}
@@ -0,0 +1,21 @@
+#ifndef SCHED_PORT_H
+#define SCHED_PORT_H
+
+#include <stdint.h>
+
+/* The device specific parts of sched.c. sched_port.c implements them for
+ * the MSP432, the host tests bring their own to simulate time.
+ */
+
+// start a periodic interrupt that calls sched_tick() SCHED_TICK_HZ times a
+// second
+void sched_port_init(uint32_t cpu_hz);
+// returns a free running count of CPU cycles
+uint32_t sched_port_cycles(void);
+// mask and unmask interrupts around the idle check
+void sched_port_lock(void);
+void sched_port_unlock(void);
+// sleep until the next interrupt, called with interrupts masked
+void sched_port_sleep(void);
+
+#endif
@@ -0,0 +1,158 @@
+#include "selftest.h"
+#include "fmt.h"
+#include "lcd.h"
+#include "msp.h"
+#include "render.h"
+#include "sched.h"
+
+/* Selftest.c: ADC14 loopback test of the DAC output
+ *
+ * ADC14 converts the looped back DAC output once per sample period, started
+ * by TA0 CCR1 half way between two DAC updates so the output has settled.
+ * DMA channel 7 moves every result into a buffer, which is then measured by
+ * analysis.c. The normal output keeps running throughout, so the test sees
+ * whatever is playing at the time.
+ */
+
+// the uDMA controller has 8 channels, DMA channel 7 with trigger source 6
+// is ADC14
+#define DMA_CHANNELS 8
+#define DMA_ADC_CHANNEL 7
+#define DMA_ADC_SOURCE 6
+
+// channel control word fields, see the uDMA chapter of the reference manual
+#define DMA_CTL_DST_INC_16 (1UL << 30)
+#define DMA_CTL_DST_SIZE_16 (1UL << 28)
+#define DMA_CTL_SRC_INC_NONE (3UL << 26)
+#define DMA_CTL_SRC_SIZE_16 (1UL << 24)
+#define DMA_CTL_COUNT(n) (((n) - 1UL) << 4)
+#define DMA_CTL_MODE_BASIC 1UL
+
+// a capture of SELFTEST_SAMPLES takes about 40 ms
+#define SELFTEST_TIMEOUT_MS 200
+
+typedef struct dma_descriptor {
+  volatile void* src_end;
+  volatile void* dst_end;
+  volatile uint32_t control;
+  uint32_t unused;
+} dma_descriptor;
+
+// CTLBASE holds the primary structures of all channels followed by the
+// alternate ones, and must be aligned to the size of that table: 16 byte
+// descriptors for 2 x DMA_CHANNELS channels, 256 bytes. Only basic mode
+// transfers are used, but the alternate half is reserved so a ping-pong
+// transfer never writes past the table.
+#define DMA_TABLE_BYTES 256
+#pragma DATA_ALIGN(dma_table, 256)  // DMA_TABLE_BYTES
+static dma_descriptor dma_table[2 * DMA_CHANNELS];
+
+// fails to compile if the table no longer matches its alignment
+typedef char dma_table_size_check[sizeof(dma_table) == DMA_TABLE_BYTES ? 1
+                                                                       : -1];
+
+static uint16_t samples[SELFTEST_SAMPLES];
+
+static void adc_start(void)
+{
+  SELFTEST_PORT->SEL0 |= SELFTEST_PIN;  // analog input
+  SELFTEST_PORT->SEL1 |= SELFTEST_PIN;
+
+  DMA_Control->CFG = DMA_CFG_MASTEN;
+  DMA_Control->CTLBASE = (uint32_t)dma_table;
+  DMA_Channel->CH_SRCCFG[DMA_ADC_CHANNEL] = DMA_ADC_SOURCE;
+  dma_table[DMA_ADC_CHANNEL].src_end = &ADC14->MEM[0];
+  dma_table[DMA_ADC_CHANNEL].dst_end = &samples[SELFTEST_SAMPLES - 1];
+  dma_table[DMA_ADC_CHANNEL].control =
+      DMA_CTL_DST_INC_16 | DMA_CTL_DST_SIZE_16 | DMA_CTL_SRC_INC_NONE |
+      DMA_CTL_SRC_SIZE_16 | DMA_CTL_COUNT(SELFTEST_SAMPLES) |
+      DMA_CTL_MODE_BASIC;
+  DMA_Control->ALTCLR = 1UL << DMA_ADC_CHANNEL;
+  DMA_Control->REQMASKCLR = 1UL << DMA_ADC_CHANNEL;
+  DMA_Control->ENASET = 1UL << DMA_ADC_CHANNEL;
+
+  // one conversion on every rising edge of the TA0 CCR1 output
+  ADC14->CTL0 &= ~ADC14_CTL0_ENC;
+  ADC14->CTL0 = ADC14_CTL0_ON | ADC14_CTL0_SHP | ADC14_CTL0_SHS_1 |
+                ADC14_CTL0_CONSEQ_2 | ADC14_CTL0_SHT0__16;
+  ADC14->CTL1 = ADC14_CTL1_RES__12BIT;
+  ADC14->MCTL[0] = SELFTEST_CHANNEL;
+  ADC14->IER0 = 0;  // the result flag requests DMA instead
+  ADC14->CTL0 |= ADC14_CTL0_ENC;
+
+  // set at CCR1, reset at CCR0 where the DAC is updated
+  TIMER_A0->CCR[1] = render_sample_period() / 2;
+  TIMER_A0->CCTL[1] = TIMER_A_CCTLN_OUTMOD_3;
+}
+
+static void adc_stop(void)
+{
+  TIMER_A0->CCTL[1] = TIMER_A_CCTLN_OUTMOD_0;
+  ADC14->CTL0 &= ~ADC14_CTL0_ENC;
+  ADC14->CTL0 &= ~ADC14_CTL0_ON;
+  DMA_Control->ENACLR = 1UL << DMA_ADC_CHANNEL;
+}
+
+/* selftest_run
+capture SELFTEST_SAMPLES of the DAC output and measure them. Returns 1 if
+the output looks sane, 0 if it is missing, stuck or the capture timed out.
+Blocks for the length of the capture, call from the main loop.
+*/
+int selftest_run(analysis_result* result)
+{
+  uint32_t start = sched_now();
+  int32_t offset_error;
+  int timeout = 0;
+
+  adc_start();
+  // the channel disables itself at the end of the cycle
+  while (DMA_Control->ENASET & (1UL << DMA_ADC_CHANNEL)) {
+    if (sched_now() - start > SELFTEST_TIMEOUT_MS) {
+      timeout = 1;
+      break;
+    }
+  }
+  adc_stop();
+
+  if (timeout) {
+    result->offset_mv = 0;
+    result->amplitude_mv = 0;
+    result->frequency_dhz = 0;
+    result->thd_permille = 0;
+    result->snr_ddb = 0;
+    return 0;
+  }
+  analyse(samples, SELFTEST_SAMPLES, render_sample_rate(),
+          SELFTEST_FULL_SCALE_MV, 12, result);
+
+  offset_error = result->offset_mv - SELFTEST_FULL_SCALE_MV / 2;
+  return result->amplitude_mv >= SELFTEST_MIN_AMPLITUDE_MV &&
+         offset_error > -SELFTEST_MAX_OFFSET_MV &&
+         offset_error < SELFTEST_MAX_OFFSET_MV;
+}
+
+/* selftest_show
+put a test result on the LCD, amplitude and offset first, e.g.
+    A1.65V O1.65V OK
+    300Hz THD  1.2%
+It stays there until the next key press redraws the display, the lcd task
+writes it out.
+*/
+void selftest_show(const analysis_result* result, int pass)
+{
+  uint32_t thd = result->thd_permille;
+  char* line;
+
+  LCD_clear_line(0);
+  line = fmt_str(LCD_line(0), "A", 0);
+  line = fmt_volts(line, result->amplitude_mv, 0);
+  line = fmt_str(line, " O", 0);
+  line = fmt_volts(line, result->offset_mv, 0);
+  fmt_str(line + 1, pass ? "OK" : "BAD", 0);
+
+  LCD_clear_line(1);
+  line = fmt_hz(LCD_line(1), (result->frequency_dhz + 5) / 10, 0);
+  line = fmt_str(line, " THD", 0);
+  line = fmt_fixed(line, thd > 999 ? 999 : thd, 1, 5);
+  fmt_str(line, "%", 0);
+}
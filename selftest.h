@@ -0,0 +1,22 @@
+#ifndef SELFTEST_H
+#define SELFTEST_H
+
+#include "analysis.h"
+
+// DAC output looped back to A14 on P6.1
+#define SELFTEST_PORT P6
+#define SELFTEST_PIN BIT1
+#define SELFTEST_CHANNEL ADC14_MCTLN_INCH_14
+
+// samples captured per test, at most 1024 for one DMA cycle
+#define SELFTEST_SAMPLES 1024
+// ADC reference is AVCC
+#define SELFTEST_FULL_SCALE_MV 3300
+// the output fails the test below this amplitude or this far off mid scale
+#define SELFTEST_MIN_AMPLITUDE_MV 100
+#define SELFTEST_MAX_OFFSET_MV 200
+
+int selftest_run(analysis_result* result);
+void selftest_show(const analysis_result* result, int pass);
+
+#endif
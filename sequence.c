@@ -0,0 +1,232 @@
+#include "sequence.h"
+#include "flash.h"
+#include "msp.h"
+
+/* Sequence.c: scripted waveform programs
+ *
+ * A sequence is a list of seq_step records. Steps name a waveform and how
+ * long to play it, and SEQ_LOOP / SEQ_NEXT pairs repeat the steps between
+ * them. The renderer plays a sequence by calling sequence_next() whenever
+ * the current step runs out, so every step starts on an exact sample.
+ *
+ * A sequence loaded over the host link is kept in flash behind a small
+ * header and used from there after every reset. Without one, the built in
+ * demo sequence below is played.
+ */
+
+typedef struct seq_header {
+  uint32_t magic;
+  uint16_t count;     // records that follow the header
+  uint16_t checksum;  // sum of the record bytes
+} seq_header;
+
+typedef struct seq_loop {
+  int start;           // first record of the loop body
+  uint32_t remaining;  // passes left, 0 repeats forever
+} seq_loop;
+
+static const seq_step demo[] = {
+  {SEQ_LOOP, 0, 0, 0, 0, 0},
+  {SEQ_STEP, SINE, 0, 100, 300, 2000},
+  {SEQ_STEP, SQUARE, 20, 100, 500, 500},
+  {SEQ_STEP, SAWTOOTH, 0, 50, 200, 1000},
+  {SEQ_NEXT, 0, 0, 0, 0, 0},
+};
+
+static const seq_step* program = demo;
+static int program_count = sizeof(demo) / sizeof(demo[0]);
+
+// player state, only used by the renderer
+static int pc = 0;
+static seq_loop loops[SEQ_MAX_DEPTH];
+static int depth = 0;
+
+static uint16_t checksum(const seq_step* steps, int count)
+{
+  const uint8_t* bytes = (const uint8_t*)steps;
+  uint16_t sum = 0;
+  int i;
+
+  for (i = 0; i < count * (int)sizeof(seq_step); i++) {
+    sum += bytes[i];
+  }
+  return sum;
+}
+
+// returns 1 if the step's frequency can be rendered at sample_rate: the DAC
+// waveforms must stay below half of it, the hardware pulse output need not
+static int frequency_fits(const seq_step* step, uint32_t sample_rate)
+{
+  return step->wave == PULSE || step->frequency < sample_rate / 2;
+}
+
+/* sequence_init
+use the sequence stored in flash if there is a valid one, otherwise the
+demo sequence.
+*/
+void sequence_init(void)
+{
+  const seq_header* header = (const seq_header*)SEQ_FLASH_ADDR;
+  const seq_step* steps = (const seq_step*)(header + 1);
+
+  program = demo;
+  program_count = sizeof(demo) / sizeof(demo[0]);
+  if (header->magic == SEQ_MAGIC && header->count <= SEQ_MAX_STEPS &&
+      header->checksum == checksum(steps, header->count) &&
+      sequence_validate(steps, header->count)) {
+    program = steps;
+    program_count = header->count;
+  }
+  sequence_rewind();
+}
+
+/* sequence_validate
+check that a sequence can be played: known records and waveforms, settings
+in range and loops that are balanced, not nested too deep and never empty.
+Frequencies are checked against the full sample rate, the governor may
+lower it later, so sequence_next() checks them again as they play. Returns 1
+if the sequence is valid.
+*/
+int sequence_validate(const seq_step* steps, int count)
+{
+  int has_step[SEQ_MAX_DEPTH];
+  int level = 0;
+  int i;
+
+  if (count < 1 || count > SEQ_MAX_STEPS) {
+    return 0;
+  }
+  for (i = 0; i < count; i++) {
+    switch (steps[i].op) {
+      case SEQ_END:
+        // everything after the end is ignored
+        return level == 0;
+      case SEQ_STEP:
+        if (steps[i].wave > PULSE || steps[i].amplitude_pct > 100 ||
+            steps[i].frequency == 0 || steps[i].arg == 0) {
+          return 0;
+        }
+        if (!frequency_fits(&steps[i], SAMPLE_RATE)) {
+          return 0;
+        }
+        if ((steps[i].wave == SQUARE || steps[i].wave == PULSE) &&
+            (steps[i].duty_pct < 1 || steps[i].duty_pct > 99)) {
+          return 0;
+        }
+        if (level > 0) {
+          has_step[level - 1] = 1;
+        }
+        break;
+      case SEQ_LOOP:
+        if (level == SEQ_MAX_DEPTH) {
+          return 0;
+        }
+        has_step[level++] = 0;
+        break;
+      case SEQ_NEXT:
+        // an empty loop would keep the renderer spinning
+        if (level == 0 || !has_step[level - 1]) {
+          return 0;
+        }
+        level--;
+        if (level > 0) {
+          has_step[level - 1] = 1;
+        }
+        break;
+      default:
+        return 0;
+    }
+  }
+  return level == 0;
+}
+
+/* sequence_store
+write a sequence to flash and make it the one that is played. Stops a
+running sequence first, since the player reads the flash being written.
+Returns 1 on success. Only call from the main loop, erasing takes a while.
+*/
+int sequence_store(const seq_step* steps, int count)
+{
+  seq_header header;
+  int ok;
+
+  if (!sequence_validate(steps, count)) {
+    return 0;
+  }
+  render_sequence(0);
+  while (render_sequence_running())
+    ;
+
+  // keep the player off the sector until it is complete
+  program = demo;
+  program_count = sizeof(demo) / sizeof(demo[0]);
+
+  header.magic = SEQ_MAGIC;
+  header.count = count;
+  header.checksum = checksum(steps, count);
+  ok = flash_erase_sector(SEQ_FLASH_ADDR) &&
+       flash_program(SEQ_FLASH_ADDR, (const uint32_t*)&header,
+                     sizeof(header) / 4) &&
+       flash_program(SEQ_FLASH_ADDR + sizeof(header), (const uint32_t*)steps,
+                     count * sizeof(seq_step) / 4);
+
+  sequence_init();
+  return ok;
+}
+
+// start over at the first record
+void sequence_rewind(void)
+{
+  pc = 0;
+  depth = 0;
+}
+
+/* sequence_next
+advance to the next step. Fills in the settings of config that the step
+changes and the number of samples it lasts. Returns 0 once the sequence has
+ended. A step above half the sample rate in use ends it too, the output
+keeps the settings of the step before.
+*/
+int sequence_next(gen_config* config, uint32_t* samples)
+{
+  const seq_step* step;
+  uint64_t length;
+
+  while (pc < program_count) {
+    step = &program[pc++];
+    switch (step->op) {
+      case SEQ_STEP:
+        if (!frequency_fits(step, render_sample_rate())) {
+          pc = program_count;
+          break;
+        }
+        config->wave = (wave_type)step->wave;
+        config->frequency = step->frequency;
+        config->duty_cycle = step->duty_pct / 100.0f;
+        config->amplitude = step->amplitude_pct;
+        config->phase_inc = render_phase_increment(step->frequency);
+        length = (uint64_t)step->arg * render_sample_rate() / 1000;
+        *samples = length == 0 ? 1 : length > 0xFFFFFFFFUL ? 0xFFFFFFFFUL
+                                                           : (uint32_t)length;
+        return 1;
+      case SEQ_LOOP:
+        loops[depth].start = pc;
+        loops[depth].remaining = step->arg;
+        depth++;
+        break;
+      case SEQ_NEXT:
+        if (loops[depth - 1].remaining == 0 ||
+            --loops[depth - 1].remaining > 0) {
+          pc = loops[depth - 1].start;
+        }
+        else {
+          depth--;
+        }
+        break;
+      default:
+        pc = program_count;
+        break;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include <stdint.h>
+#include "render.h"
+
+// stored sequences live in the last sector of flash bank 1, which the linker
+// command file keeps free as SEQ_STORE
+#define SEQ_FLASH_ADDR 0x0003F000UL
+#define SEQ_MAGIC 0x31514553UL  // "SEQ1"
+#define SEQ_MAX_STEPS 64
+#define SEQ_MAX_DEPTH 4  // nested loops
+
+typedef enum seq_op {
+  SEQ_END,   // end of the sequence, also implied after the last record
+  SEQ_STEP,  // play a waveform for arg ms
+  SEQ_LOOP,  // start of a loop body that is played arg times, 0 is forever
+  SEQ_NEXT,  // end of the innermost loop body
+} seq_op;
+
+// one record of a sequence, 12 bytes little endian as sent by the host
+typedef struct seq_step {
+  uint8_t op;             // seq_op
+  uint8_t wave;           // wave_type
+  uint8_t duty_pct;       // 1 - 99 %, square and pulse only
+  uint8_t amplitude_pct;  // 0 - 100 % of full scale
+  uint32_t frequency;     // Hz
+  uint32_t arg;           // duration in ms, or the repeat count for SEQ_LOOP
+} seq_step;
+
+void sequence_init(void);
+int sequence_validate(const seq_step* steps, int count);
+int sequence_store(const seq_step* steps, int count);
+void sequence_rewind(void);
+int sequence_next(gen_config* config, uint32_t* samples);
+
+#endif
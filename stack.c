@@ -0,0 +1,160 @@
+#include "stack.h"
+#include "additive.h"
+#include "capture.h"
+#include "diag.h"
+#include "fmt.h"
+#include "msp.h"
+#include "render.h"
+#include "selftest.h"
+#include "sequence.h"
+#include "tablecache.h"
+#include "trace.h"
+
+/* Stack.c: stack and RAM usage
+ *
+ * The main loop and every interrupt share the one MSP stack, so its deepest
+ * use is the main loop plus the worst case nesting of handlers. Reset_Handler
+ * paints the stack with STACK_PAINT before anything runs, and stack_used()
+ * finds the deepest word that was ever overwritten.
+ *
+ * The lowest STACK_GUARD_SIZE bytes are made inaccessible with the MPU. An
+ * overflow into them is a MemManage fault, which is left disabled so it
+ * escalates to HardFault. HardFault runs with the MPU off, so it can still
+ * stack its frame, and stack_fault() recognises the guard address and notes
+ * the overflow in diag and the trace before the trace freezes.
+ */
+
+// from the linker: the .stack section, and the sizes of the data sections
+extern uint32_t __stack;
+extern uint32_t __STACK_END;
+extern uint32_t __data_size;
+extern uint32_t __bss_size;
+extern uint32_t __sysmem_size;
+
+// words below the current stack pointer left unpainted at reset
+#define PAINT_MARGIN 16
+
+static int warned = 0;
+
+// returns the lowest address of the guard region
+static uint32_t guard_base(void)
+{
+  return ((uint32_t)&__stack + STACK_GUARD_SIZE - 1) &
+         ~(uint32_t)(STACK_GUARD_SIZE - 1);
+}
+
+/* stack_paint
+fill the unused stack with STACK_PAINT. Called from Reset_Handler, before
+the C environment is set up, so it may not use any static data.
+*/
+void stack_paint(void)
+{
+  uint32_t* word = &__stack;
+  uint32_t* end = (uint32_t*)__get_MSP() - PAINT_MARGIN;
+
+  while (word < end) {
+    *word++ = STACK_PAINT;
+  }
+}
+
+/* stack_guard
+make the bottom of the stack inaccessible. Everything else keeps the
+default memory map.
+*/
+void stack_guard(void)
+{
+  uint32_t size_field = 0;
+
+  while ((2UL << size_field) < STACK_GUARD_SIZE) {
+    size_field++;
+  }
+  MPU->RNR = 0;
+  MPU->RBAR = guard_base();
+  MPU->RASR = (1UL << MPU_RASR_XN_Pos) | (0UL << MPU_RASR_AP_Pos) |
+              (size_field << MPU_RASR_SIZE_Pos) | MPU_RASR_ENABLE_Msk;
+  MPU->CTRL = MPU_CTRL_PRIVDEFENA_Msk | MPU_CTRL_ENABLE_Msk;
+  __DSB();
+  __ISB();
+}
+
+uint32_t stack_size(void)
+{
+  return (uint32_t)&__STACK_END - (uint32_t)&__stack;
+}
+
+// returns the most stack in bytes that was used since reset
+uint32_t stack_used(void)
+{
+  const uint32_t* word = (const uint32_t*)guard_base() +
+                         STACK_GUARD_SIZE / sizeof(uint32_t);
+
+  while (word < &__STACK_END && *word == STACK_PAINT) {
+    word++;
+  }
+  return (uint32_t)&__STACK_END - (uint32_t)word;
+}
+
+/* stack_poll
+update the high water mark in diag and trace a warning the first time the
+free stack drops below STACK_WARN_FREE. Run as a task.
+*/
+void stack_poll(void)
+{
+  uint32_t used = stack_used();
+
+  diag.stack_used = used;
+  diag.stack_free = stack_size() - used;
+  if (diag.stack_free < STACK_WARN_FREE && !warned) {
+    warned = 1;
+    trace(TRACE_STACK_LOW, 0, diag.stack_free);
+  }
+}
+
+/* stack_fault
+check whether the fault being handled is a stack overflow into the guard.
+Called from Default_Handler.
+*/
+void stack_fault(void)
+{
+  uint32_t cfsr = SCB->CFSR;
+  uint32_t address = SCB->MMFAR;
+
+  if ((cfsr & SCB_CFSR_MSTKERR_Msk) ||
+      ((cfsr & SCB_CFSR_MMARVALID_Msk) && address >= guard_base() &&
+       address < guard_base() + STACK_GUARD_SIZE)) {
+    diag.stack_overflow = 1;
+    trace(TRACE_STACK_LOW, 1, 0);
+  }
+}
+
+// sends one "name bytes" line of the report
+static void report(report_fn out, const char* name, uint32_t bytes)
+{
+  char line[32];
+  char* end;
+
+  end = fmt_str(line, name, 14);
+  end = fmt_uint(end, bytes, 6, ' ');
+  end = fmt_str(end, "\r\n", 0);
+  out(line, end - line);
+}
+
+/* ram_report
+list the RAM taken by the data sections, the stack and the larger static
+buffers, one line each
+*/
+void ram_report(report_fn out)
+{
+  report(out, ".data", (uint32_t)&__data_size);
+  report(out, ".bss", (uint32_t)&__bss_size);
+  report(out, ".sysmem", (uint32_t)&__sysmem_size);
+  report(out, "stack", stack_size());
+  report(out, "stack used", stack_used());
+  report(out, "sample queue", SAMPLE_QUEUE_SIZE * sizeof(uint16_t));
+  report(out, "capture", sizeof(capture_block));
+  report(out, "table cache", TABLE_CACHE_BUDGET);
+  report(out, "additive acc", ADDITIVE_TABLE_SIZE * sizeof(int32_t));
+  report(out, "selftest", SELFTEST_SAMPLES * sizeof(uint16_t));
+  report(out, "sequence", SEQ_MAX_STEPS * sizeof(seq_step));
+  report(out, "trace", TRACE_SIZE * sizeof(trace_record));
+}
@@ -0,0 +1,24 @@
+#ifndef STACK_H
+#define STACK_H
+
+#include <stdint.h>
+
+// fill pattern of unused stack
+#define STACK_PAINT 0xA5A5A5A5UL
+// no access region at the bottom of the stack, a power of 2 of at least 32
+#define STACK_GUARD_SIZE 32
+// a warning is traced once less than this much stack was left
+#define STACK_WARN_FREE 256
+
+// called with each line of the RAM report
+typedef void (*report_fn)(const char* line, int length);
+
+void stack_paint(void);
+void stack_guard(void);
+uint32_t stack_size(void);
+uint32_t stack_used(void);
+void stack_poll(void);
+void stack_fault(void);
+void ram_report(report_fn out);
+
+#endif
@@ -46,6 +46,16 @@ extern void _c_int00(void);
 /* External declaration for system initialization function                  */
 extern void SystemInit(void);
 
+/* External declaration for the fault hook that freezes the event trace     */
+extern void trace_fault(void);
+extern void stack_fault(void);
+extern void stack_paint(void);
+
+/* Linker variables that describe the .TI.ramfunc section                   */
+extern uint16_t __ramfunc_load_start;
+extern uint16_t __ramfunc_run_start;
+extern uint16_t __ramfunc_size;
+
 /* Forward declaration of the default fault handlers. */
 void Default_Handler            (void) __attribute__((weak));
 extern void Reset_Handler       (void) __attribute__((weak));
@@ -180,8 +190,22 @@ void (* const interruptVectors[])(void) =
 /* application.                                                                */
 void Reset_Handler(void)
 {
+    uint16_t *src = &__ramfunc_load_start;
+    uint16_t *dst = &__ramfunc_run_start;
+    uint16_t *end = dst + (uint32_t)&__ramfunc_size / 2;
+
+    /* Fill the unused stack so its high water mark can be found later   */
+    stack_paint();
+
     SystemInit();
 
+    /* Copy the RAM functions from flash to SRAM_CODE, Thumb code is made */
+    /* of halfwords so the section size is always even                    */
+    while(dst < end)
+    {
+        *dst++ = *src++;
+    }
+
     /* Jump to the CCS C Initialization Routine. */
     __asm("    .global _c_int00\n"
           "    b.w     _c_int00");
@@ -197,6 +221,10 @@ void Default_Handler(void)
     #pragma diag_push
     #pragma CHECK_ULP("-2.1")
 
+	/* Keep the event history leading up to the fault for the debugger */
+	stack_fault();
+	trace_fault();
+
 	/* Enter an infinite loop. */
 	while(1)
 	{
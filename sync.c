@@ -0,0 +1,162 @@
+#include "sync.h"
+#include "governor.h"
+#include "msp.h"
+#include "ramfunc.h"
+#include "render.h"
+#include "sched.h"
+#include "sync_core.h"
+#include "trace.h"
+
+/* Sync.c: synchronised output of several boards
+ *
+ * One board, the leader, drives its sample clock out on SYNC_CLOCK_PIN: TA0
+ * CCR2 in reset/set mode gives a rising edge at every sample tick. Followers
+ * run TIMER_A0 continuously and capture that edge on CCR0 instead of
+ * comparing, so the same sample ISR runs once per leader tick and every
+ * board outputs sample n at the same moment. The clock is only correct at
+ * the full rate, so the governor is held while synced.
+ *
+ * Phases are aligned with a pulse on SYNC_PULSE_PIN, two samples wide (see
+ * sync_core.c). The leader raises it on the tick that plays queue index n
+ * and resets its own phase at index n + RENDER_SYNC_DELAY. A follower that
+ * sees the pulse resets its phase the same number of samples after the tick
+ * the pulse rose on. The delay is longer than the sample queue, so on every
+ * board the reset lies in samples that are not rendered yet.
+ *
+ * Between resets the leader sends one sample heartbeats, which a follower
+ * uses to tell it is locked: each one has to come exactly the heartbeat
+ * interval of leader ticks after the one before. Lock changes are traced.
+ * When the pulses stop, or the leader's clock stops and with it the sample
+ * ISR, sync_poll() falls back to free-running on the board's own clock.
+ *
+ * The leader sets the pulse before it writes the DAC and followers read it
+ * after, which is later than any ISR entry jitter between the boards, so
+ * both agree on the tick. Phase increments are no longer corrected for each
+ * board's DCO error while synced, the boards step alike and stay aligned
+ * until the leader changes its settings, which sends a new pulse.
+ */
+
+static volatile sync_mode mode = SYNC_OFF;
+static sync_core core;  // pulse state, stepped by the sample ISR
+
+/* sync_set_mode
+switch the sample clock and the sync pins over to next. The timer restarts,
+so expect a glitch on the output.
+*/
+void sync_set_mode(sync_mode next)
+{
+  TIMER_A0->CTL = TIMER_A_CTL_MC__STOP;
+  mode = SYNC_OFF;
+
+  governor_hold(next != SYNC_OFF);
+  render_share_clock(next != SYNC_OFF);
+
+  // everything back to inputs, the pulse input pulled down
+  TIMER_A0->CCTL[SYNC_CLOCK_CCR] = TIMER_A_CCTLN_OUTMOD_0;
+  SYNC_CLOCK_PORT->SEL0 &= ~SYNC_CLOCK_PIN;
+  SYNC_CLOCK_PORT->DIR &= ~SYNC_CLOCK_PIN;
+  SYNC_CAPTURE_PORT->SEL0 &= ~SYNC_CAPTURE_PIN;
+  SYNC_CAPTURE_PORT->DIR &= ~SYNC_CAPTURE_PIN;
+  SYNC_PULSE_PORT->DIR &= ~SYNC_PULSE_PIN;
+  SYNC_PULSE_PORT->OUT &= ~SYNC_PULSE_PIN;
+  SYNC_PULSE_PORT->REN |= SYNC_PULSE_PIN;
+  sync_core_init(&core, sched_now());
+
+  if (next == SYNC_FOLLOWER) {
+    SYNC_CAPTURE_PORT->SEL0 |= SYNC_CAPTURE_PIN;  // TA0 CCI0A
+    TIMER_A0->CCTL[0] = TIMER_A_CCTLN_CM_1 | TIMER_A_CCTLN_CCIS_0 |
+                        TIMER_A_CCTLN_SCS | TIMER_A_CCTLN_CAP |
+                        TIMER_A_CCTLN_CCIE;  // capture rising edges
+    TIMER_A0->CTL = TIMER_A_CTL_SSEL__SMCLK | TIMER_A_CTL_MC__CONTINUOUS |
+                    TIMER_A_CTL_CLR;
+  }
+  else {
+    if (next == SYNC_LEADER) {
+      // high from the sample tick to half way through the period
+      TIMER_A0->CCR[SYNC_CLOCK_CCR] = SAMPLE_PERIOD / 2;
+      TIMER_A0->CCTL[SYNC_CLOCK_CCR] = TIMER_A_CCTLN_OUTMOD_7;
+      SYNC_CLOCK_PORT->DIR |= SYNC_CLOCK_PIN;
+      SYNC_CLOCK_PORT->SEL0 |= SYNC_CLOCK_PIN;  // TA0.2 function
+      SYNC_PULSE_PORT->REN &= ~SYNC_PULSE_PIN;
+      SYNC_PULSE_PORT->DIR |= SYNC_PULSE_PIN;
+    }
+    TIMER_A0->CCTL[0] = TIMER_A_CCTLN_CCIE;
+    TIMER_A0->CCR[0] = SAMPLE_PERIOD - 1;
+    TIMER_A0->CTL = TIMER_A_CTL_SSEL__SMCLK | TIMER_A_CTL_MC__UP |
+                    TIMER_A_CTL_CLR;
+  }
+
+  mode = next;
+  trace(TRACE_SYNC, next, 0);
+  sync_realign();
+}
+
+// returns the current sync mode
+sync_mode sync_current(void)
+{
+  return mode;
+}
+
+// on the leader, reset the phase of all boards at the same sample
+void sync_realign(void)
+{
+  if (mode == SYNC_LEADER) {
+    render_phase_reset();
+  }
+}
+
+/* sync_output
+leader: drive the pulse for the sample that was just popped. Call from the
+sample ISR after render_pop() and before the DAC write.
+*/
+RAMFUNC void sync_output(void)
+{
+  int due;
+
+  if (mode != SYNC_LEADER) {
+    return;
+  }
+  due = render_pulse_due();  // clears the pending mark
+  if (sync_core_lead(&core, due, render_pulse_pending())) {
+    SYNC_PULSE_PORT->OUT |= SYNC_PULSE_PIN;
+  }
+  else {
+    SYNC_PULSE_PORT->OUT &= ~SYNC_PULSE_PIN;
+  }
+}
+
+/* sync_input
+follower: look for the leader's pulses. Call at the end of the sample ISR.
+*/
+RAMFUNC void sync_input(void)
+{
+  uint32_t age;
+  int events;
+
+  if (mode != SYNC_FOLLOWER) {
+    return;
+  }
+  events = sync_core_follow(&core, (SYNC_PULSE_PORT->IN & SYNC_PULSE_PIN) != 0,
+                            &age);
+  if (events & SYNC_FOLLOW_RESET) {
+    render_phase_reset_ahead(age);
+  }
+  if (events & ~SYNC_FOLLOW_RESET) {
+    trace(TRACE_SYNC, SYNC_FOLLOWER, events);
+  }
+}
+
+/* sync_poll
+follower: fall back to the board's own clock once the leader's pulses or
+its clock stopped. Run from the scheduler, more often than SYNC_LOSS_MS.
+*/
+void sync_poll(void)
+{
+  if (mode != SYNC_FOLLOWER) {
+    return;
+  }
+  if (sync_core_fallback(&core, sched_now())) {
+    sync_set_mode(SYNC_OFF);
+    trace(TRACE_SYNC, SYNC_OFF, SYNC_FOLLOW_LOST);
+  }
+}
@@ -0,0 +1,29 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+// leader: the sample clock goes out on TA0.2
+#define SYNC_CLOCK_PORT P2
+#define SYNC_CLOCK_PIN BIT5
+#define SYNC_CLOCK_CCR 2
+// follower: the leader's clock comes in on TA0 CCI0A
+#define SYNC_CAPTURE_PORT P7
+#define SYNC_CAPTURE_PIN BIT3
+// phase reset and heartbeat pulses, an output on the leader and an input on
+// followers
+#define SYNC_PULSE_PORT P6
+#define SYNC_PULSE_PIN BIT0
+
+typedef enum sync_mode {
+  SYNC_OFF,       // own sample clock, nothing shared
+  SYNC_LEADER,    // exports the sample clock and the phase reset pulse
+  SYNC_FOLLOWER,  // runs from the leader's clock and pulse
+} sync_mode;
+
+void sync_set_mode(sync_mode next);
+sync_mode sync_current(void);
+void sync_realign(void);
+void sync_output(void);
+void sync_input(void);
+void sync_poll(void);
+
+#endif
@@ -0,0 +1,142 @@
+#include "sync_core.h"
+#include "ramfunc.h"
+
+/* Sync_core.c: pulse protocol between synchronised boards
+ *
+ * Plain C without any device access, sync.c moves the pins and the host
+ * tests run a leader and a follower against each other.
+ *
+ * The leader's pulse line carries two kinds of pulse. A heartbeat, one tick
+ * high, goes out every SYNC_PULSE_INTERVAL ticks, and a phase reset pulse,
+ * SYNC_RESET_WIDTH ticks high, rises on the tick the renderer marked. A
+ * reset also restarts the heartbeat interval. No heartbeat starts while a
+ * reset is pending, so the two never run into each other and the reset
+ * always rises on its own tick.
+ *
+ * A follower times the rising edges in its sample ticks and tells the
+ * pulses apart by their width once they end. Running from the leader's
+ * clock, every heartbeat comes exactly one interval after the edge before
+ * it. SYNC_LOCK_PULSES of them in a row make it locked, and one off time, a
+ * sign of a lost or extra clock edge, unlocks it. Without any pulse for
+ * SYNC_LOSS_PULSES intervals the leader is lost. Should the leader's clock
+ * stop, the follower's sample ticks stop with it, so that is watched for
+ * on the scheduler's time. Either way sync_core_fallback() tells the board
+ * to go back to its own clock.
+ */
+
+// start again, as leader or follower
+void sync_core_init(sync_core* core, uint32_t now_ms)
+{
+  core->since = 0;
+  core->level = 0;
+  core->high_left = 0;
+  core->width = 0;
+  core->interval = 0;
+  core->seen = 0;
+  core->on_time = 0;
+  core->locked = 0;
+  core->lost = 0;
+  core->ticks = 0;
+  core->watch_ticks = 0;
+  core->watch_ms = now_ms;
+}
+
+/* sync_core_lead
+leader: returns the pulse level for this tick. reset_due is 1 on the tick
+the renderer marked for a phase reset, reset_pending while a mark is still
+ahead.
+*/
+RAMFUNC int sync_core_lead(sync_core* core, int reset_due, int reset_pending)
+{
+  core->since++;
+  if (reset_due) {
+    core->high_left = SYNC_RESET_WIDTH;
+    core->since = 0;
+  }
+  else if (!core->high_left && !reset_pending &&
+           core->since >= SYNC_PULSE_INTERVAL) {
+    core->high_left = 1;
+    core->since = 0;
+  }
+
+  core->level = core->high_left > 0;
+  if (core->high_left) {
+    core->high_left--;
+  }
+  return core->level;
+}
+
+/* sync_core_follow
+follower: take the pulse level read on this tick. Returns SYNC_FOLLOW_
+flags for what happened. With SYNC_FOLLOW_RESET, age is set to the ticks
+since the reset pulse rose, the tick the leader resets from.
+*/
+RAMFUNC int sync_core_follow(sync_core* core, int level, uint32_t* age)
+{
+  int events = 0;
+
+  core->ticks++;
+  core->since++;
+
+  if (level && !core->level) {
+    core->interval = core->since;
+    core->since = 0;
+    core->width = 0;
+  }
+  if (level) {
+    core->width++;
+  }
+  else if (core->level) {
+    // the pulse ended, its width tells what it was
+    if (core->width >= SYNC_RESET_WIDTH) {
+      *age = core->since;
+      events |= SYNC_FOLLOW_RESET;
+    }
+    else if (core->seen && core->interval == SYNC_PULSE_INTERVAL) {
+      core->on_time++;
+      if (!core->locked && core->on_time >= SYNC_LOCK_PULSES) {
+        core->locked = 1;
+        events |= SYNC_FOLLOW_LOCKED;
+      }
+    }
+    else {
+      core->on_time = 0;
+      if (core->locked) {
+        core->locked = 0;
+        events |= SYNC_FOLLOW_UNLOCKED;
+      }
+    }
+    core->seen = 1;
+    core->lost = 0;
+  }
+  core->level = level;
+
+  if (!core->lost &&
+      core->since > SYNC_LOSS_PULSES * (uint32_t)SYNC_PULSE_INTERVAL) {
+    core->lost = 1;
+    core->on_time = 0;
+    core->locked = 0;
+    events |= SYNC_FOLLOW_LOST;
+  }
+  return events;
+}
+
+/* sync_core_fallback
+follower: returns 1 once the board has to run on its own clock again, the
+pulses stopped or the sample ticks have not moved on for SYNC_LOSS_MS. Call
+from a task more often than that.
+*/
+int sync_core_fallback(sync_core* core, uint32_t now_ms)
+{
+  uint32_t ticks = core->ticks;
+
+  if (core->lost) {
+    return 1;
+  }
+  if (ticks != core->watch_ticks) {
+    core->watch_ticks = ticks;
+    core->watch_ms = now_ms;
+    return 0;
+  }
+  return now_ms - core->watch_ms >= SYNC_LOSS_MS;
+}
@@ -0,0 +1,44 @@
+#ifndef SYNC_CORE_H
+#define SYNC_CORE_H
+
+#include <stdint.h>
+
+// sample ticks between the leader's heartbeat pulses
+#define SYNC_PULSE_INTERVAL 1024
+// a heartbeat is one tick high, a phase reset pulse this many
+#define SYNC_RESET_WIDTH 2
+// heartbeats on time, each SYNC_PULSE_INTERVAL after the one before, until
+// a follower counts as locked
+#define SYNC_LOCK_PULSES 4
+// a follower without a pulse for this many intervals has lost the leader
+#define SYNC_LOSS_PULSES 3
+// a follower whose sample clock stopped for this long has lost the leader
+#define SYNC_LOSS_MS 100
+
+// what the follower made of the last tick, see sync_core_follow()
+#define SYNC_FOLLOW_RESET 1     // a phase reset pulse ended
+#define SYNC_FOLLOW_LOCKED 2    // lock was gained
+#define SYNC_FOLLOW_UNLOCKED 4  // lock was lost, a heartbeat was off time
+#define SYNC_FOLLOW_LOST 8      // no pulses for SYNC_LOSS_PULSES intervals
+
+typedef struct sync_core {
+  uint32_t since;        // ticks since the last rising edge
+  int level;             // pulse level at the last tick
+  int high_left;         // leader: ticks the pulse stays high
+  uint32_t width;        // follower: ticks the current pulse has been high
+  uint32_t interval;     // follower: ticks between the last two rising edges
+  int seen;              // follower: a pulse ended since the start
+  int on_time;           // follower: heartbeats on time in a row
+  int locked;            // follower: on_time reached SYNC_LOCK_PULSES
+  int lost;              // follower: no pulse for SYNC_LOSS_PULSES intervals
+  uint32_t ticks;        // follower: ticks seen, for the clock watchdog
+  uint32_t watch_ticks;  // ticks at the last watchdog check
+  uint32_t watch_ms;     // time ticks last moved on
+} sync_core;
+
+void sync_core_init(sync_core* core, uint32_t now_ms);
+int sync_core_lead(sync_core* core, int reset_due, int reset_pending);
+int sync_core_follow(sync_core* core, int level, uint32_t* age);
+int sync_core_fallback(sync_core* core, uint32_t now_ms);
+
+#endif
@@ -0,0 +1,156 @@
+#include "synth.h"
+
+/* Band-limited oscillator kernels
+ *
+ * The square and sawtooth waves are generated from a 32 bit phase
+ * accumulator. A naive waveform jumps instantly at its edges, and at only 54
+ * points per cycle the harmonics of that jump fold back below Nyquist as
+ * aliasing. PolyBLEP smooths each jump with a two sample polynomial residual
+ * so the step is approximately band-limited. The choice between the naive and
+ * PolyBLEP kernel is made from the phase increment (f / fs), so low
+ * frequencies keep the cheap path. At 1.2 kHz this takes the aliases about
+ * 14 dB down, but only 8 dB close to Nyquist, see tests/synth_test.c.
+ *
+ * Both kernels return a unipolar value from 0.0 to 1.0 so they can be scaled
+ * by AMPLITUDE on top of DC_BIAS like the other waveforms.
+ *
+ * The sine kernel is integer only. The phase is folded into -pi/2 - pi/2,
+ * which maps to -1.0 - 1.0 in Q30, and an odd minimax polynomial is evaluated
+ * with Horner's method. The result is a bipolar Q15 value (+/- SINE_MAX).
+ */
+
+// minimax coefficients for sin(pi/2 * x), Q15, max error 6.8e-5
+#define SIN5_C1 51456
+#define SIN5_C3 -21041
+#define SIN5_C5 2355
+
+// minimax coefficients for sin(pi/2 * x), Q30, max error 5.9e-7
+#define SIN7_C1 1686624004L
+#define SIN7_C3 -693522167L
+#define SIN7_C5 85291973L
+#define SIN7_C7 -4652620L
+
+/* poly_blep
+returns the polynomial band-limited step residual for normalized phase t
+(0.0 - 1.0) with step size dt. The residual is non-zero only within one sample
+on either side of the discontinuity at t = 0.
+*/
+static float poly_blep(float t, float dt)
+{
+  if (t < dt) {
+    t /= dt;
+    return t + t - t * t - 1.0f;
+  }
+  else if (t > 1.0f - dt) {
+    t = (t - 1.0f) / dt;
+    return t * t + t + t + 1.0f;
+  }
+  return 0.0f;
+}
+
+// converts a bipolar sample (-1.0 - 1.0) to the unipolar output range
+static float to_unipolar(float value)
+{
+  value = (value + 1.0f) * 0.5f;
+  if (value < 0.0f) {
+    return 0.0f;
+  }
+  if (value > 1.0f) {
+    return 1.0f;
+  }
+  return value;
+}
+
+/* synth_square
+returns the square wave level for the given phase. The wave is high for the
+first duty_cycle fraction of the cycle. The rising edge sits at phase 0 and the
+falling edge at duty_cycle, each corrected with a PolyBLEP residual.
+*/
+float synth_square(uint32_t phase, uint32_t phase_inc, float duty_cycle)
+{
+  float t = phase * PHASE_SCALE;
+  float dt, fall, value;
+
+  value = (t < duty_cycle) ? 1.0f : -1.0f;
+  if (phase_inc < BLEP_MIN_INC) {
+    return to_unipolar(value);
+  }
+
+  dt = phase_inc * PHASE_SCALE;
+  // phase measured from the falling edge
+  fall = t - duty_cycle;
+  if (fall < 0.0f) {
+    fall += 1.0f;
+  }
+  value += poly_blep(t, dt);
+  value -= poly_blep(fall, dt);
+  return to_unipolar(value);
+}
+
+/* synth_sawtooth
+returns the rising sawtooth level for the given phase, with the reset at
+phase 0 corrected by a PolyBLEP residual.
+*/
+float synth_sawtooth(uint32_t phase, uint32_t phase_inc)
+{
+  float t = phase * PHASE_SCALE;
+  float value = t + t - 1.0f;
+
+  if (phase_inc >= BLEP_MIN_INC) {
+    value -= poly_blep(t, phase_inc * PHASE_SCALE);
+  }
+  return to_unipolar(value);
+}
+
+// multiplies two Q30 values
+static int32_t mul_q30(int32_t a, int32_t b)
+{
+  return (int32_t)(((int64_t)a * b) >> 30);
+}
+
+/* synth_sine
+returns sin(2 * pi * phase / 2^32) in Q15. precision selects SINE_12BIT for
+the cheaper polynomial or SINE_16BIT for full 16 bit accuracy.
+*/
+int32_t synth_sine(uint32_t phase, int precision)
+{
+  int32_t x = (int32_t)phase;  // -pi - pi as -2^31 - 2^31
+  int32_t x2, result;
+
+  // fold the outer quarters back into -pi/2 - pi/2 using sin(pi - x)
+  if (x > 0x40000000L || x < -0x40000000L) {
+    x = (int32_t)(0x80000000UL - (uint32_t)x);
+  }
+
+  if (precision == SINE_12BIT) {
+    x >>= 15;  // Q30 to Q15
+    x2 = (x * x) >> 15;
+    result = SIN5_C5;
+    result = SIN5_C3 + ((result * x2) >> 15);
+    result = SIN5_C1 + ((result * x2) >> 15);
+    result = (result * x) >> 15;
+  }
+  else {
+    x2 = mul_q30(x, x);
+    result = SIN7_C7;
+    result = SIN7_C5 + mul_q30(result, x2);
+    result = SIN7_C3 + mul_q30(result, x2);
+    result = SIN7_C1 + mul_q30(result, x2);
+    result = (mul_q30(result, x) + (1L << 14)) >> 15;  // Q30 to Q15, rounded
+  }
+
+  // the polynomial overshoots by a fraction of an LSB at the peaks
+  if (result > SINE_MAX) {
+    return SINE_MAX;
+  }
+  if (result < -SINE_MAX) {
+    return -SINE_MAX;
+  }
+  return result;
+}
+
+// returns cos(2 * pi * phase / 2^32) in Q15, see synth_sine
+int32_t synth_cosine(uint32_t phase, int precision)
+{
+  return synth_sine(phase + 0x40000000UL, precision);
+}
@@ -0,0 +1,26 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdint.h>
+
+// phase accumulator constants: one full cycle is 2^32 counts
+#define PHASE_SCALE 2.3283064365386963e-10f  // 1 / 2^32
+
+// below this phase increment (f/fs < 1/512) the naive waveform is used: its
+// aliases are within 1 dB of what PolyBLEP leaves at 1.2 kHz, 24 - 27 dB
+// under the fundamental, see tests/synth_test.c
+#define BLEP_MIN_INC (1UL << 23)
+
+// selectable precision of the integer sine kernel
+#define SINE_12BIT 12  // 5th order polynomial, 32 bit arithmetic
+#define SINE_16BIT 16  // 7th order polynomial, 64 bit products
+
+// full scale of the Q15 sine kernel output
+#define SINE_MAX 32767
+
+float synth_square(uint32_t phase, uint32_t phase_inc, float duty_cycle);
+float synth_sawtooth(uint32_t phase, uint32_t phase_inc);
+int32_t synth_sine(uint32_t phase, int precision);
+int32_t synth_cosine(uint32_t phase, int precision);
+
+#endif
@@ -0,0 +1,103 @@
+#include "tablecache.h"
+
+/* Tablecache.c: rendered single cycle tables, least recently used first out
+ *
+ * Every table the additive synthesis builds is kept here with the settings
+ * it was built from, so going back to recent settings finds the finished
+ * table instead of building it again. When all entries are taken, a new
+ * build reuses the entry that was used longest ago.
+ *
+ * A claimed entry is not found by table_cache_find() until it is committed,
+ * so a build that is abandoned half way never shows up as a hit. All calls
+ * must come from the same context, the DEFER_ADDITIVE job.
+ */
+
+static int16_t tables[TABLE_CACHE_ENTRIES][ADDITIVE_TABLE_SIZE];
+static table_key keys[TABLE_CACHE_ENTRIES];  // count 0 marks a free entry
+static uint32_t last_used[TABLE_CACHE_ENTRIES];
+static uint32_t use_clock = 0;
+
+// mark every entry free
+void table_cache_init(void)
+{
+  int i;
+
+  for (i = 0; i < TABLE_CACHE_ENTRIES; i++) {
+    keys[i].count = 0;
+    last_used[i] = 0;
+  }
+  use_clock = 0;
+}
+
+static int same_key(const table_key* a, const table_key* b)
+{
+  int i;
+
+  if (a->count != b->count) {
+    return 0;
+  }
+  for (i = 0; i < a->count; i++) {
+    if (a->amplitude_pct[i] != b->amplitude_pct[i] ||
+        a->phase_deg[i] != b->phase_deg[i]) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* table_cache_find
+returns the table built from key and marks it as used, or 0 if there is
+none
+*/
+const int16_t* table_cache_find(const table_key* key)
+{
+  int i;
+
+  for (i = 0; i < TABLE_CACHE_ENTRIES; i++) {
+    if (keys[i].count && same_key(&keys[i], key)) {
+      last_used[i] = ++use_clock;
+      return tables[i];
+    }
+  }
+  return 0;
+}
+
+/* table_cache_claim
+returns an entry to build a new table in: a free one if there is one,
+otherwise the least recently used. keep is never handed out, pass the
+table that is being played.
+*/
+int16_t* table_cache_claim(const int16_t* keep)
+{
+  int victim = -1;
+  int i;
+
+  for (i = 0; i < TABLE_CACHE_ENTRIES; i++) {
+    if (tables[i] == keep) {
+      continue;
+    }
+    if (!keys[i].count) {
+      victim = i;
+      break;
+    }
+    if (victim < 0 || (int32_t)(last_used[i] - last_used[victim]) < 0) {
+      victim = i;
+    }
+  }
+  keys[victim].count = 0;
+  return tables[victim];
+}
+
+// make a finished table from table_cache_claim() findable under key
+void table_cache_commit(const int16_t* table, const table_key* key)
+{
+  int i;
+
+  for (i = 0; i < TABLE_CACHE_ENTRIES; i++) {
+    if (tables[i] == table) {
+      keys[i] = *key;
+      last_used[i] = ++use_clock;
+      return;
+    }
+  }
+}
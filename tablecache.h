@@ -0,0 +1,25 @@
+#ifndef TABLECACHE_H
+#define TABLECACHE_H
+
+#include <stdint.h>
+#include "additive.h"
+
+// SRAM set aside for cached single cycle tables
+#define TABLE_CACHE_BUDGET 4096
+#define TABLE_CACHE_ENTRIES \
+  ((int)(TABLE_CACHE_BUDGET / (ADDITIVE_TABLE_SIZE * sizeof(int16_t))))
+
+// the settings a table was rendered from, only the first count harmonics
+// are significant
+typedef struct table_key {
+  uint8_t count;
+  uint8_t amplitude_pct[ADDITIVE_HARMONICS];
+  uint16_t phase_deg[ADDITIVE_HARMONICS];
+} table_key;
+
+void table_cache_init(void);
+const int16_t* table_cache_find(const table_key* key);
+int16_t* table_cache_claim(const int16_t* keep);
+void table_cache_commit(const int16_t* table, const table_key* key);
+
+#endif
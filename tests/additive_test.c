@@ -0,0 +1,159 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "additive.h"
+#include "synth.h"
+#include "test.h"
+
+/* Additive_test.c: single cycle tables built from a known spectrum
+ *
+ * The harmonics are set as the HOST_HARMONIC command sets them. Each built
+ * table must match the inverse DFT of its spectrum, computed here in double
+ * and scaled to full range as the build does. The table build runs when
+ * PendSV is called by hand, and the renderer's cycle boundary is
+ * additive_cycle_boundary().
+ */
+
+// the kernel is good to about half a Q15 step, summed over the harmonics
+// and scaled up to full range
+#define TABLE_TOLERANCE 4
+
+typedef struct harmonic {
+  int number;
+  uint16_t amplitude_pct;
+  uint16_t phase_deg;
+} harmonic;
+
+static const harmonic spectrum_a[] = {
+  {1, 100, 0}, {2, 50, 90}, {3, 0, 0}, {4, 25, 180}, {5, 10, 45},
+};
+static const harmonic spectrum_b[] = {
+  {1, 30, 270}, {2, 100, 0}, {3, 60, 120},
+};
+// b with its first harmonic at 100% and 0 degrees, or its third at 100%
+static const harmonic spectrum_b1[] = {
+  {1, 100, 0}, {2, 100, 0}, {3, 60, 120},
+};
+static const harmonic spectrum_c[] = {
+  {1, 30, 270}, {2, 100, 0}, {3, 100, 120},
+};
+
+void PendSV_Handler(void);
+
+// set the harmonics of spectrum and play the first count of them
+static void set(const harmonic* spectrum, int count)
+{
+  int i;
+
+  for (i = 0; i < count; i++) {
+    additive_set_harmonic(spectrum[i].number, spectrum[i].amplitude_pct,
+                          spectrum[i].phase_deg);
+  }
+  additive_set_count(count);
+}
+
+// returns the largest difference of table from the inverse DFT of spectrum
+static int table_error(const int16_t* table, const harmonic* spectrum,
+                       int count)
+{
+  double wanted[ADDITIVE_TABLE_SIZE];
+  double peak = 0, x;
+  int error = 0;
+  int i, k;
+
+  for (i = 0; i < ADDITIVE_TABLE_SIZE; i++) {
+    wanted[i] = 0;
+    for (k = 0; k < count; k++) {
+      x = 2 * M_PI * spectrum[k].number * i / ADDITIVE_TABLE_SIZE +
+          spectrum[k].phase_deg * M_PI / 180;
+      wanted[i] += spectrum[k].amplitude_pct * sin(x);
+    }
+    if (fabs(wanted[i]) > peak) {
+      peak = fabs(wanted[i]);
+    }
+  }
+  for (i = 0; i < ADDITIVE_TABLE_SIZE; i++) {
+    k = abs(table[i] - (int)lrint(wanted[i] * SINE_MAX / peak));
+    if (k > error) {
+      error = k;
+    }
+  }
+  return error;
+}
+
+static void test_inverse_dft(void)
+{
+  int count, error;
+
+  additive_init();
+  error = table_error(additive_table(), spectrum_a, 1);
+  CHECK(error <= TABLE_TOLERANCE, "fundamental off by %d", error);
+
+  for (count = 2; count <= 5; count++) {
+    set(spectrum_a, count);
+    PendSV_Handler();
+    additive_cycle_boundary();
+    error = table_error(additive_table(), spectrum_a, count);
+    CHECK(error <= TABLE_TOLERANCE, "%d harmonics of a off by %d", count,
+          error);
+  }
+
+  set(spectrum_b, 3);
+  PendSV_Handler();
+  additive_cycle_boundary();
+  error = table_error(additive_table(), spectrum_b, 3);
+  CHECK(error <= TABLE_TOLERANCE, "spectrum b off by %d", error);
+
+  // out of range settings are limited, harmonics that do not exist ignored
+  additive_set_harmonic(3, 250, 360 + 120);
+  additive_set_harmonic(ADDITIVE_HARMONICS + 1, 100, 0);
+  additive_set_harmonic(0, 100, 0);
+  PendSV_Handler();
+  additive_cycle_boundary();
+  error = table_error(additive_table(), spectrum_c, 3);
+  CHECK(error <= TABLE_TOLERANCE, "250%% at 480 degrees off by %d", error);
+}
+
+// a new table only plays from a cycle boundary, and only the latest
+static void test_swap(void)
+{
+  const int16_t* before;
+  int16_t first;
+  int error;
+
+  additive_init();
+  set(spectrum_a, 3);
+  PendSV_Handler();
+  additive_cycle_boundary();
+  before = additive_table();
+  first = before[1];
+
+  // built, but still waiting for the boundary
+  set(spectrum_b, 3);
+  PendSV_Handler();
+  CHECK(additive_table() == before && before[1] == first,
+        "the table changed before the cycle boundary");
+
+  // changed again before the boundary: the waiting table is dropped
+  additive_set_harmonic(1, 100, 0);
+  CHECK(additive_table() == before, "the table changed with the settings");
+  additive_cycle_boundary();
+  CHECK(additive_table() == before, "a table for old settings was played");
+  PendSV_Handler();
+  additive_cycle_boundary();
+  CHECK(additive_table() != before, "the new table was not swapped in");
+  error = table_error(additive_table(), spectrum_b1, 3);
+  CHECK(error <= TABLE_TOLERANCE, "the swapped table is off by %d", error);
+
+  // a boundary with nothing new keeps the table
+  before = additive_table();
+  additive_cycle_boundary();
+  CHECK(additive_table() == before, "the table changed with no new settings");
+}
+
+int main(void)
+{
+  test_inverse_dft();
+  test_swap();
+  return test_report("additive_test");
+}
@@ -0,0 +1,207 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "analysis.h"
+#include "test.h"
+
+/* Analysis_test.c: analyse() on buffers with known content
+ *
+ * The buffers are 12 bit levels at the generator's sample rate, as long as
+ * a self-test capture. Each is checked against what it was built with:
+ *
+ * - a clean sine: only the rounding to whole codes is noise, which for an
+ *   amplitude of A codes gives an SNR of 10 log10(6 A^2)
+ * - the same sine with Gaussian noise of NOISE_RMS codes added
+ * - the sine with a second harmonic of HARMONIC_LEVEL, which is THD but
+ *   must not count as noise
+ * - a band limited square wave: its 3rd and 5th harmonics give a THD of
+ *   sqrt(1/9 + 1/25), and the 7th up to Nyquist, which analyse() does not
+ *   fit, are the noise
+ *
+ * THD is only good to about a percent, most off with the few cycles of a
+ * low frequency in the block.
+ */
+
+#define TEST_SAMPLES 1024  // SELFTEST_SAMPLES
+#define TEST_RATE 27027    // SAMPLE_RATE
+#define FULL_SCALE_MV 3300
+#define MID 2048
+#define TEST_AMPLITUDE 1000  // codes
+#define NOISE_RMS 10.0       // codes
+#define HARMONIC_LEVEL 0.1
+
+static uint16_t buffer[TEST_SAMPLES];
+static uint32_t seed = 1;
+
+// returns Gaussian noise of unit variance
+static double gaussian(void)
+{
+  double u1, u2;
+
+  seed = seed * 1664525 + 1013904223;
+  u1 = (seed + 1.0) / 4294967297.0;
+  seed = seed * 1664525 + 1013904223;
+  u2 = seed / 4294967296.0;
+  return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+static uint16_t to_code(double level)
+{
+  long code = lrint(MID + level);
+
+  return (uint16_t)(code < 0 ? 0 : code > 4095 ? 4095 : code);
+}
+
+// fill the buffer with a sine of frequency Hz, harmonic is the level of
+// its second harmonic and noise the rms of added noise, both in codes
+static void make_sine(double frequency, double harmonic, double noise)
+{
+  double w = 2 * M_PI * frequency / TEST_RATE;
+  int i;
+
+  for (i = 0; i < TEST_SAMPLES; i++) {
+    buffer[i] = to_code(TEST_AMPLITUDE * sin(w * i) +
+                        harmonic * TEST_AMPLITUDE * sin(2 * w * i) +
+                        noise * gaussian());
+  }
+}
+
+// fill the buffer with a square of frequency Hz made of all its harmonics
+// below Nyquist
+static void make_square(double frequency)
+{
+  double w = 2 * M_PI * frequency / TEST_RATE;
+  double level;
+  int i, k;
+
+  for (i = 0; i < TEST_SAMPLES; i++) {
+    level = 0;
+    for (k = 1; k * frequency < TEST_RATE / 2; k += 2) {
+      level += sin(k * w * i) / k;
+    }
+    buffer[i] = to_code(TEST_AMPLITUDE * level);
+  }
+}
+
+static double snr_db(const analysis_result* result)
+{
+  return result->snr_ddb / 10.0;
+}
+
+static void check_frequency(const analysis_result* result, double frequency)
+{
+  double measured = result->frequency_dhz / 10.0;
+
+  CHECK(fabs(measured - frequency) <= 0.2, "%.1f Hz, wanted %.1f Hz",
+        measured, frequency);
+}
+
+static void test_sine(void)
+{
+  static const double frequencies[] = {100, 1234, 4567.8};
+  analysis_result result;
+  double ideal = 10 * log10(6.0 * TEST_AMPLITUDE * TEST_AMPLITUDE);
+  int32_t amplitude_mv = TEST_AMPLITUDE * FULL_SCALE_MV / 4096;
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    make_sine(frequencies[i], 0, 0);
+    analyse(buffer, TEST_SAMPLES, TEST_RATE, FULL_SCALE_MV, 12, &result);
+    printf("sine %.1f Hz: %.1f Hz THD %u permille SNR %.1f dB\n",
+           frequencies[i], result.frequency_dhz / 10.0,
+           (unsigned)result.thd_permille, snr_db(&result));
+    check_frequency(&result, frequencies[i]);
+    CHECK(result.thd_permille <= 10, "clean sine THD %u permille",
+          (unsigned)result.thd_permille);
+    CHECK(fabs(snr_db(&result) - ideal) <= 3,
+          "clean sine SNR %.1f dB, wanted %.1f dB", snr_db(&result), ideal);
+    CHECK(abs(result.amplitude_mv - amplitude_mv) <= 2,
+          "amplitude %d mV, wanted %d mV", (int)result.amplitude_mv,
+          (int)amplitude_mv);
+    CHECK(abs(result.offset_mv - FULL_SCALE_MV / 2) <= 2, "offset %d mV",
+          (int)result.offset_mv);
+  }
+}
+
+static void test_noise(void)
+{
+  analysis_result result;
+  double wanted = 10 * log10(TEST_AMPLITUDE * TEST_AMPLITUDE / 2.0 /
+                             (NOISE_RMS * NOISE_RMS + 1 / 12.0));
+
+  make_sine(1234, 0, NOISE_RMS);
+  analyse(buffer, TEST_SAMPLES, TEST_RATE, FULL_SCALE_MV, 12, &result);
+  printf("noisy sine: SNR %.1f dB, wanted %.1f dB\n", snr_db(&result),
+         wanted);
+  check_frequency(&result, 1234);
+  CHECK(fabs(snr_db(&result) - wanted) <= 1.0,
+        "noisy sine SNR %.1f dB, wanted %.1f dB", snr_db(&result), wanted);
+}
+
+static void test_harmonic(void)
+{
+  analysis_result result;
+  uint32_t wanted = (uint32_t)(1000 * HARMONIC_LEVEL);
+
+  make_sine(1234, HARMONIC_LEVEL, 0);
+  analyse(buffer, TEST_SAMPLES, TEST_RATE, FULL_SCALE_MV, 12, &result);
+  printf("sine with harmonic: THD %u permille SNR %.1f dB\n",
+         (unsigned)result.thd_permille, snr_db(&result));
+  check_frequency(&result, 1234);
+  CHECK(abs((int)result.thd_permille - (int)wanted) <= wanted / 10,
+        "THD %u permille, wanted %u", (unsigned)result.thd_permille,
+        (unsigned)wanted);
+  CHECK(snr_db(&result) >= 60, "the harmonic counted as noise, SNR %.1f dB",
+        snr_db(&result));
+}
+
+static void test_square(void)
+{
+  analysis_result result;
+  uint32_t thd = (uint32_t)lrint(1000 * sqrt(1 / 9.0 + 1 / 25.0));
+  double noise = 0, wanted;
+  int k;
+
+  for (k = 7; k * 500 < TEST_RATE / 2; k += 2) {
+    noise += 1.0 / (k * k);
+  }
+  wanted = -10 * log10(noise);
+  make_square(500);
+  analyse(buffer, TEST_SAMPLES, TEST_RATE, FULL_SCALE_MV, 12, &result);
+  printf("square: THD %u permille, wanted %u, SNR %.1f dB, wanted %.1f dB\n",
+         (unsigned)result.thd_permille, (unsigned)thd, snr_db(&result),
+         wanted);
+  check_frequency(&result, 500);
+  CHECK(abs((int)result.thd_permille - (int)thd) <= 20,
+        "square THD %u permille, wanted %u", (unsigned)result.thd_permille,
+        (unsigned)thd);
+  CHECK(fabs(snr_db(&result) - wanted) <= 1.0,
+        "square SNR %.1f dB, wanted %.1f dB", snr_db(&result), wanted);
+}
+
+static void test_no_signal(void)
+{
+  analysis_result result;
+  int i;
+
+  for (i = 0; i < TEST_SAMPLES; i++) {
+    buffer[i] = MID;
+  }
+  analyse(buffer, TEST_SAMPLES, TEST_RATE, FULL_SCALE_MV, 12, &result);
+  CHECK(result.frequency_dhz == 0, "DC reads %u dHz",
+        (unsigned)result.frequency_dhz);
+  CHECK(result.thd_permille == 0 && result.snr_ddb == 0,
+        "DC has THD %u permille, SNR %u ddB", (unsigned)result.thd_permille,
+        (unsigned)result.snr_ddb);
+}
+
+int main(void)
+{
+  test_sine();
+  test_noise();
+  test_harmonic();
+  test_square();
+  test_no_signal();
+  return test_report("analysis_test");
+}
@@ -0,0 +1,279 @@
+#include <math.h>
+#include <stdint.h>
+#include "counter.h"
+#include "msp.h"
+#include "test.h"
+
+/* Counter_test.c: the reciprocal counter against simulated edges
+ *
+ * A square input of a given frequency is turned into SMCLK tick times.
+ * Timer overflows and edge captures reach TA1_N_IRQHandler in time order
+ * through the TIMER_A1 stand-in, and counter_poll() runs every POLL_MS as
+ * the counter task does. An edge just after a wrap is captured before the
+ * overflow interrupt has run, with the overflow flag still set, as happens
+ * when the two come together. SMCLK can be run off its nominal frequency,
+ * and dco_error_ppm() is the test's, to check the correction.
+ *
+ * Readings must be good to a tick of the gate and a mHz, and stop at
+ * COUNTER_OVERRANGE above the 100 kHz the interrupt load allows.
+ */
+
+#define SMCLK_HZ 24000000.0  // MHZ_24
+#define POLL_MS 100          // the counter task's period
+#define IV_CAPTURE 0x02
+#define IV_OVERFLOW 0x0E
+// an edge this soon after the timer wraps is captured before the overflow
+// interrupt is taken
+#define LATE_TICKS 64
+
+void TA1_N_IRQHandler(void);
+
+static uint32_t now_ms;
+static int32_t dco_ppm;      // the error dco.c reports
+static double clock_hz;      // what SMCLK really runs at
+static uint64_t now_ticks;   // SMCLK ticks since the counter started
+static uint64_t wraps;       // overflows handed to the interrupt
+static double next_edge;     // in ticks, or -1 without a signal
+static double edge_ticks;    // ticks per input period
+static int readings;         // counter_poll() results
+
+uint32_t sched_now(void)
+{
+  return now_ms;
+}
+
+int32_t dco_error_ppm(void)
+{
+  return dco_ppm;
+}
+
+static void interrupt(uint16_t iv)
+{
+  *(volatile uint16_t*)&TIMER_A1->IV = iv;
+  TA1_N_IRQHandler();
+}
+
+static void overflow(void)
+{
+  wraps++;
+  interrupt(IV_OVERFLOW);
+  TIMER_A1->CTL &= ~TIMER_A_CTL_IFG;
+}
+
+static void capture(uint64_t tick)
+{
+  if (!(TIMER_A1->CCTL[COUNTER_CCR] & TIMER_A_CCTLN_CCIE)) {
+    return;  // capturing stopped
+  }
+  TIMER_A1->CCR[COUNTER_CCR] = (uint16_t)tick;
+  interrupt(IV_CAPTURE);
+}
+
+// start the counter on an input of frequency Hz, 0 for none, with SMCLK
+// off by clock_ppm
+static void start(double frequency, double clock_ppm)
+{
+  now_ms = 0;
+  now_ticks = 0;
+  wraps = 0;
+  readings = 0;
+  clock_hz = SMCLK_HZ * (1 + clock_ppm * 1e-6);
+  edge_ticks = frequency > 0 ? clock_hz / frequency : 0;
+  // not in step with the timer
+  next_edge = frequency > 0 ? 10.5 : -1;
+  TIMER_A1->CTL = 0;
+  TIMER_A1->CCTL[COUNTER_CCR] = 0;
+  counter_start();
+}
+
+// run for ms milliseconds
+static void run(uint32_t ms)
+{
+  uint64_t wrap, edge, ms_tick;
+  uint32_t end = now_ms + ms;
+
+  while (now_ms < end) {
+    ms_tick = (uint64_t)((now_ms + 1) * clock_hz / 1000);
+    wrap = (wraps + 1) << 16;
+    edge = next_edge >= 0 ? (uint64_t)next_edge : UINT64_MAX;
+
+    if (wrap <= ms_tick && wrap <= edge) {
+      if (edge < wrap + LATE_TICKS) {
+        // the edge comes in while the overflow still waits
+        TIMER_A1->CTL |= TIMER_A_CTL_IFG;
+        capture(edge);
+        next_edge += edge_ticks;
+      }
+      now_ticks = wrap;
+      overflow();
+    }
+    else if (edge <= ms_tick) {
+      now_ticks = edge;
+      capture(edge);
+      next_edge += edge_ticks;
+    }
+    else {
+      now_ticks = ms_tick;
+      now_ms++;
+      if (now_ms % POLL_MS == 0) {
+        readings += counter_poll();
+      }
+    }
+  }
+}
+
+// the reading of frequency is within a tick of the gate and a mHz
+static void check_reading(double frequency)
+{
+  counter_result result;
+  double wanted_mhz = frequency * 1000;
+  double wanted_ns = 1e9 / frequency;
+  // the gate lasts at least a second and holds at least one period
+  double gate_ticks = fmax(SMCLK_HZ, edge_ticks);
+  double tolerance = 2 / gate_ticks;
+
+  counter_read(&result);
+  CHECK(result.status == COUNTER_OK, "%.3f Hz: status %d", frequency,
+        result.status);
+  CHECK(fabs(result.frequency_mhz - wanted_mhz) <= wanted_mhz * tolerance + 1,
+        "%.3f Hz read as %u mHz", frequency, (unsigned)result.frequency_mhz);
+  CHECK(fabs(result.period_ns - wanted_ns) <= wanted_ns * tolerance + 1,
+        "%.3f Hz: period %u ns, wanted %.0f", frequency,
+        (unsigned)result.period_ns, wanted_ns);
+}
+
+static void test_frequencies(void)
+{
+  static const double frequencies[] = {
+    0.5, 1, 50, 1000, 12345.678, 27027, 99000,
+  };
+  int i;
+
+  for (i = 0; i < 7; i++) {
+    start(frequencies[i], 0);
+    run(3 * COUNTER_GATE_MS + 2 * 1000 / frequencies[i]);
+    CHECK(readings >= 2, "%.3f Hz: %d readings", frequencies[i], readings);
+    check_reading(frequencies[i]);
+    counter_stop();
+  }
+}
+
+// the edge that ends a gate comes just after a wrap, before the overflow
+// interrupt: its time is in the next 65536 ticks
+static void test_late_overflow(void)
+{
+  double period = 65536 * 300 + 30010;
+
+  start(SMCLK_HZ / period, 0);
+  next_edge = 65536 * 3 - 30000 + 0.5;
+  run(COUNTER_GATE_MS + POLL_MS);
+  CHECK(readings == 1, "%d readings", readings);
+  check_reading(SMCLK_HZ / period);
+  counter_stop();
+}
+
+// SMCLK off its frequency: right once dco.c knows by how much, off by as
+// much without
+static void test_clock_error(void)
+{
+  counter_result result;
+  int32_t ppm;
+
+  dco_ppm = 1500;
+  start(1000, 1500);
+  run(3 * COUNTER_GATE_MS);
+  check_reading(1000);
+
+  dco_ppm = 0;
+  run(3 * COUNTER_GATE_MS);
+  counter_read(&result);
+  ppm = counter_error_ppm(&result, 1000);
+  CHECK(ppm >= -1499 && ppm <= -1497, "1500 ppm fast uncorrected: %d ppm",
+        (int)ppm);
+  counter_stop();
+}
+
+// above 100 kHz the reading is COUNTER_OVERRANGE, and a slower input reads
+// again after it
+static void test_overrange(void)
+{
+  counter_result result;
+
+  start(150000, 0);
+  run(2 * COUNTER_GATE_MS);
+  counter_read(&result);
+  CHECK(result.status == COUNTER_OVERRANGE, "150 kHz: status %d",
+        result.status);
+
+  start(500000, 0);
+  run(2 * COUNTER_GATE_MS);
+  counter_read(&result);
+  CHECK(result.status == COUNTER_OVERRANGE, "500 kHz: status %d",
+        result.status);
+
+  // down to 1 kHz, capturing starts again at the next gate
+  edge_ticks = SMCLK_HZ / 1000;
+  next_edge = now_ticks + 100.5;
+  run(3 * COUNTER_GATE_MS);
+  check_reading(1000);
+
+  // edges lost: an edge came before the last was read
+  TIMER_A1->CCTL[COUNTER_CCR] |= TIMER_A_CCTLN_COV;
+  run(COUNTER_GATE_MS);
+  counter_read(&result);
+  CHECK(result.status == COUNTER_OVERRANGE, "lost edges: status %d",
+        result.status);
+  counter_stop();
+}
+
+static void test_no_signal(void)
+{
+  counter_result result;
+
+  start(0, 0);
+  run(COUNTER_TIMEOUT_MS - POLL_MS);
+  CHECK(readings == 0, "%d readings before the timeout", readings);
+  run(2 * POLL_MS);
+  counter_read(&result);
+  CHECK(readings == 1 && result.status == COUNTER_NO_SIGNAL,
+        "no signal: %d readings, status %d", readings, result.status);
+  counter_stop();
+}
+
+static void test_error_ppm(void)
+{
+  static const struct {
+    uint32_t frequency_mhz;
+    uint32_t expected_hz;
+    int32_t ppm;
+  } cases[] = {
+    {1000000, 1000, 0},          {1000001, 1000, 1},
+    {999999, 1000, -1},          {1001500, 1000, 1500},
+    {500000000, 500000, 0},      {499999000, 500000, -2},
+    {12345678, 12346, -26},      {1000, 2, -500000},
+    {0, 1000, -1000000},
+  };
+  counter_result result;
+  int32_t ppm;
+  int i;
+
+  result.status = COUNTER_OK;
+  for (i = 0; i < 9; i++) {
+    result.frequency_mhz = cases[i].frequency_mhz;
+    ppm = counter_error_ppm(&result, cases[i].expected_hz);
+    CHECK(ppm == cases[i].ppm, "%u mHz against %u Hz: %d ppm, wanted %d",
+          (unsigned)cases[i].frequency_mhz, (unsigned)cases[i].expected_hz,
+          (int)ppm, (int)cases[i].ppm);
+  }
+}
+
+int main(void)
+{
+  test_frequencies();
+  test_late_overflow();
+  test_clock_error();
+  test_overrange();
+  test_no_signal();
+  test_error_ppm();
+  return test_report("counter_test");
+}
@@ -0,0 +1,278 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "fmt.h"
+#include "lcd.h"
+#include "test.h"
+
+/* Fmt_test.c: the LCD formatter against snprintf
+ *
+ * Every fmt_ function is run over edge values, 0, negatives, the extremes
+ * of its type and fields narrower and wider than the value, and must write
+ * the same bytes as the snprintf format it stands in for. Fields are never
+ * cut, as with printf, and nothing may be written past the returned end.
+ * Long lines are cut by LCD_write_strings(), checked against snprintf into
+ * a line sized buffer.
+ *
+ * "fmt_test bench" gives the host cycles per call of fmt_ and of snprintf
+ * for the same fields.
+ */
+
+#define OUT_SIZE 64
+#define GUARD '\x7f'
+#define BENCH_CALLS 2000000
+
+static const uint32_t unsigned_values[] = {
+  0, 1, 9, 10, 99, 100, 9999, 10000, 12345, 99999, 1000000, 2147483648u,
+  UINT32_MAX,
+};
+static const int32_t signed_values[] = {
+  0, 1, -1, 5, -5, 9, -9, 10, -10, 99, -99, 1250, -1250, 1650, -1650,
+  123456, -123456, INT32_MAX, -INT32_MAX, INT32_MIN,
+};
+static const int widths[] = {0, 1, 2, 3, 5, 6, 8, 10, 11, 12, 14, 20};
+
+#define COUNT(array) ((int)(sizeof(array) / sizeof(array[0])))
+
+static char out[OUT_SIZE];
+
+static char* clean(void)
+{
+  memset(out, GUARD, sizeof(out));
+  return out;
+}
+
+// compare what fmt_ wrote up to end with wanted, and the guard after it
+static void check(const char* end, const char* wanted, const char* call)
+{
+  int length = end - out;
+  int wanted_length = strlen(wanted);
+
+  CHECK(length == wanted_length && memcmp(out, wanted, length) == 0 &&
+        out[length] == GUARD,
+        "%s: \"%.*s\", wanted \"%s\"", call, length > 0 ? length : 0, out,
+        wanted);
+}
+
+// printf width of a field with unit characters after it, as fmt_ pads
+static int field(int width, int unit)
+{
+  return width > unit ? width - unit : 0;
+}
+
+// snprintf for fmt_fixed: the sign, whole part, point and decimals
+static void ref_fixed(char* ref, int32_t value, int decimals, int width)
+{
+  uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+  uint32_t scale = 1;
+  char body[OUT_SIZE];
+  int i;
+
+  for (i = 0; i < decimals; i++) {
+    scale *= 10;
+  }
+  if (decimals) {
+    snprintf(body, sizeof(body), "%s%u.%0*u", value < 0 ? "-" : "",
+             (unsigned)(magnitude / scale), decimals,
+             (unsigned)(magnitude % scale));
+  }
+  else {
+    snprintf(body, sizeof(body), "%s%u", value < 0 ? "-" : "",
+             (unsigned)magnitude);
+  }
+  snprintf(ref, OUT_SIZE, "%*s", width, body);
+}
+
+static void test_str(void)
+{
+  static const char* texts[] = {"", "A", "FREQ  DC  WAVE", "ppm\r\n"};
+  char ref[OUT_SIZE], call[OUT_SIZE];
+  int i, w;
+
+  for (i = 0; i < COUNT(texts); i++) {
+    for (w = 0; w < COUNT(widths); w++) {
+      snprintf(ref, sizeof(ref), "%-*s", widths[w], texts[i]);
+      snprintf(call, sizeof(call), "fmt_str(\"%s\", %d)", texts[i],
+               widths[w]);
+      check(fmt_str(clean(), texts[i], widths[w]), ref, call);
+    }
+  }
+}
+
+static void test_uint(void)
+{
+  char ref[OUT_SIZE], call[OUT_SIZE];
+  uint32_t value;
+  int i, w;
+
+  for (i = 0; i < COUNT(unsigned_values); i++) {
+    value = unsigned_values[i];
+    for (w = 0; w < COUNT(widths); w++) {
+      snprintf(ref, sizeof(ref), "%*u", widths[w], (unsigned)value);
+      snprintf(call, sizeof(call), "fmt_uint(%u, %d, ' ')", (unsigned)value,
+               widths[w]);
+      check(fmt_uint(clean(), value, widths[w], ' '), ref, call);
+
+      snprintf(ref, sizeof(ref), "%0*u", widths[w], (unsigned)value);
+      snprintf(call, sizeof(call), "fmt_uint(%u, %d, '0')", (unsigned)value,
+               widths[w]);
+      check(fmt_uint(clean(), value, widths[w], '0'), ref, call);
+    }
+  }
+}
+
+static void test_int(void)
+{
+  char ref[OUT_SIZE], call[OUT_SIZE];
+  int32_t value;
+  int i, w, decimals;
+
+  for (i = 0; i < COUNT(signed_values); i++) {
+    value = signed_values[i];
+    for (w = 0; w < COUNT(widths); w++) {
+      snprintf(ref, sizeof(ref), "%*d", widths[w], (int)value);
+      snprintf(call, sizeof(call), "fmt_int(%d, %d)", (int)value, widths[w]);
+      check(fmt_int(clean(), value, widths[w]), ref, call);
+
+      for (decimals = 1; decimals <= 3; decimals++) {
+        ref_fixed(ref, value, decimals, widths[w]);
+        snprintf(call, sizeof(call), "fmt_fixed(%d, %d, %d)", (int)value,
+                 decimals, widths[w]);
+        check(fmt_fixed(clean(), value, decimals, widths[w]), ref, call);
+      }
+    }
+  }
+}
+
+// the fields with a unit
+static void test_units(void)
+{
+  char ref[OUT_SIZE], call[OUT_SIZE];
+  uint32_t value;
+  int32_t millivolts;
+  int i, w, width;
+
+  for (i = 0; i < COUNT(unsigned_values); i++) {
+    value = unsigned_values[i];
+    for (w = 0; w < COUNT(widths); w++) {
+      width = widths[w];
+      if (value < 10000) {
+        ref_fixed(ref, value, 0, field(width, 2));
+        strcat(ref, "Hz");
+      }
+      else {
+        ref_fixed(ref, value / 10, 2, field(width, 3));
+        strcat(ref, "kHz");
+      }
+      snprintf(call, sizeof(call), "fmt_hz(%u, %d)", (unsigned)value, width);
+      check(fmt_hz(clean(), value, width), ref, call);
+
+      snprintf(ref, sizeof(ref), "%*u%%", field(width, 1), (unsigned)value);
+      snprintf(call, sizeof(call), "fmt_percent(%u, %d)", (unsigned)value,
+               width);
+      check(fmt_percent(clean(), value, width), ref, call);
+    }
+  }
+
+  for (i = 0; i < COUNT(signed_values); i++) {
+    millivolts = signed_values[i];
+    for (w = 0; w < COUNT(widths); w++) {
+      width = widths[w];
+      // whole centivolts, -5 mV is 0.00V
+      ref_fixed(ref, millivolts / 10, 2, field(width, 1));
+      strcat(ref, "V");
+      snprintf(call, sizeof(call), "fmt_volts(%d, %d)", (int)millivolts,
+               width);
+      check(fmt_volts(clean(), millivolts, width), ref, call);
+    }
+  }
+}
+
+// a line longer than the display is cut, a shorter one padded with spaces
+static void test_truncation(void)
+{
+  static const char* lines[] = {
+    "", "1000  50 SQUARE", "12345678901234567890", "123456789012345678901",
+    "F=4294967.295Hz T=4294967295ns",
+  };
+  char ref[LCD_LINESIZE + 1];
+  char text[OUT_SIZE];
+  int i;
+
+  for (i = 0; i < COUNT(lines); i++) {
+    strcpy(text, lines[i]);
+    LCD_write_strings(text, 0);
+    snprintf(ref, sizeof(ref), "%-*s", LCD_LINESIZE, lines[i]);
+    CHECK(memcmp(LCD_line(0), ref, LCD_LINESIZE) == 0,
+          "line \"%s\" shown as \"%.*s\", wanted \"%s\"", lines[i],
+          LCD_LINESIZE, LCD_line(0), ref);
+  }
+}
+
+// returns host cycles per call of one field, even sources fmt_ and odd
+// ones the same field through snprintf
+static double bench_field(int source)
+{
+  volatile char sink;
+  uint32_t value = 0;
+  uint64_t start = test_cycles();
+  long i;
+
+  for (i = 0; i < BENCH_CALLS; i++) {
+    switch (source) {
+    case 0:
+      fmt_uint(out, value, 5, ' ');
+      break;
+    case 1:
+      snprintf(out, sizeof(out), "%5u", (unsigned)value);
+      break;
+    case 2:
+      fmt_fixed(out, (int32_t)value - 50000, 3, 0);
+      break;
+    case 3:
+      ref_fixed(out, (int32_t)value - 50000, 3, 0);
+      break;
+    case 4:
+      fmt_hz(out, value, 0);
+      break;
+    default:
+      if (value < 10000) {
+        snprintf(out, sizeof(out), "%uHz", (unsigned)value);
+      }
+      else {
+        snprintf(out, sizeof(out), "%u.%02ukHz", (unsigned)(value / 1000),
+                 (unsigned)(value / 10 % 100));
+      }
+      break;
+    }
+    sink = out[0];
+    value = (value + 7919) % 100000;
+  }
+  (void)sink;
+  return (double)(test_cycles() - start) / BENCH_CALLS;
+}
+
+static void bench(void)
+{
+  printf("host cycles per call, fmt_ / snprintf:\n");
+  printf("  unsigned, width 5   %6.1f  %6.1f\n", bench_field(0),
+         bench_field(1));
+  printf("  fixed, 3 decimals   %6.1f  %6.1f\n", bench_field(2),
+         bench_field(3));
+  printf("  frequency           %6.1f  %6.1f\n", bench_field(4),
+         bench_field(5));
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    bench();
+    return 0;
+  }
+  test_str();
+  test_uint();
+  test_int();
+  test_units();
+  test_truncation();
+  return test_report("fmt_test");
+}
@@ -0,0 +1,211 @@
+#include <stdint.h>
+#include <string.h>
+#include "diag.h"
+#include "governor.h"
+#include "lcd.h"
+#include "render.h"
+#include "test.h"
+
+/* Governor_test.c: the sample rate governor against a given load
+ *
+ * Each poll() adds POLL_SAMPLES samples of a given cost in cycles to the
+ * diag counters, as the sample ISR and the renderer do, and runs
+ * governor_poll(). The periods it sets are kept as render_set_sample_period()
+ * receives them. Costs are picked either side of the limits: above
+ * GOVERNOR_HIGH_PCT of the period in use the rate drops one level per poll,
+ * and only GOVERNOR_CALM_WINDOWS polls in a row under GOVERNOR_LOW_PCT of
+ * the faster period raise it one level. In between nothing changes.
+ */
+
+#define POLL_SAMPLES 500
+#define LONG_RUN 1000  // polls, far more than any change needs
+
+static const uint16_t periods[GOVERNOR_LEVELS] = GOVERNOR_PERIODS;
+static uint32_t period = SAMPLE_PERIOD;  // last period set
+static int changes;                      // render_set_sample_period() calls
+static char lcd_line[LCD_LINESIZE];
+
+void render_set_sample_period(uint32_t next)
+{
+  period = next;
+  changes++;
+}
+
+char* LCD_line(int line)
+{
+  return lcd_line;
+}
+
+// one poll of samples that cost cycles each, with an underrun if trouble
+static void poll(uint32_t cycles, int trouble)
+{
+  diag.render_samples += POLL_SAMPLES;
+  diag.isr_cycles_total += cycles * POLL_SAMPLES / 4;
+  diag.render_cycles += cycles * POLL_SAMPLES - cycles * POLL_SAMPLES / 4;
+  if (trouble) {
+    diag.underruns++;
+  }
+  governor_poll();
+}
+
+// returns the governor level of the last period set
+static int level(void)
+{
+  int i;
+
+  for (i = 0; i < GOVERNOR_LEVELS; i++) {
+    if (periods[i] == period) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// back to the full rate with a fresh count of calm polls
+static void start(void)
+{
+  governor_hold(1);
+  governor_hold(0);
+  poll(0, 0);
+  changes = 0;
+}
+
+// cost just over the high limit of level, or just under the low limit for
+// going up from it
+static uint32_t high_cost(int at)
+{
+  return periods[at] * GOVERNOR_HIGH_PCT / 100 + 1;
+}
+
+static uint32_t low_cost(int at)
+{
+  return periods[at - 1] * GOVERNOR_LOW_PCT / 100 - 1;
+}
+
+// one level down per poll while the cost is high, and no further than the
+// slowest rate
+static void test_step_down(void)
+{
+  int i;
+
+  start();
+  for (i = 1; i < GOVERNOR_LEVELS; i++) {
+    poll(high_cost(i - 1), 0);
+    CHECK(level() == i, "a high cost at level %d went to level %d", i - 1,
+          level());
+  }
+  for (i = 0; i < LONG_RUN; i++) {
+    poll(2 * periods[GOVERNOR_LEVELS - 1], 1);
+  }
+  CHECK(level() == GOVERNOR_LEVELS - 1 && changes == GOVERNOR_LEVELS - 1,
+        "overloaded at the slowest rate: level %d after %d changes", level(),
+        changes);
+
+  // an underrun or overrun steps down at any cost
+  start();
+  poll(0, 1);
+  CHECK(level() == 1, "an underrun went to level %d", level());
+  diag.isr_overruns++;
+  poll(0, 0);
+  CHECK(level() == 2, "an overrun went to level %d", level());
+}
+
+// up one level after GOVERNOR_CALM_WINDOWS calm polls in a row, never above
+// the full rate
+static void test_step_up(void)
+{
+  int at, i;
+
+  start();
+  for (i = 1; i < GOVERNOR_LEVELS; i++) {
+    poll(high_cost(i - 1), 0);
+  }
+  for (at = GOVERNOR_LEVELS - 1; at > 0; at--) {
+    for (i = 1; i < GOVERNOR_CALM_WINDOWS; i++) {
+      poll(low_cost(at), 0);
+    }
+    CHECK(level() == at, "level %d left after %d calm polls", at,
+          GOVERNOR_CALM_WINDOWS - 1);
+    poll(low_cost(at), 0);
+    CHECK(level() == at - 1, "level %d went to %d after %d calm polls", at,
+          level(), GOVERNOR_CALM_WINDOWS);
+  }
+
+  changes = 0;
+  for (i = 0; i < LONG_RUN; i++) {
+    poll(0, 0);
+  }
+  CHECK(level() == 0 && changes == 0, "idle at the full rate: level %d",
+        level());
+}
+
+// between the limits the rate stays where it is, and a poll over the low
+// limit starts the count of calm polls again
+static void test_hysteresis(void)
+{
+  int i;
+
+  start();
+  poll(high_cost(0), 0);
+  changes = 0;
+  for (i = 0; i < LONG_RUN; i++) {
+    poll(low_cost(1) + 2, 0);
+    poll(high_cost(1) - 2, 0);
+  }
+  CHECK(changes == 0 && level() == 1, "%d changes between the limits",
+        changes);
+
+  for (i = 0; i < 3 * GOVERNOR_CALM_WINDOWS; i++) {
+    poll(i % GOVERNOR_CALM_WINDOWS == GOVERNOR_CALM_WINDOWS - 1
+             ? low_cost(1) + 2 : low_cost(1), 0);
+  }
+  CHECK(changes == 0, "up after %d calm polls with a break",
+        GOVERNOR_CALM_WINDOWS - 1);
+}
+
+// held, the full rate stays under any load; no samples, no decision
+static void test_hold(void)
+{
+  int i;
+
+  start();
+  poll(high_cost(0), 0);
+  poll(high_cost(1), 0);
+  governor_hold(1);
+  CHECK(level() == 0, "hold left level %d", level());
+  changes = 0;
+  for (i = 0; i < LONG_RUN; i++) {
+    poll(2 * periods[0], 1);
+  }
+  CHECK(changes == 0, "%d changes while held", changes);
+  governor_hold(0);
+
+  for (i = 0; i < LONG_RUN; i++) {
+    governor_poll();
+  }
+  CHECK(changes == 0, "%d changes without samples", changes);
+}
+
+static void test_status(void)
+{
+  char out[8];
+
+  start();
+  memset(out, 0, sizeof(out));
+  governor_status(out);
+  CHECK(strcmp(out, "27k ") == 0, "full rate shown as \"%s\"", out);
+  poll(high_cost(0), 0);
+  memset(out, 0, sizeof(out));
+  governor_status(out);
+  CHECK(strcmp(out, "20k*") == 0, "level 1 shown as \"%s\"", out);
+}
+
+int main(void)
+{
+  test_step_down();
+  test_step_up();
+  test_hysteresis();
+  test_hold();
+  test_status();
+  return test_report("governor_test");
+}
@@ -0,0 +1,118 @@
+/* Register bit values used by the firmware, see msp432p401r.h */
+#define TIMER_A_CCTLN_CCIE 0x0010
+#define TIMER_A_CCTLN_CCIFG 0x0001
+#define TIMER_A_CCTLN_COV 0x0002
+#define TIMER_A_CCTLN_OUT 0x0004
+#define TIMER_A_CCTLN_CCI 0x0008
+#define TIMER_A_CCTLN_OUTMOD_0 0x0000
+#define TIMER_A_CCTLN_OUTMOD_3 0x0060
+#define TIMER_A_CCTLN_OUTMOD_4 0x0080
+#define TIMER_A_CCTLN_OUTMOD_7 0x00E0
+#define TIMER_A_CCTLN_CAP 0x0100
+#define TIMER_A_CCTLN_SCS 0x0800
+#define TIMER_A_CCTLN_CCIS_0 0x0000
+#define TIMER_A_CCTLN_CCIS_1 0x1000
+#define TIMER_A_CCTLN_CM_1 0x4000
+#define TIMER_A_CCTLN_CM_3 0xC000
+#define TIMER_A_CTL_SSEL__TACLK 0x0000
+#define TIMER_A_CTL_SSEL__ACLK 0x0100
+#define TIMER_A_CTL_SSEL__SMCLK 0x0200
+#define TIMER_A_CTL_MC__STOP 0x0000
+#define TIMER_A_CTL_MC__UP 0x0010
+#define TIMER_A_CTL_MC__CONTINUOUS 0x0020
+#define TIMER_A_CTL_CLR 0x0004
+#define TIMER_A_CTL_IE 0x0002
+#define TIMER_A_CTL_IFG 0x0001
+#define TIMER_A_CTL_ID__1 0x0000
+#define TIMER_A_CTL_ID__2 0x0040
+#define TIMER_A_CTL_ID__4 0x0080
+#define TIMER_A_CTL_ID__8 0x00C0
+#define TIMER_A_CTL_ID_MASK 0x00C0
+#define TIMER_A_CTL_ID_OFS 6
+#define EUSCI_B_CTLW0_SWRST 1
+#define EUSCI_B_CTLW0_MST 0x0800
+#define EUSCI_B_CTLW0_SYNC 0x0100
+#define EUSCI_B_CTLW0_CKPL 0x4000
+#define EUSCI_B_CTLW0_UCSSEL_2 0x0080
+#define EUSCI_B_CTLW0_MSB 0x2000
+#define EUSCI_B_IFG_TXIFG 2
+#define EUSCI_B_IFG_RXIFG 1
+#define EUSCI_B_STATW_BBUSY 0x0001
+#define EUSCI_A_CTLW0_SWRST 1
+#define EUSCI_A_CTLW0_SSEL__SMCLK 0x0080
+#define EUSCI_A_MCTLW_OS16 1
+#define EUSCI_A_MCTLW_BRF_OFS 4
+#define EUSCI_A_MCTLW_BRS_OFS 8
+#define EUSCI_A_IE_RXIE 1
+#define EUSCI_A_IFG_RXIFG 1
+#define EUSCI_A_IFG_TXIFG 2
+#define CS_KEY_VAL 0x695A
+#define CS_CTL0_DCORSEL_0 0
+#define CS_CTL0_DCORSEL_1 0x00010000
+#define CS_CTL0_DCORSEL_2 0x00020000
+#define CS_CTL0_DCORSEL_3 0x00030000
+#define CS_CTL0_DCORSEL_4 0x00040000
+#define CS_CTL0_DCORSEL_MASK 0x00070000
+#define CS_CTL0_DCOTUNE_MASK 0x000003FF
+#define CS_CTL0_DCOTUNE_OFS 0
+#define CS_CTL1_SELA_0 0
+#define CS_CTL1_SELA_2 0x00000200
+#define CS_CTL1_SELA_MASK 0x00000700
+#define CS_CTL1_SELS_3 0x00000030
+#define CS_CTL1_SELM_3 0x00000003
+#define CS_CTL2_LFXT_EN 0x00000100
+#define CS_CTL2_LFXTDRIVE_3 0x00000003
+#define CS_IFG_LFXTIFG 1
+#define CS_CLRIFG_CLR_LFXTIFG 1
+#define CS_STAT_ACLK_READY (1UL<<24)
+#define WDT_A_CTL_PW 0x5A00
+#define WDT_A_CTL_HOLD 0x0080
+typedef struct {
+  __IO uint32_t LOAD;
+  __I uint32_t VALUE;
+  __IO uint32_t CONTROL;
+  __O uint32_t INTCLR;
+  __I uint32_t RIS, MIS;
+  __IO uint32_t BGLOAD;
+} Timer32_Type;
+extern Timer32_Type *TIMER32_1, *TIMER32_2;
+#define TIMER32_CONTROL_ENABLE 0x80
+#define TIMER32_CONTROL_MODE 0x40
+#define TIMER32_CONTROL_IE 0x20
+#define TIMER32_CONTROL_SIZE 0x02
+#define FLCTL_PRG_CTLSTAT_ENABLE 1
+#define FLCTL_PRG_CTLSTAT_MODE 2
+#define FLCTL_ERASE_CTLSTAT_START 1
+#define FLCTL_ERASE_CTLSTAT_MODE 2
+#define FLCTL_ERASE_CTLSTAT_TYPE_MASK 0xC
+#define FLCTL_ERASE_CTLSTAT_CLR_STAT (1UL<<19)
+#define FLCTL_ERASE_CTLSTAT_ADDR_ERR (1UL<<18)
+#define FLCTL_IFG_PRG (1UL<<1)
+#define FLCTL_IFG_ERASE (1UL<<5)
+#define FLCTL_IFG_PRG_ERR (1UL<<9)
+#define FLCTL_CLRIFG_PRG (1UL<<1)
+#define FLCTL_CLRIFG_ERASE (1UL<<5)
+#define FLCTL_CLRIFG_PRG_ERR (1UL<<9)
+#define EUSCI_A_CTLW0_SWRST 1
+#define EUSCI_A_MCTLW_OS16 1
+#define EUSCI_A_MCTLW_BRF_OFS 4
+#define EUSCI_A_MCTLW_BRS_OFS 8
+#define EUSCI_A_IE_RXIE 1
+#define EUSCI_A_IFG_RXIFG 1
+#define EUSCI_A_IFG_TXIFG 2
+#define EUSCI_A_STATW_RXERR 4
+#define ADC14_CTL0_ON (1UL<<4)
+#define ADC14_CTL0_ENC (1UL<<1)
+#define ADC14_CTL0_SHP (1UL<<26)
+#define ADC14_CTL0_SHS_1 (1UL<<27)
+#define ADC14_CTL0_CONSEQ_2 (2UL<<17)
+#define ADC14_CTL0_SHT0__16 (2UL<<8)
+#define ADC14_CTL1_RES__12BIT (2UL<<4)
+#define ADC14_MCTLN_INCH_14 14UL
+#define DMA_CFG_MASTEN 1UL
+#define DMA_ERRCLR_ERRCLR 1UL
+#define MPU_RASR_XN_Pos 28U
+#define MPU_RASR_AP_Pos 24U
+#define SCB_CFSR_MMARVALID_Msk (1UL<<7)
+#define SCB_CFSR_MSTKERR_Msk (1UL<<4)
+#define SCB_CFSR_DACCVIOL_Msk (1UL<<1)
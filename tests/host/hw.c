@@ -0,0 +1,174 @@
+#define _GNU_SOURCE  // REG_EFL
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include "hw.h"
+
+/* Hw.c: register memory and intrinsics for the host tests
+ *
+ * Every peripheral pointer points at a zeroed block, so firmware code can
+ * write its registers freely and a test can read them back or preset a
+ * flag, e.g. the eUSCI TXIFG the DAC driver waits for.
+ *
+ * The ports and eUSCI_B0 have a page of their own. hw_watch_writes() makes
+ * it read only: a write to it faults, the page is opened for the one
+ * instruction, which is single stepped, and once it is done the page is
+ * closed again and hw_write_hook() is told which register was written.
+ * This needs the trap flag of x86-64 Linux.
+ */
+
+#define PAGE_SIZE 4096
+#define TRAP_FLAG 0x100  // EFLAGS.TF
+
+static union {
+  struct {
+    DIO_PORT_Interruptable_Type ports[10];
+    DIO_PORT_Not_Interruptable_Type port_j;
+    EUSCI_B_Type eusci_b0;
+  } regs;
+  char page[PAGE_SIZE];
+} watched __attribute__((aligned(PAGE_SIZE)));
+
+static Timer_A_Type timers[4];
+static Timer32_Type timer32[2];
+static EUSCI_A_Type eusci_a0;
+static CS_Type cs;
+static WDT_A_Type wdt;
+static ADC14_Type adc;
+static DMA_Control_Type dma_control;
+static DMA_Channel_Type dma_channel;
+static FLCTL_Type flctl;
+static NVIC_Type nvic;
+static SCB_Type scb;
+static SysTick_Type systick;
+static DWT_Type dwt;
+static CoreDebug_Type core_debug;
+static MPU_Type mpu;
+
+DIO_PORT_Interruptable_Type *P1 = &watched.regs.ports[0],
+                            *P2 = &watched.regs.ports[1],
+                            *P3 = &watched.regs.ports[2],
+                            *P4 = &watched.regs.ports[3],
+                            *P5 = &watched.regs.ports[4],
+                            *P6 = &watched.regs.ports[5],
+                            *P7 = &watched.regs.ports[6],
+                            *P8 = &watched.regs.ports[7],
+                            *P9 = &watched.regs.ports[8],
+                            *P10 = &watched.regs.ports[9];
+DIO_PORT_Not_Interruptable_Type* PJ = &watched.regs.port_j;
+Timer_A_Type *TIMER_A0 = &timers[0], *TIMER_A1 = &timers[1],
+             *TIMER_A2 = &timers[2], *TIMER_A3 = &timers[3];
+Timer32_Type *TIMER32_1 = &timer32[0], *TIMER32_2 = &timer32[1];
+EUSCI_B_Type* EUSCI_B0 = &watched.regs.eusci_b0;
+EUSCI_A_Type* EUSCI_A0 = &eusci_a0;
+CS_Type* CS = &cs;
+WDT_A_Type* WDT_A = &wdt;
+ADC14_Type* ADC14 = &adc;
+DMA_Control_Type* DMA_Control = &dma_control;
+DMA_Channel_Type* DMA_Channel = &dma_channel;
+FLCTL_Type* FLCTL = &flctl;
+NVIC_Type* NVIC = &nvic;
+SCB_Type* SCB = &scb;
+SysTick_Type* SysTick = &systick;
+DWT_Type* DWT = &dwt;
+CoreDebug_Type* CoreDebug = &core_debug;
+MPU_Type* MPU = &mpu;
+
+static uint32_t primask = 0;
+void (*hw_wfi_hook)(void) = 0;
+void (*hw_write_hook)(volatile void* reg) = 0;
+void (*hw_unmask_hook)(void) = 0;
+
+void NVIC_EnableIRQ(IRQn_Type irq) {}
+void NVIC_DisableIRQ(IRQn_Type irq) {}
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) {}
+uint32_t NVIC_GetPriority(IRQn_Type irq) { return 0; }
+void NVIC_SetPendingIRQ(IRQn_Type irq) {}
+void NVIC_ClearPendingIRQ(IRQn_Type irq) {}
+void NVIC_SetPriorityGrouping(uint32_t group) {}
+
+void __disable_irq(void) { primask = 1; }
+uint32_t __get_PRIMASK(void) { return primask; }
+
+// a pending interrupt is taken as soon as interrupts are unmasked
+void __set_PRIMASK(uint32_t value)
+{
+  int unmasked = primask && !value;
+
+  primask = value;
+  if (unmasked && hw_unmask_hook) {
+    hw_unmask_hook();
+  }
+}
+
+void __enable_irq(void)
+{
+  __set_PRIMASK(0);
+}
+void __DSB(void) {}
+void __ISB(void) {}
+void __DMB(void) {}
+void __NOP(void) {}
+uint32_t __get_MSP(void) { return 0; }
+uint32_t __get_IPSR(void) { return 0; }
+uint32_t __get_BASEPRI(void) { return 0; }
+void __set_BASEPRI(uint32_t value) {}
+void __delay_cycles(unsigned long cycles) {}
+
+// sleeping hands control to the test, which stands in for the interrupts
+void __WFI(void)
+{
+  if (hw_wfi_hook) {
+    hw_wfi_hook();
+  }
+}
+
+#if defined(__linux__) && defined(__x86_64__)
+static volatile void* written;  // the register being written
+
+// a write to the watched page: let the instruction through, one step
+static void on_write(int number, siginfo_t* info, void* context)
+{
+  ucontext_t* user = context;
+  char* address = info->si_addr;
+
+  if (address < watched.page || address >= watched.page + PAGE_SIZE) {
+    signal(SIGSEGV, SIG_DFL);  // a real fault, taken again unhandled
+    return;
+  }
+  written = address;
+  mprotect(watched.page, PAGE_SIZE, PROT_READ | PROT_WRITE);
+  user->uc_mcontext.gregs[REG_EFL] |= TRAP_FLAG;
+}
+
+// the write is done: close the page again and report the register
+static void on_step(int number, siginfo_t* info, void* context)
+{
+  ucontext_t* user = context;
+
+  user->uc_mcontext.gregs[REG_EFL] &= ~TRAP_FLAG;
+  mprotect(watched.page, PAGE_SIZE, PROT_READ);
+  if (hw_write_hook) {
+    hw_write_hook(written);
+  }
+}
+
+int hw_watch_writes(int on)
+{
+  struct sigaction action = {.sa_flags = SA_SIGINFO};
+
+  if (on) {
+    action.sa_sigaction = on_write;
+    sigaction(SIGSEGV, &action, 0);
+    action.sa_sigaction = on_step;
+    sigaction(SIGTRAP, &action, 0);
+  }
+  return mprotect(watched.page, PAGE_SIZE,
+                  on ? PROT_READ : PROT_READ | PROT_WRITE) == 0;
+}
+#else
+int hw_watch_writes(int on)
+{
+  return 0;
+}
+#endif
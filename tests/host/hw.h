@@ -0,0 +1,17 @@
+#ifndef HW_H
+#define HW_H
+
+#include "msp.h"
+
+// called by __WFI(), for tests that need time to pass while the code sleeps
+extern void (*hw_wfi_hook)(void);
+// called after each write to a port or eUSCI_B0 register while they are
+// watched, with the register written
+extern void (*hw_write_hook)(volatile void* reg);
+// called when interrupts are unmasked, for tests that take an interrupt
+// just there
+extern void (*hw_unmask_hook)(void);
+// watch the writes or stop, returns 0 where they can not be watched
+int hw_watch_writes(int on);
+
+#endif
@@ -0,0 +1 @@
+#include "msp432p401r.h"
@@ -0,0 +1,252 @@
+#ifndef HOST_MSP432P401R_H
+#define HOST_MSP432P401R_H
+
+/* Host stand-in for the device header: the registers the firmware uses,
+ * backed by plain memory in hw.c, and the CMSIS intrinsics as functions.
+ * Only what the host tests build against is declared.
+ */
+#include <stdint.h>
+#define __I volatile const
+#define __O volatile
+#define __IO volatile
+#define BIT0 0x01
+#define BIT1 0x02
+#define BIT2 0x04
+#define BIT3 0x08
+#define BIT4 0x10
+#define BIT5 0x20
+#define BIT6 0x40
+#define BIT7 0x80
+typedef struct {
+  __IO uint8_t IN, OUT, DIR, REN, DS, SEL0, SEL1, IES, IE, IFG;
+  __IO uint16_t IV;
+} DIO_PORT_Interruptable_Type;
+typedef struct {
+  __IO uint8_t IN, OUT, DIR, REN, DS, SEL0, SEL1, SELC;
+} DIO_PORT_Not_Interruptable_Type;
+extern DIO_PORT_Interruptable_Type *P1, *P2, *P3, *P4, *P5, *P6, *P7, *P8, *P9,
+                                   *P10;
+extern DIO_PORT_Not_Interruptable_Type *PJ;
+typedef struct {
+  __IO uint16_t CTL;
+  __IO uint16_t CCTL[7];
+  __IO uint16_t R;
+  __IO uint16_t CCR[7];
+  __IO uint16_t EX0;
+  __I uint16_t IV;
+} Timer_A_Type;
+extern Timer_A_Type *TIMER_A0, *TIMER_A1, *TIMER_A2, *TIMER_A3;
+typedef struct {
+  __IO uint16_t CTLW0, CTLW1, BRW, STATW, TBCNT, RXBUF, TXBUF, I2COA0, I2COA1,
+                I2COA2, I2COA3, ADDRX, ADDMASK, I2CSA, IE, IFG, IV;
+} EUSCI_B_Type;
+typedef struct {
+  __IO uint16_t CTLW0, CTLW1, BRW, MCTLW, STATW, RXBUF, TXBUF, ABCTL, IRCTL, IE,
+                IFG, IV;
+} EUSCI_A_Type;
+typedef struct {
+  __IO uint16_t CTLW0, BRW, STATW, RXBUF, TXBUF, IE, IFG, IV;
+} EUSCI_A_SPI_Type;
+extern EUSCI_B_Type *EUSCI_B0;
+extern EUSCI_A_Type *EUSCI_A0;
+typedef struct {
+  __IO uint32_t KEY, CTL0, CTL1, CTL2, CTL3, CLKEN, STAT, IE, IFG, CLRIFG,
+                SETIFG, DCOERCAL0, DCOERCAL1;
+} CS_Type;
+extern CS_Type *CS;
+typedef struct {
+  __IO uint16_t CTL;
+} WDT_A_Type;
+extern WDT_A_Type *WDT_A;
+typedef struct {
+  __IO uint32_t CTL0, CTL1, LO0, HI0, LO1, HI1;
+  __IO uint32_t MCTL[32];
+  __IO uint32_t MEM[32];
+  __IO uint32_t IER0, IER1;
+  __I uint32_t IFGR0, IFGR1;
+  __O uint32_t CLRIFGR0;
+  __IO uint32_t CLRIFGR1;
+  __IO uint32_t IV;
+} ADC14_Type;
+extern ADC14_Type *ADC14;
+typedef struct {
+  __I uint32_t STAT;
+  __O uint32_t CFG;
+  __IO uint32_t CTLBASE;
+  __I uint32_t ATLBASE;
+  __I uint32_t WAITSTAT;
+  __O uint32_t SWREQ;
+  __IO uint32_t USEBURSTSET;
+  __O uint32_t USEBURSTCLR;
+  __IO uint32_t REQMASKSET;
+  __O uint32_t REQMASKCLR;
+  __IO uint32_t ENASET;
+  __O uint32_t ENACLR;
+  __IO uint32_t ALTSET;
+  __O uint32_t ALTCLR;
+  __IO uint32_t PRIOSET;
+  __O uint32_t PRIOCLR;
+  __IO uint32_t ERRCLR;
+} DMA_Control_Type;
+typedef struct {
+  __I uint32_t DEVICE_CFG;
+  __IO uint32_t SW_CHTRIG;
+  __IO uint32_t CH_SRCCFG[32];
+  __IO uint32_t INT1_SRCCFG, INT2_SRCCFG, INT3_SRCCFG;
+  __I uint32_t INT0_SRCFLG;
+  __O uint32_t INT0_CLRFLG;
+} DMA_Channel_Type;
+extern DMA_Control_Type *DMA_Control;
+extern DMA_Channel_Type *DMA_Channel;
+typedef struct {
+  __I uint32_t POWER_STAT;
+  __IO uint32_t BANK0_RDCTL, BANK1_RDCTL, RDBRST_CTLSTAT, RDBRST_STARTADDR,
+                RDBRST_LEN, RDBRST_FAILADDR, RDBRST_FAILCNT, PRG_CTLSTAT,
+                PRGBRST_CTLSTAT, PRGBRST_STARTADDR, PRGBRST_DATA0_0,
+                ERASE_CTLSTAT, ERASE_SECTADDR, BANK0_INFO_WEPROT,
+                BANK0_MAIN_WEPROT, BANK1_INFO_WEPROT, BANK1_MAIN_WEPROT,
+                BMRK_CTLSTAT, BMRK_IFETCH, BMRK_DREAD, BMRK_CMP, IFG, IE,
+                CLRIFG, SETIFG, READ_TIMCTL, READMARGIN_TIMCTL, PRGVER_TIMCTL,
+                ERSVER_TIMCTL, LKGVER_TIMCTL, PROGRAM_TIMCTL, ERASE_TIMCTL,
+                MASSERASE_TIMCTL, BURSTPRG_TIMCTL;
+} FLCTL_Type;
+extern FLCTL_Type *FLCTL;
+typedef enum {
+  NonMaskableInt_IRQn = -14,
+  HardFault_IRQn = -13,
+  MemoryManagement_IRQn = -12,
+  BusFault_IRQn = -11,
+  UsageFault_IRQn = -10,
+  SVCall_IRQn = -5,
+  DebugMonitor_IRQn = -4,
+  PendSV_IRQn = -2,
+  SysTick_IRQn = -1,
+  PSS_IRQn = 0,
+  CS_IRQn,
+  PCM_IRQn,
+  WDT_A_IRQn,
+  FPU_IRQn,
+  FLCTL_IRQn,
+  COMP_E0_IRQn,
+  COMP_E1_IRQn,
+  TA0_0_IRQn,
+  TA0_N_IRQn,
+  TA1_0_IRQn,
+  TA1_N_IRQn,
+  TA2_0_IRQn,
+  TA2_N_IRQn,
+  TA3_0_IRQn,
+  TA3_N_IRQn,
+  EUSCIA0_IRQn,
+  EUSCIA1_IRQn,
+  EUSCIA2_IRQn,
+  EUSCIA3_IRQn,
+  EUSCIB0_IRQn,
+  EUSCIB1_IRQn,
+  EUSCIB2_IRQn,
+  EUSCIB3_IRQn,
+  ADC14_IRQn,
+  T32_INT1_IRQn,
+  T32_INT2_IRQn,
+  T32_INTC_IRQn,
+  AES256_IRQn,
+  RTC_C_IRQn,
+  DMA_ERR_IRQn,
+  DMA_INT3_IRQn,
+  DMA_INT2_IRQn,
+  DMA_INT1_IRQn,
+  DMA_INT0_IRQn,
+  PORT1_IRQn,
+  PORT2_IRQn,
+  PORT3_IRQn,
+  PORT4_IRQn,
+  PORT5_IRQn,
+  PORT6_IRQn,
+} IRQn_Type;
+#define __NVIC_PRIO_BITS 3
+typedef struct {
+  __IO uint32_t ISER[8];
+  uint32_t r0[24];
+  __IO uint32_t ICER[8];
+  uint32_t r1[24];
+  __IO uint32_t ISPR[8];
+  uint32_t r2[24];
+  __IO uint32_t ICPR[8];
+  uint32_t r3[24];
+  __IO uint32_t IABR[8];
+  uint32_t r4[56];
+  __IO uint8_t IP[240];
+} NVIC_Type;
+typedef struct {
+  __I uint32_t CPUID;
+  __IO uint32_t ICSR, VTOR, AIRCR, SCR, CCR;
+  __IO uint8_t SHP[12];
+  __IO uint32_t SHCSR, CFSR, HFSR, DFSR, MMFAR, BFAR, AFSR;
+} SCB_Type;
+typedef struct {
+  __IO uint32_t CTRL, LOAD, VAL;
+  __I uint32_t CALIB;
+} SysTick_Type;
+typedef struct {
+  __IO uint32_t CTRL, CYCCNT, CPICNT, EXCCNT, SLEEPCNT, LSUCNT, FOLDCNT;
+  __I uint32_t PCSR;
+} DWT_Type;
+typedef struct {
+  __IO uint32_t DHCSR;
+  __O uint32_t DCRSR;
+  __IO uint32_t DCRDR, DEMCR;
+} CoreDebug_Type;
+typedef struct {
+  __I uint32_t TYPE;
+  __IO uint32_t CTRL, RNR, RBAR, RASR;
+} MPU_Type;
+extern NVIC_Type *NVIC;
+extern SCB_Type *SCB;
+extern SysTick_Type *SysTick;
+extern DWT_Type *DWT;
+extern CoreDebug_Type *CoreDebug;
+extern MPU_Type *MPU;
+#define SCB_ICSR_PENDSVSET_Msk (1UL<<28)
+#define SCB_ICSR_PENDSVCLR_Msk (1UL<<27)
+#define SCB_ICSR_VECTACTIVE_Msk 0x1FFUL
+#define SCB_SCR_SLEEPONEXIT_Msk (1UL<<1)
+#define SCB_SCR_SLEEPDEEP_Msk (1UL<<2)
+#define SCB_SHCSR_MEMFAULTENA_Msk (1UL<<16)
+#define SCB_SHCSR_BUSFAULTENA_Msk (1UL<<17)
+#define SCB_SHCSR_USGFAULTENA_Msk (1UL<<18)
+#define SysTick_CTRL_CLKSOURCE_Msk 4UL
+#define SysTick_CTRL_TICKINT_Msk 2UL
+#define SysTick_CTRL_ENABLE_Msk 1UL
+#define SysTick_CTRL_COUNTFLAG_Msk (1UL<<16)
+#define DWT_CTRL_CYCCNTENA_Msk 1UL
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL<<24)
+#define MPU_CTRL_ENABLE_Msk 1UL
+#define MPU_CTRL_PRIVDEFENA_Msk 4UL
+#define MPU_RASR_ENABLE_Msk 1UL
+#define MPU_RASR_SIZE_Pos 1U
+#define MPU_RASR_AP_Pos 24U
+#define MPU_RASR_XN_Msk (1UL<<28)
+#define MPU_RBAR_VALID_Msk (1UL<<4)
+void NVIC_EnableIRQ(IRQn_Type);
+void NVIC_DisableIRQ(IRQn_Type);
+void NVIC_SetPriority(IRQn_Type, uint32_t);
+uint32_t NVIC_GetPriority(IRQn_Type);
+void NVIC_SetPendingIRQ(IRQn_Type);
+void NVIC_ClearPendingIRQ(IRQn_Type);
+void NVIC_SetPriorityGrouping(uint32_t);
+void __enable_irq(void);
+void __disable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t);
+void __WFI(void);
+void __DSB(void);
+void __ISB(void);
+void __DMB(void);
+uint32_t __get_MSP(void);
+uint32_t __get_IPSR(void);
+void __NOP(void);
+uint32_t __get_BASEPRI(void);
+void __set_BASEPRI(uint32_t);
+void __delay_cycles(unsigned long);
+#include "bits.h"
+#endif
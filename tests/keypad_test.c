@@ -0,0 +1,221 @@
+#include <stdint.h>
+#include <string.h>
+#include "keypad.h"
+#include "test.h"
+
+/* Keypad_test.c: ghost detection, key edges and key actions
+ *
+ * keypad_update() is fed scans every KEY_SCAN_MS, as the keypad task does.
+ * The actions it calls are logged as the key for a key and 's' and the
+ * digit for a shortcut, so a run reads like "5s3#".
+ */
+
+#define LOG_SIZE 64
+
+static char action_log[LOG_SIZE];
+static int log_count;
+static uint32_t now;
+
+char intToChar(uint8_t number)
+{
+  return '0' + number;
+}
+
+static void note(char c)
+{
+  if (log_count < LOG_SIZE - 1) {
+    action_log[log_count++] = c;
+  }
+}
+
+static void on_key(char key)
+{
+  note(key);
+}
+
+static void on_shortcut(char key)
+{
+  note('s');
+  note(key);
+}
+
+static void on_edge(char key, int pressed)
+{
+  note(pressed ? '+' : '-');
+  note(key);
+}
+
+static void start(void)
+{
+  memset(action_log, 0, sizeof(action_log));
+  log_count = 0;
+}
+
+// returns the scan mask of the keys in keys
+static uint16_t keys(const char* keys)
+{
+  uint16_t mask = 0;
+
+  while (*keys) {
+    mask |= keypad_mask(*keys++);
+  }
+  return mask;
+}
+
+// scan mask for ms milliseconds
+static void hold(uint16_t mask, uint32_t ms)
+{
+  uint32_t end = now + ms;
+
+  while ((int32_t)(now - end) < 0) {
+    keypad_update(mask, now);
+    now += KEY_SCAN_MS;
+  }
+}
+
+// debounced: long enough to act, too short to repeat
+static void press(const char* pressed)
+{
+  hold(keys(pressed), (KEY_STABLE_SCANS + 2) * KEY_SCAN_MS);
+}
+
+static void check_log(const char* wanted, const char* what)
+{
+  CHECK(strcmp(action_log, wanted) == 0, "%s: \"%s\", wanted \"%s\"", what,
+        action_log, wanted);
+}
+
+static void test_ghosted(void)
+{
+  int a, b;
+
+  // any two columns sharing two rows, the 4 corners of a rectangle
+  for (a = 0; a < KEYPAD_COLS; a++) {
+    for (b = a + 1; b < KEYPAD_COLS; b++) {
+      CHECK(keypad_ghosted(0x3 << (4 * a) | 0x3 << (4 * b)),
+            "rows 1 and 2 of columns %d and %d not ghosted", a + 1, b + 1);
+      CHECK(keypad_ghosted(0x9 << (4 * a) | 0x9 << (4 * b)),
+            "rows 1 and 4 of columns %d and %d not ghosted", a + 1, b + 1);
+      CHECK(!keypad_ghosted(0x1 << (4 * a) | 0x3 << (4 * b)),
+            "3 corners of columns %d and %d ghosted", a + 1, b + 1);
+    }
+  }
+  CHECK(keypad_ghosted(keys("1425")), "1 4 2 5 not ghosted");
+  CHECK(!keypad_ghosted(keys("147*")), "a whole column ghosted");
+  CHECK(!keypad_ghosted(keys("123")), "a whole row ghosted");
+
+  // a ghosted scan never acts, however long it is held
+  keypad_actions(on_key, on_shortcut);
+  start();
+  hold(keys("1425"), 1000);
+  hold(0, 100);
+  check_log("", "ghosted scan");
+}
+
+// releases first, then presses, each in scan bit order
+static void test_edges(void)
+{
+  start();
+  keypad_edges(keys("142"), keys("473"), on_edge);
+  check_log("-1-2+7+3", "edges");
+  start();
+  keypad_edges(0, keys("#*01"), on_edge);
+  check_log("+1+*+0+#", "presses");
+  start();
+  keypad_edges(keys("9"), keys("9"), on_edge);
+  check_log("", "no change");
+}
+
+// three keys held together in different rows and columns each act once
+static void test_rollover(void)
+{
+  keypad_actions(on_key, on_shortcut);
+  start();
+  press("1");
+  press("15");
+  hold(keys("159"), 1000);  // none of them repeats
+  press("59");
+  press("9");
+  press("");
+  check_log("159", "rollover");
+
+  // a bouncing key acts once
+  start();
+  hold(keys("3"), KEY_SCAN_MS);
+  hold(0, KEY_SCAN_MS);
+  hold(keys("3"), KEY_SCAN_MS);
+  press("3");
+  press("");
+  check_log("3", "bounce");
+}
+
+static void test_star(void)
+{
+  keypad_actions(on_key, on_shortcut);
+
+  // * with a digit is a shortcut, and * does nothing on release
+  start();
+  press("*");
+  press("*5");
+  press("*");
+  press("");
+  check_log("s5", "*5 chord");
+
+  // two shortcuts while * stays down
+  start();
+  press("*");
+  press("*3");
+  press("*");
+  press("*4");
+  press("");
+  check_log("s3s4", "*3 *4");
+
+  // on its own, * acts when released
+  start();
+  press("*");
+  check_log("", "* held");
+  press("");
+  check_log("*", "* released");
+
+  // # is not a digit, it acts as usual with * held
+  start();
+  press("*");
+  press("*#");
+  press("");
+  check_log("#*", "*#");
+}
+
+// only * and # repeat while held, with no extra * on release
+static void test_repeat(void)
+{
+  int repeats = 3;
+
+  keypad_actions(on_key, on_shortcut);
+  start();
+  hold(keys("5"), KEY_STABLE_SCANS * KEY_SCAN_MS + (repeats + 1) *
+                  KEY_REPEAT_MS);
+  press("");
+  check_log("5", "5 held");
+
+  start();
+  hold(keys("#"), (KEY_STABLE_SCANS + 1) * KEY_SCAN_MS + repeats *
+                  KEY_REPEAT_MS);
+  press("");
+  check_log("####", "# held");
+
+  start();
+  hold(keys("*"), (KEY_STABLE_SCANS + 1) * KEY_SCAN_MS + repeats *
+                  KEY_REPEAT_MS);
+  press("");
+  check_log("***", "* held");
+}
+
+int main(void)
+{
+  test_ghosted();
+  test_edges();
+  test_rollover();
+  test_star();
+  test_repeat();
+  return test_report("keypad_test");
+}
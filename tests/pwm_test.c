@@ -0,0 +1,117 @@
+#include <math.h>
+#include <stdint.h>
+#include "pwm.h"
+#include "test.h"
+
+/* Pwm_test.c: timer settings and duty rounding of the hardware output
+ *
+ * pwm_start() runs against the TIMER_A2 stand-in at each PULSE preset and
+ * the lowest, middle and highest duty the keypad sets. The period in ticks
+ * of the divided clock must come within a tick of the frequency, and the
+ * high time is the nearest whole tick to the duty, but never 0 or the
+ * whole period: then the output would stop toggling. dco_error_ppm() is
+ * the test's, so the calibration can be moved.
+ */
+
+#define CLOCK_HZ 24000000.0  // MHZ_24
+#define PRESETS 5
+#define DUTIES 3
+
+static const uint32_t presets[PRESETS] = {1000, 10000, 100000, 200000,
+                                          500000};
+static const float duties[DUTIES] = {0.01f, 0.5f, 0.99f};
+static int32_t error_ppm;
+
+int32_t dco_error_ppm(void)
+{
+  return error_ppm;
+}
+
+// returns the timer clock after the ID and EX0 dividers
+static double timer_clock(void)
+{
+  int id = (TIMER_A2->CTL >> TIMER_A_CTL_ID_OFS) & 3;
+
+  return CLOCK_HZ * (1 + error_ppm * 1e-6) / (1 << id) / (TIMER_A2->EX0 + 1);
+}
+
+static void test_duty(void)
+{
+  uint32_t period, high, wanted;
+  double frequency;
+  int i, j;
+
+  for (i = 0; i < PRESETS; i++) {
+    for (j = 0; j < DUTIES; j++) {
+      pwm_start(presets[i], duties[j]);
+      period = pwm_period_ticks();
+      high = TIMER_A2->CCR[PWM_CCR];
+      CHECK(TIMER_A2->CCR[0] == period - 1, "%u Hz: CCR0 %u for %u ticks",
+            (unsigned)presets[i], (unsigned)TIMER_A2->CCR[0],
+            (unsigned)period);
+      frequency = timer_clock() / period;
+      CHECK(fabs(frequency - presets[i]) <= frequency / period,
+            "%u Hz plays at %.1f Hz", (unsigned)presets[i], frequency);
+
+      wanted = (uint32_t)lrint(duties[j] * period);
+      if (wanted < 1) {
+        wanted = 1;
+      }
+      if (wanted > period - 1) {
+        wanted = period - 1;
+      }
+      CHECK(high == wanted, "%u Hz at %.0f%%: %u of %u ticks high, wanted %u",
+            (unsigned)presets[i], duties[j] * 100, (unsigned)high,
+            (unsigned)period, (unsigned)wanted);
+    }
+  }
+
+  // the top preset: 48 ticks, 1% and 99% round to a flat line
+  pwm_start(500000, 0.01f);
+  CHECK(pwm_period_ticks() == 48, "500 kHz in %u ticks, wanted 48",
+        (unsigned)pwm_period_ticks());
+  CHECK(TIMER_A2->CCR[PWM_CCR] == 1, "500 kHz at 1%%: %u ticks high",
+        (unsigned)TIMER_A2->CCR[PWM_CCR]);
+  pwm_start(500000, 0.99f);
+  CHECK(TIMER_A2->CCR[PWM_CCR] == 47, "500 kHz at 99%%: %u ticks high",
+        (unsigned)TIMER_A2->CCR[PWM_CCR]);
+
+  // set directly, the same limits
+  pwm_set_duty_ticks(0);
+  CHECK(TIMER_A2->CCR[PWM_CCR] == 1, "0 ticks set %u",
+        (unsigned)TIMER_A2->CCR[PWM_CCR]);
+  pwm_set_duty_ticks(1000);
+  CHECK(TIMER_A2->CCR[PWM_CCR] == 47, "1000 ticks set %u",
+        (unsigned)TIMER_A2->CCR[PWM_CCR]);
+}
+
+// the period follows the calibrated clock, and the divided low frequencies
+// still fit the 16 bit timer
+static void test_clock(void)
+{
+  uint32_t period;
+
+  error_ppm = 2000;
+  pwm_start(500000, 0.5f);
+  CHECK(pwm_period_ticks() == 48, "500 kHz 2000 ppm fast in %u ticks",
+        (unsigned)pwm_period_ticks());
+  pwm_start(1000, 0.5f);
+  CHECK(pwm_period_ticks() == 24048, "1 kHz 2000 ppm fast in %u ticks",
+        (unsigned)pwm_period_ticks());
+  error_ppm = 0;
+
+  pwm_start(100, 0.5f);
+  period = pwm_period_ticks();
+  CHECK(period <= 65535 && TIMER_A2->EX0 == 3,
+        "100 Hz: %u ticks, EX0 %u", (unsigned)period,
+        (unsigned)TIMER_A2->EX0);
+  CHECK(fabs(timer_clock() / period - 100) < 0.01, "100 Hz plays at %.3f Hz",
+        timer_clock() / period);
+}
+
+int main(void)
+{
+  test_duty();
+  test_clock();
+  return test_report("pwm_test");
+}
@@ -0,0 +1,634 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "analysis.h"
+#include "capture.h"
+#include "dac.h"
+#include "diag.h"
+#include "envelope.h"
+#include "hw.h"
+#include "irq.h"
+#include "lcd.h"
+#include "render.h"
+#include "sequence.h"
+#include "spectrum.h"
+#include "test.h"
+#include "vcd.h"
+#include "wav.h"
+
+/* Sample_path_test.c: the renderer and sample ISR run on the host
+ *
+ * tick() is one sample clock interrupt: it runs TA0_0_IRQHandler, built
+ * from main.c with its main() renamed, which pops a word, sends it to the
+ * DAC, captures it and asks for a refill once the queue runs low. PendSV
+ * is simulated after each tick: once irq_defer() set PENDSVSET,
+ * PendSV_Handler runs the renderer, delayed by render_lag ticks to stand
+ * for higher priority work keeping it out. The registers are plain memory
+ * from host/hw.c. What main.c calls outside the sample path and the LCD is
+ * stubbed.
+ *
+ * Checked are the frequency and amplitude of the output through the whole
+ * path, that the capture block records exactly the words sent, that the
+ * queue only runs dry when the renderer is kept out longer than it holds,
+ * and that a sample period change reaches the timer with the first sample
+ * rendered for it while the output stays on frequency.
+ *
+ * A captured block is written to WAV_PATH and read back, and the pins the
+ * ISR and the LCD task drive are dumped to VCD_PATH while they run: the
+ * SPI clock and data, the DAC's CS, the GAIN and SHDN bits it latches, and
+ * the LCD's RS, E and data nibble. The dump is decoded again, SPI words at
+ * CS rising after 16 clocks and LCD bytes at E, and must give the words
+ * sent, one per sample period, and the text main.c drew. The LCD's D4 is
+ * P4.4, the DAC's CS: the DAC ignores the LCD's pulses on it, they carry
+ * no clocks, and the LCD ignores CS while E is low. Times in the dump are
+ * MCLK cycles, one per register write and two per SPI bit, not those of
+ * the LCD's delay loops.
+ *
+ * The output stages are compared on a quiet sine of NOISE_AMPLITUDE_PCT,
+ * about 20 LSB, where rounding leaves stair steps: its harmonics are spurs
+ * in the band. Against the tone are measured the noise below
+ * NOISE_BAND_HZ, the strongest spur there and the noise of the whole band.
+ * Dither must take the spurs down, shaping must move noise out of the band,
+ * and both must cost noise over the whole band, which is why rounding is
+ * the default.
+ */
+
+#define FULL_SCALE_MV 3300  // DAC reference
+#define TEST_FREQUENCY 1000
+// the envelope attack is 50 ms, wait for it before measuring
+#define SETTLE_SAMPLES (SAMPLE_RATE / 5)
+// longest the renderer may be kept out without an underrun: the queue is
+// refilled at SAMPLE_QUEUE_LOW, so that many samples are left
+#define SAFE_LAG (SAMPLE_QUEUE_LOW - 1)
+
+// long enough that the dither noise in one bin is well under the spurs
+// of rounding
+#define NOISE_POINTS 65536
+#define NOISE_FREQUENCY 618
+#define NOISE_AMPLITUDE_PCT 1
+#define NOISE_BAND_HZ 4000
+// bins either side of the tone and DC that the window spreads them over
+#define NOISE_SKIP_BINS 5
+
+#define WAV_PATH "sample_path.wav"
+#define VCD_PATH "sample_path.vcd"
+// samples dumped to VCD_PATH, the LCD is sent half way
+#define PIN_SAMPLES 64
+#define PS_PER_3_CYCLES 125000  // at MHZ_24
+
+enum {
+  SPI_CLK,
+  SPI_SIMO,
+  DAC_CS,
+  DAC_GA,
+  DAC_SHDN,
+  DAC_LEVEL,
+  LCD_RS,
+  LCD_E,
+  LCD_D,
+  PIN_SIGNALS
+};
+
+typedef struct pin_decoder {
+  int values[PIN_SIGNALS];  // -1 before the first
+  uint16_t shift;           // SPI bits since CS fell
+  int bits;
+  uint16_t words[PIN_SAMPLES];
+  uint64_t word_times[PIN_SAMPLES];  // of the last clock
+  int word_count;
+  int rs;      // taken at E rising
+  int nibbles;  // LCD nibbles so far, the high one first
+  unsigned char high;
+  char display[LCD_LINES][LCD_LINESIZE];
+  int line, column;
+} pin_decoder;
+
+static const char* const pin_names[PIN_SIGNALS] = {
+  "spi_clk", "spi_simo", "dac_cs", "dac_ga", "dac_shdn", "dac_level",
+  "lcd_rs", "lcd_e", "lcd_d",
+};
+static const int pin_widths[PIN_SIGNALS] = {1, 1, 1, 1, 1, 12, 1, 1, 4};
+
+static int render_lag = 0;      // ticks PendSV is held off for
+static int pendsv_waiting = 0;  // ticks since PENDSVSET was seen
+static uint64_t sample_start;   // MCLK cycle of the next compare event
+static uint64_t now;            // MCLK cycle of the next register write
+static vcd_file vcd;
+static int dac_cs = 1;           // as the DAC saw it
+static uint16_t dac_shift;       // bits clocked in since CS fell
+static int dac_bits;
+
+extern uint16_t last_word;  // main.c's, repeated on an underrun
+void TA0_0_IRQHandler(void);
+void handle_key(char key);
+void PendSV_Handler(void);
+
+// stand-ins for what main.c and render.c call outside the sample path
+void sequence_init(void) {}
+void sequence_rewind(void) {}
+int sequence_next(gen_config* config, uint32_t* samples) { return 0; }
+void hostlink_init(void) {}
+void hostlink_poll(void) {}
+void hostlink_commit(void) {}
+int selftest_run(analysis_result* result) { return 0; }
+void selftest_show(const analysis_result* result, int passed) {}
+void stack_guard(void) {}
+void stack_poll(void) {}
+
+// run the deferred jobs once PendSV was pending for render_lag ticks
+static void pendsv(void)
+{
+  if (!(SCB->ICSR & SCB_ICSR_PENDSVSET_Msk)) {
+    return;
+  }
+  if (pendsv_waiting++ < render_lag) {
+    return;
+  }
+  SCB->ICSR = 0;
+  pendsv_waiting = 0;
+  PendSV_Handler();
+}
+
+// one sample clock interrupt, returns the word it sent
+static uint16_t tick(void)
+{
+  uint32_t period = TIMER_A0->CCR[0] + 1;
+
+  now = sample_start;
+  TIMER_A0->CCTL[0] |= TIMER_A_CCTLN_CCIFG;
+  TA0_0_IRQHandler();
+  pendsv();
+  sample_start += period;
+  return last_word;
+}
+
+static void run(int samples)
+{
+  while (samples--) {
+    tick();
+  }
+}
+
+static void start_output(wave_type wave, int frequency, int amplitude,
+                         output_mode output)
+{
+  gen_config config;
+
+  memset(&config, 0, sizeof(config));
+  config.wave = wave;
+  config.frequency = frequency;
+  config.duty_cycle = 0.5f;
+  config.interp = INTERP_LINEAR;
+  config.amplitude = amplitude;
+  config.output = output;
+  config.phase_inc = render_phase_increment(frequency);
+
+  // the SPI flags read back as ready, so DAC writes never wait
+  EUSCI_B0->IFG = EUSCI_B_IFG_TXIFG | EUSCI_B_IFG_RXIFG;
+  TIMER_A0->CCR[0] = SAMPLE_PERIOD - 1;
+  capture_init(SAMPLE_RATE);
+  // back to the full rate after test_period_switch(), the first fill
+  // takes the request and works out the phase increment again
+  render_set_sample_period(SAMPLE_PERIOD);
+  render_init(&config);
+  render_lag = 0;
+  pendsv_waiting = 0;
+  diag.underruns = 0;
+  last_word = DAC_pack(DC_BIAS);
+}
+
+// capture a block and measure the 12 bit levels in it
+static void measure(analysis_result* result)
+{
+  static uint16_t levels[CAPTURE_SIZE];
+  int i;
+
+  capture_arm();
+  run(CAPTURE_SIZE);
+  for (i = 0; i < CAPTURE_SIZE; i++) {
+    levels[i] = capture.words[i] & 0x0FFF;
+  }
+  analyse(levels, CAPTURE_SIZE, capture.sample_rate, FULL_SCALE_MV, 12,
+          result);
+}
+
+static void start(wave_type wave, int frequency)
+{
+  start_output(wave, frequency, 100, OUTPUT_ROUND);
+}
+
+static void test_output(void)
+{
+  analysis_result result;
+  uint16_t sent[CAPTURE_SIZE / 4];
+  uint32_t sequence;
+  int i, same;
+  int32_t amplitude_mv = (int32_t)AMPLITUDE * FULL_SCALE_MV / 4096;
+
+  start(SINE, TEST_FREQUENCY);
+  run(SETTLE_SAMPLES);
+  measure(&result);
+  CHECK(result.frequency_dhz > TEST_FREQUENCY * 10 - 5 &&
+            result.frequency_dhz < TEST_FREQUENCY * 10 + 5,
+        "sine at %u.%u Hz, wanted %d Hz", (unsigned)result.frequency_dhz / 10,
+        (unsigned)result.frequency_dhz % 10, TEST_FREQUENCY);
+  CHECK(result.amplitude_mv > amplitude_mv - 5 &&
+            result.amplitude_mv < amplitude_mv + 5,
+        "sine amplitude %d mV, wanted %d mV", (int)result.amplitude_mv,
+        (int)amplitude_mv);
+  CHECK(result.offset_mv > FULL_SCALE_MV / 2 - 5 &&
+            result.offset_mv < FULL_SCALE_MV / 2 + 5,
+        "sine offset %d mV", (int)result.offset_mv);
+  CHECK(result.thd_permille <= 10, "sine THD %u permille",
+        (unsigned)result.thd_permille);
+  CHECK(diag.underruns == 0, "%u underruns", (unsigned)diag.underruns);
+
+  // the capture block holds the words that went to the DAC, control bits
+  // and all, and stops by itself when full
+  sequence = capture.sequence;
+  capture_arm();
+  for (i = 0; i < CAPTURE_SIZE / 4; i++) {
+    sent[i] = tick();
+  }
+  same = memcmp(sent, capture.words, sizeof(sent)) == 0;
+  CHECK(same, "captured words differ from the words sent");
+  CHECK((capture.words[0] >> 8 & (GAIN | SHDN)) == (GAIN | SHDN),
+        "control bits missing from the captured word 0x%04x",
+        capture.words[0]);
+  run(CAPTURE_SIZE);
+  CHECK(capture.count == CAPTURE_SIZE, "capture count %u",
+        (unsigned)capture.count);
+  CHECK(capture.sequence == sequence + 1, "capture sequence %u, wanted %u",
+        (unsigned)capture.sequence, (unsigned)sequence + 1);
+}
+
+static void test_underruns(void)
+{
+  start(SQUARE, TEST_FREQUENCY);
+  render_lag = SAFE_LAG;
+  run(SETTLE_SAMPLES);
+  CHECK(diag.underruns == 0, "%u underruns with the renderer %d ticks late",
+        (unsigned)diag.underruns, SAFE_LAG);
+
+  // kept out for longer than the queue lasts, the ISR repeats the last word
+  start(SQUARE, TEST_FREQUENCY);
+  render_lag = SAMPLE_QUEUE_SIZE;
+  run(SETTLE_SAMPLES);
+  CHECK(diag.underruns > 0, "no underruns with the renderer %d ticks late",
+        SAMPLE_QUEUE_SIZE);
+}
+
+static void test_period_switch(void)
+{
+  analysis_result result;
+  uint32_t slow = SAMPLE_PERIOD * 4 / 3;
+  int ticks = 0;
+
+  start(SINE, TEST_FREQUENCY);
+  run(SETTLE_SAMPLES);
+  render_set_sample_period(slow);
+
+  // the samples already queued still play at the old rate
+  while (TIMER_A0->CCR[0] == SAMPLE_PERIOD - 1 &&
+         ticks < 4 * SAMPLE_QUEUE_SIZE) {
+    tick();
+    ticks++;
+  }
+  CHECK(TIMER_A0->CCR[0] == slow - 1, "CCR0 is %u, wanted %u",
+        (unsigned)TIMER_A0->CCR[0], (unsigned)slow - 1);
+  CHECK(ticks > SAMPLE_QUEUE_LOW && ticks <= SAMPLE_QUEUE_SIZE + 1,
+        "clock switched after %d samples", ticks);
+  CHECK(capture.sample_rate == MHZ_24 / slow, "capture rate %u",
+        (unsigned)capture.sample_rate);
+
+  measure(&result);
+  CHECK(result.frequency_dhz > TEST_FREQUENCY * 10 - 5 &&
+            result.frequency_dhz < TEST_FREQUENCY * 10 + 5,
+        "%u.%u Hz after the switch", (unsigned)result.frequency_dhz / 10,
+        (unsigned)result.frequency_dhz % 10);
+  CHECK(diag.underruns == 0, "%u underruns", (unsigned)diag.underruns);
+}
+
+// the 12 bit level of a DAC word as a 16 bit WAV sample
+static int16_t wav_sample(uint16_t word)
+{
+  return (int16_t)(((word & 0x0FFF) - DC_BIAS) * 16);
+}
+
+// a captured block written to WAV_PATH, read back and measured again
+static void test_wav(void)
+{
+  static int16_t samples[CAPTURE_SIZE], read[CAPTURE_SIZE + 1];
+  static uint16_t levels[CAPTURE_SIZE];
+  analysis_result result;
+  uint32_t sample_rate = 0;
+  int count, i, same = 1;
+
+  start(SINE, TEST_FREQUENCY);
+  run(SETTLE_SAMPLES);
+  capture_arm();
+  run(CAPTURE_SIZE);
+  for (i = 0; i < CAPTURE_SIZE; i++) {
+    samples[i] = wav_sample(capture.words[i]);
+  }
+  CHECK(wav_write(WAV_PATH, samples, capture.count, capture.sample_rate),
+        "%s not written", WAV_PATH);
+
+  count = wav_read(WAV_PATH, read, CAPTURE_SIZE + 1, &sample_rate);
+  CHECK(count == CAPTURE_SIZE && sample_rate == capture.sample_rate,
+        "%s holds %d samples at %u Hz, wanted %d at %u Hz", WAV_PATH, count,
+        (unsigned)sample_rate, CAPTURE_SIZE, (unsigned)capture.sample_rate);
+  if (count != CAPTURE_SIZE) {
+    return;
+  }
+  for (i = 0; i < CAPTURE_SIZE; i++) {
+    levels[i] = read[i] / 16 + DC_BIAS;
+    same &= levels[i] == (capture.words[i] & 0x0FFF);
+  }
+  CHECK(same, "the samples in %s differ from the words captured", WAV_PATH);
+  analyse(levels, CAPTURE_SIZE, sample_rate, FULL_SCALE_MV, 12, &result);
+  CHECK(result.frequency_dhz > TEST_FREQUENCY * 10 - 5 &&
+            result.frequency_dhz < TEST_FREQUENCY * 10 + 5,
+        "%s plays %u.%u Hz", WAV_PATH, (unsigned)result.frequency_dhz / 10,
+        (unsigned)result.frequency_dhz % 10);
+}
+
+static uint64_t picoseconds(uint64_t cycles)
+{
+  return cycles * PS_PER_3_CYCLES / 3;
+}
+
+static void pin_change(int signal, uint32_t value)
+{
+  vcd_change(&vcd, picoseconds(now), signal, value);
+}
+
+/* pin_write
+hw_write_hook: the pins after a write to a port or eUSCI_B0. A byte sent
+on the SPI is shifted out MSB first, changed on the falling clock edge and
+taken on the rising one at SMCLK / 2. The DAC latches its 16 bits when CS
+rises after exactly that many clocks.
+*/
+static void pin_write(volatile void* reg)
+{
+  uint8_t port = DAC_CS_PORT->OUT;
+  int bit, level;
+
+  if (reg == &EUSCI_B0->TXBUF) {
+    for (bit = 7; bit >= 0; bit--) {
+      level = EUSCI_B0->TXBUF >> bit & 1;
+      pin_change(SPI_CLK, 0);
+      pin_change(SPI_SIMO, level);
+      now++;
+      pin_change(SPI_CLK, 1);
+      now++;
+      if (!dac_cs) {
+        dac_shift = dac_shift << 1 | level;
+        dac_bits++;
+      }
+    }
+    return;
+  }
+  if (reg != &DAC_CS_PORT->OUT) {
+    now++;
+    return;
+  }
+
+  if (!(port & DAC_CS_PIN) && dac_cs) {
+    dac_bits = 0;
+  }
+  if ((port & DAC_CS_PIN) && !dac_cs && dac_bits == 16) {
+    pin_change(DAC_GA, dac_shift >> 8 & GAIN ? 1 : 0);
+    pin_change(DAC_SHDN, dac_shift >> 8 & SHDN ? 1 : 0);
+    pin_change(DAC_LEVEL, dac_shift & 0x0FFF);
+  }
+  dac_cs = (port & DAC_CS_PIN) != 0;
+  pin_change(DAC_CS, dac_cs);
+  pin_change(LCD_RS, port & RS ? 1 : 0);
+  pin_change(LCD_E, port & EN ? 1 : 0);
+  pin_change(LCD_D, port >> 4);
+  now++;
+}
+
+// a byte the LCD took: a cursor address or a character
+static void lcd_byte(pin_decoder* decoder, unsigned char byte)
+{
+  if (!decoder->rs) {
+    if (byte & 0x80) {
+      decoder->line = (byte & 0x40) ? 1 : 0;
+      decoder->column = byte & 0x3F;
+    }
+    return;
+  }
+  if (decoder->column < LCD_LINESIZE) {
+    decoder->display[decoder->line][decoder->column] = byte;
+  }
+  decoder->column++;
+}
+
+// vcd_reader: the edges the DAC and the LCD act on
+static void pin_read(void* context, uint64_t time, int signal,
+                     uint32_t value)
+{
+  pin_decoder* decoder = context;
+  int old = decoder->values[signal];
+  int *values = decoder->values;
+
+  values[signal] = value;
+  if (old < 0 || old == (int)value) {
+    return;
+  }
+  if (signal == SPI_CLK && value && values[DAC_CS] == 0) {
+    decoder->shift = decoder->shift << 1 | values[SPI_SIMO];
+    if (++decoder->bits == 16 && decoder->word_count < PIN_SAMPLES) {
+      decoder->word_times[decoder->word_count] = time;
+    }
+  }
+  if (signal == DAC_CS && !value) {
+    decoder->bits = 0;
+  }
+  if (signal == DAC_CS && value && decoder->bits == 16 &&
+      decoder->word_count < PIN_SAMPLES) {
+    decoder->words[decoder->word_count++] = decoder->shift;
+  }
+  // RS is taken when E rises, the data when it falls
+  if (signal == LCD_E && value) {
+    decoder->rs = values[LCD_RS];
+  }
+  if (signal == LCD_E && !value) {
+    if (decoder->nibbles++ % 2 == 0) {
+      decoder->high = values[LCD_D];
+    }
+    else {
+      lcd_byte(decoder, decoder->high << 4 | values[LCD_D]);
+    }
+  }
+}
+
+// the DAC and LCD pins dumped to VCD_PATH while main.c drives them, and
+// decoded back from the dump
+static void test_pins(void)
+{
+  static pin_decoder decoder;
+  uint16_t sent[PIN_SAMPLES];
+  uint32_t initial[PIN_SIGNALS] = {0};
+  uint8_t port;
+  int i, signal;
+
+  LCD_init();
+  start(SINE, TEST_FREQUENCY);
+  run(SETTLE_SAMPLES);
+  // the sine key in main.c: the renderer gets 100 Hz and the display is
+  // drawn, for the LCD task to send
+  handle_key('8');
+
+  port = DAC_CS_PORT->OUT;
+  dac_cs = (port & DAC_CS_PIN) != 0;
+  dac_bits = 0;
+  if (!vcd_open(&vcd, VCD_PATH, "1ps")) {
+    CHECK(0, "%s not written", VCD_PATH);
+    return;
+  }
+  initial[SPI_CLK] = 1;  // idle high
+  initial[DAC_CS] = dac_cs;
+  initial[LCD_RS] = port & RS ? 1 : 0;
+  initial[LCD_E] = port & EN ? 1 : 0;
+  initial[LCD_D] = port >> 4;
+  for (signal = 0; signal < PIN_SIGNALS; signal++) {
+    vcd_signal(&vcd, pin_names[signal], pin_widths[signal], initial[signal]);
+  }
+  hw_write_hook = pin_write;
+  if (!hw_watch_writes(1)) {
+    printf("sample_path_test: no pin writes seen on this host, no VCD\n");
+    hw_write_hook = 0;
+    vcd_close(&vcd);
+    return;
+  }
+  sample_start = now = 0;
+  for (i = 0; i < PIN_SAMPLES; i++) {
+    sent[i] = tick();
+    if (i == PIN_SAMPLES / 2) {
+      LCD_flush();
+    }
+  }
+  hw_watch_writes(0);
+  hw_write_hook = 0;
+  CHECK(vcd_close(&vcd), "%s not written", VCD_PATH);
+
+  memset(&decoder, 0, sizeof(decoder));
+  memset(decoder.display, ' ', sizeof(decoder.display));
+  for (signal = 0; signal < PIN_SIGNALS; signal++) {
+    decoder.values[signal] = -1;
+  }
+  CHECK(vcd_read(VCD_PATH, pin_names, PIN_SIGNALS, pin_read, &decoder),
+        "%s can not be read back", VCD_PATH);
+  CHECK(decoder.word_count == PIN_SAMPLES &&
+            memcmp(decoder.words, sent, sizeof(sent)) == 0,
+        "%d DAC words decoded from %s, not the %d sent", decoder.word_count,
+        VCD_PATH, PIN_SAMPLES);
+  for (i = 1; i < decoder.word_count; i++) {
+    CHECK(decoder.word_times[i] - decoder.word_times[i - 1] ==
+              picoseconds(SAMPLE_PERIOD),
+          "DAC word %d %llu ps after the last", i,
+          (unsigned long long)(decoder.word_times[i] -
+                               decoder.word_times[i - 1]));
+  }
+  CHECK(decoder.values[DAC_GA] == 1 && decoder.values[DAC_SHDN] == 1 &&
+            decoder.values[DAC_LEVEL] == (sent[PIN_SAMPLES - 1] & 0x0FFF),
+        "the DAC latched GA %d SHDN %d level %d", decoder.values[DAC_GA],
+        decoder.values[DAC_SHDN], decoder.values[DAC_LEVEL]);
+  for (i = 0; i < LCD_LINES; i++) {
+    CHECK(memcmp(decoder.display[i], LCD_line(i), LCD_LINESIZE) == 0,
+          "LCD line %d shows \"%.*s\", drawn \"%.*s\"", i, LCD_LINESIZE,
+          decoder.display[i], LCD_LINESIZE, LCD_line(i));
+  }
+}
+
+typedef struct noise_figures {
+  double band_db;   // noise below NOISE_BAND_HZ against the tone
+  double spur_db;   // strongest bin below NOISE_BAND_HZ
+  double total_db;  // noise up to Nyquist
+} noise_figures;
+
+// play a quiet sine through output and measure its spectrum
+static noise_figures measure_noise(output_mode output)
+{
+  static double samples[NOISE_POINTS];
+  static double power[NOISE_POINTS / 2 + 1];
+  int tone = (int)((double)NOISE_FREQUENCY * NOISE_POINTS / SAMPLE_RATE + 0.5);
+  int band = (int)((double)NOISE_BAND_HZ * NOISE_POINTS / SAMPLE_RATE);
+  double signal = 0, noise = 0, total = 0, spur = 0, x;
+  noise_figures figures;
+  int i;
+
+  start_output(SINE, NOISE_FREQUENCY, NOISE_AMPLITUDE_PCT, output);
+  run(SETTLE_SAMPLES);
+  for (i = 0; i < NOISE_POINTS; i++) {
+    // the tone is not on a bin, a 4 term Blackman-Harris window keeps its
+    // leakage 92 dB down outside NOISE_SKIP_BINS
+    x = 2 * M_PI * i / NOISE_POINTS;
+    samples[i] = (tick() & 0x0FFF) * (0.35875 - 0.48829 * cos(x) +
+                                      0.14128 * cos(2 * x) -
+                                      0.01168 * cos(3 * x));
+  }
+  spectrum(samples, power, NOISE_POINTS);
+
+  for (i = NOISE_SKIP_BINS; i <= NOISE_POINTS / 2; i++) {
+    if (abs(i - tone) <= NOISE_SKIP_BINS) {
+      signal += power[i];
+      continue;
+    }
+    total += power[i];
+    if (i <= band) {
+      noise += power[i];
+      if (power[i] > spur) {
+        spur = power[i];
+      }
+    }
+  }
+  figures.band_db = spectrum_db(noise, signal);
+  figures.spur_db = spectrum_db(spur, signal);
+  figures.total_db = spectrum_db(total, signal);
+  return figures;
+}
+
+static void test_output_modes(void)
+{
+  static const char* names[] = {"round", "tpdf", "shape1", "shape2"};
+  noise_figures figures[4];
+  int mode;
+
+  for (mode = OUTPUT_ROUND; mode <= OUTPUT_SHAPE2; mode++) {
+    figures[mode] = measure_noise((output_mode)mode);
+    printf("%s: band noise %.1f dB, worst spur %.1f dB, total noise %.1f dB\n",
+           names[mode], figures[mode].band_db, figures[mode].spur_db,
+           figures[mode].total_db);
+  }
+
+  for (mode = OUTPUT_TPDF; mode <= OUTPUT_SHAPE2; mode++) {
+    CHECK(figures[mode].spur_db < figures[OUTPUT_ROUND].spur_db - 10,
+          "%s spur %.1f dB, rounding %.1f dB", names[mode],
+          figures[mode].spur_db, figures[OUTPUT_ROUND].spur_db);
+    CHECK(figures[mode].total_db > figures[OUTPUT_ROUND].total_db,
+          "%s total noise %.1f dB is below rounding %.1f dB", names[mode],
+          figures[mode].total_db, figures[OUTPUT_ROUND].total_db);
+  }
+  CHECK(figures[OUTPUT_SHAPE1].band_db < figures[OUTPUT_TPDF].band_db - 3,
+        "first order shaping band noise %.1f dB, plain dither %.1f dB",
+        figures[OUTPUT_SHAPE1].band_db, figures[OUTPUT_TPDF].band_db);
+  CHECK(figures[OUTPUT_SHAPE2].band_db < figures[OUTPUT_SHAPE1].band_db,
+        "second order shaping band noise %.1f dB, first order %.1f dB",
+        figures[OUTPUT_SHAPE2].band_db, figures[OUTPUT_SHAPE1].band_db);
+}
+
+int main(void)
+{
+  test_output();
+  test_underruns();
+  test_period_switch();
+  test_wav();
+  test_pins();
+  test_output_modes();
+  return test_report("sample_path_test");
+}
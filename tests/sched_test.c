@@ -0,0 +1,224 @@
+#include <stdint.h>
+#include <string.h>
+#include "sched.h"
+#include "sched_port.h"
+#include "test.h"
+
+/* Sched_test.c: the task scheduler against a simulated clock
+ *
+ * The port hooks here replace SysTick, the cycle counter and WFI. Time only
+ * passes when a task burns cycles with busy() or the scheduler sleeps,
+ * which runs to the next tick. So run counts, misses and idle cycles are
+ * exact.
+ */
+
+#define CPU_HZ 1000000
+#define TICK_CYCLES (CPU_HZ / SCHED_TICK_HZ)
+#define LOG_SIZE 64
+
+static uint32_t cycles;           // simulated cycle counter
+static uint32_t next_tick;        // cycle count of the next tick
+static int locked = 0;            // interrupts masked by sched_port_lock()
+static int sleeps_unlocked = 0;   // sleeps without the lock, must stay 0
+
+static char run_log[LOG_SIZE];      // first letter of each task that ran
+static int log_count;
+static uint32_t fast_at[LOG_SIZE];  // ticks the fast task ran at
+static int fast_count;
+static uint32_t hog_ticks;     // run time of the hog task, in ticks
+static uint32_t light_cycles;  // run time of the light task
+
+void sched_port_init(uint32_t cpu_hz)
+{
+  cycles = 0;
+  next_tick = TICK_CYCLES;
+}
+
+uint32_t sched_port_cycles(void)
+{
+  return cycles;
+}
+
+void sched_port_lock(void)
+{
+  locked = 1;
+}
+
+void sched_port_unlock(void)
+{
+  locked = 0;
+}
+
+// let time pass, with a tick at every multiple of TICK_CYCLES
+static void busy(uint32_t count)
+{
+  while (count >= next_tick - cycles) {
+    count -= next_tick - cycles;
+    cycles = next_tick;
+    next_tick += TICK_CYCLES;
+    sched_tick();
+  }
+  cycles += count;
+}
+
+// WFI: asleep until the tick
+void sched_port_sleep(void)
+{
+  if (!locked) {
+    sleeps_unlocked++;
+  }
+  busy(next_tick - cycles);
+}
+
+static void note(char name)
+{
+  if (log_count < LOG_SIZE - 1) {
+    run_log[log_count++] = name;
+  }
+}
+
+static void task_a(void) { note('a'); }
+static void task_b(void) { note('b'); }
+static void task_c(void) { note('c'); }
+static void task_fast(void)
+{
+  note('f');
+  if (fast_count < LOG_SIZE) {
+    fast_at[fast_count++] = sched_now();
+  }
+}
+
+static void task_hog(void)
+{
+  note('h');
+  busy(hog_ticks * TICK_CYCLES);
+}
+
+static void task_light(void)
+{
+  busy(light_cycles);
+}
+
+static void start(void)
+{
+  sched_init(CPU_HZ);
+  memset(run_log, 0, sizeof(run_log));
+  log_count = 0;
+  fast_count = 0;
+  sleeps_unlocked = 0;
+}
+
+static void run_until(uint32_t tick)
+{
+  while ((int32_t)(sched_now() - tick) < 0) {
+    sched_step();
+  }
+}
+
+// released together, the tasks run earliest deadline first, whatever the
+// order they were added in
+static void test_edf_order(void)
+{
+  start();
+  sched_add("a", task_a, 10, 9);
+  sched_add("b", task_b, 10, 3);
+  sched_add("c", task_c, 10, 6);
+  run_until(21);
+  CHECK(strcmp(run_log, "bcabca") == 0, "ran \"%s\", wanted \"bcabca\"",
+        run_log);
+
+  // a later release with an earlier absolute deadline goes first
+  start();
+  sched_add("a", task_a, 5, 5);    // released at 1, 6, .. due at 6, 11
+  sched_add("b", task_b, 100, 1);  // released at 1, due at 2
+  run_until(7);
+  CHECK(strcmp(run_log, "baa") == 0, "ran \"%s\", wanted \"baa\"", run_log);
+  CHECK(sleeps_unlocked == 0, "slept %d times without the lock",
+        sleeps_unlocked);
+}
+
+static void test_misses(void)
+{
+  static const uint32_t skipped[] = {26, 27, 37, 47, 57};
+  const sched_task* hog;
+  const sched_task* fast;
+  int hog_id, fast_id;
+  int i;
+
+  // the hog takes 1 tick and its deadline is 1, the fast task waits a tick
+  // and still makes its deadline of 2
+  start();
+  hog_ticks = 1;
+  hog_id = sched_add("hog", task_hog, 10, 1);
+  fast_id = sched_add("fast", task_fast, 10, 2);
+  run_until(101);
+  hog = sched_task_info(hog_id);
+  fast = sched_task_info(fast_id);
+  CHECK(hog->runs == 10 && fast->runs == 10, "runs %u and %u, wanted 10",
+        (unsigned)hog->runs, (unsigned)fast->runs);
+  CHECK(hog->misses == 0 && fast->misses == 0, "misses %u and %u, wanted 0",
+        (unsigned)hog->misses, (unsigned)fast->misses);
+
+  // taking 3 ticks, both miss every time
+  start();
+  hog_ticks = 3;
+  hog_id = sched_add("hog", task_hog, 10, 1);
+  fast_id = sched_add("fast", task_fast, 10, 2);
+  run_until(101);
+  hog = sched_task_info(hog_id);
+  fast = sched_task_info(fast_id);
+  CHECK(hog->misses == 10 && fast->misses == 10,
+        "misses %u and %u, wanted 10", (unsigned)hog->misses,
+        (unsigned)fast->misses);
+  CHECK(hog->cycles_max == 3 * TICK_CYCLES, "hog cycles_max %u",
+        (unsigned)hog->cycles_max);
+
+  // held up for 2.5 periods, the fast task runs late once, then is
+  // released again on the next tick and keeps its period from there instead
+  // of catching up on the two releases it missed
+  start();
+  hog_ticks = 25;
+  sched_add("hog", task_hog, 100, 1);
+  fast_id = sched_add("fast", task_fast, 10, 10);
+  run_until(60);
+  fast = sched_task_info(fast_id);
+  CHECK(fast_count == 5, "fast ran %d times, wanted 5", fast_count);
+  for (i = 0; i < fast_count && i < 5; i++) {
+    CHECK(fast_at[i] == skipped[i], "run %d of fast at tick %u, wanted %u",
+          i, (unsigned)fast_at[i], (unsigned)skipped[i]);
+  }
+  CHECK(fast->misses == 1, "fast missed %u, wanted 1",
+        (unsigned)fast->misses);
+}
+
+// idle is the time asleep: everything the tasks did not use
+static void test_idle(void)
+{
+  const sched_task* light;
+  uint32_t total, idle;
+  int id;
+
+  start();
+  light_cycles = 200;
+  id = sched_add("light", task_light, 10, 10);
+  run_until(1001);
+  light = sched_task_info(id);
+  total = sched_port_cycles();
+  idle = sched_idle_cycles();
+  CHECK(light->runs == 100, "light ran %u times", (unsigned)light->runs);
+  CHECK(light->cycles_total == 100 * light_cycles, "light used %u cycles",
+        (unsigned)light->cycles_total);
+  CHECK(idle == total - light->cycles_total,
+        "idle %u cycles of %u, tasks used %u", (unsigned)idle,
+        (unsigned)total, (unsigned)light->cycles_total);
+  CHECK(idle / (total / 1000) == 980, "idle %u permille, wanted 980",
+        (unsigned)(idle / (total / 1000)));
+}
+
+int main(void)
+{
+  test_edf_order();
+  test_misses();
+  test_idle();
+  return test_report("sched_test");
+}
@@ -0,0 +1,160 @@
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "flash.h"
+#include "governor.h"
+#include "sequence.h"
+#include "test.h"
+
+/* Sequence_test.c: storing, validating and playing sequences
+ *
+ * The flash sector a sequence is stored in is plain memory mapped at
+ * SEQ_FLASH_ADDR, so sequence_store() and sequence_init() run as they do on
+ * the board. The renderer's side is the test's: render_sample_rate() gives
+ * the rate the governor would have set, and the steps are pulled with
+ * sequence_next() as the renderer does when one runs out.
+ *
+ * A step is only checked against the full rate when the sequence is
+ * stored. Played at a lower rate, a step at or above half of it must end
+ * the sequence instead of being rendered.
+ */
+
+#define STEP_MS 10
+
+static const uint16_t periods[GOVERNOR_LEVELS] = GOVERNOR_PERIODS;
+static uint32_t sample_rate = SAMPLE_RATE;
+
+uint32_t render_sample_rate(void)
+{
+  return sample_rate;
+}
+
+uint32_t render_phase_increment(uint32_t frequency)
+{
+  return (uint32_t)(((uint64_t)frequency << 32) / sample_rate);
+}
+
+void render_sequence(int play)
+{
+}
+
+int render_sequence_running(void)
+{
+  return 0;
+}
+
+int flash_erase_sector(uint32_t address)
+{
+  memset((void*)(uintptr_t)address, 0xFF, FLASH_SECTOR_SIZE);
+  return 1;
+}
+
+int flash_program(uint32_t address, const uint32_t* words, int count)
+{
+  memcpy((void*)(uintptr_t)address, words, count * 4);
+  return 1;
+}
+
+// a sine and a square near the top of the full rate's band, played twice
+static const seq_step program[] = {
+  {SEQ_LOOP, 0, 0, 0, 0, 2},
+  {SEQ_STEP, SINE, 0, 100, 1000, STEP_MS},
+  {SEQ_STEP, SQUARE, 50, 100, 12000, STEP_MS},
+  {SEQ_NEXT, 0, 0, 0, 0, 0},
+};
+#define PROGRAM_STEPS 4
+
+// returns 1 if the next step plays frequency for STEP_MS
+static int plays(int frequency)
+{
+  gen_config config;
+  uint32_t samples = 0;
+
+  config.frequency = 0;
+  if (!sequence_next(&config, &samples)) {
+    return 0;
+  }
+  CHECK(samples == sample_rate * STEP_MS / 1000,
+        "%u Hz for %u samples at %u Hz", (unsigned)config.frequency,
+        (unsigned)samples, (unsigned)sample_rate);
+  return config.frequency == frequency;
+}
+
+// returns 1 if the sequence has no step left to play
+static int ended(void)
+{
+  gen_config config;
+  uint32_t samples;
+
+  return !sequence_next(&config, &samples);
+}
+
+static void test_validate(void)
+{
+  seq_step step = {SEQ_STEP, SINE, 0, 100, SAMPLE_RATE / 2 - 1, 100};
+
+  CHECK(sequence_validate(&step, 1), "%u Hz rejected",
+        (unsigned)step.frequency);
+  step.frequency = SAMPLE_RATE / 2;
+  CHECK(!sequence_validate(&step, 1), "%u Hz accepted",
+        (unsigned)step.frequency);
+  step.wave = PULSE;
+  step.duty_pct = 50;
+  step.frequency = 500000;
+  CHECK(sequence_validate(&step, 1), "a 500 kHz pulse rejected");
+
+  // the stored program fits the full rate but not the lower ones
+  CHECK(sequence_validate(program, PROGRAM_STEPS), "the program rejected");
+  CHECK(sequence_store(program, PROGRAM_STEPS), "the program not stored");
+}
+
+static void test_full_rate(void)
+{
+  sample_rate = SAMPLE_RATE;
+  sequence_rewind();
+  CHECK(plays(1000) && plays(12000) && plays(1000) && plays(12000),
+        "the program did not play at %u Hz", (unsigned)sample_rate);
+  CHECK(ended(), "the program did not end");
+}
+
+// the governor's lower rates put the square above half the rate
+static void test_lower_rates(void)
+{
+  int level;
+
+  for (level = 1; level < GOVERNOR_LEVELS; level++) {
+    sample_rate = MHZ_24 / periods[level];
+    sequence_rewind();
+    CHECK(plays(1000), "the sine did not play at %u Hz",
+          (unsigned)sample_rate);
+    CHECK(ended(), "12 kHz played at %u Hz", (unsigned)sample_rate);
+    // ended for good, also if the rate comes back up
+    sample_rate = SAMPLE_RATE;
+    CHECK(ended(), "the sequence went on after the rejected step");
+  }
+
+  // the rate drops while the sequence plays
+  sample_rate = SAMPLE_RATE;
+  sequence_rewind();
+  CHECK(plays(1000) && plays(12000) && plays(1000), "the first steps");
+  sample_rate = MHZ_24 / periods[1];
+  CHECK(ended(), "12 kHz played after the rate dropped to %u Hz",
+        (unsigned)sample_rate);
+}
+
+int main(void)
+{
+  void* sector = mmap((void*)(uintptr_t)SEQ_FLASH_ADDR, FLASH_SECTOR_SIZE,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1,
+                      0);
+
+  if (sector != (void*)(uintptr_t)SEQ_FLASH_ADDR) {
+    printf("sequence_test: can not map the flash sector\n");
+    return 1;
+  }
+  test_validate();
+  test_full_rate();
+  test_lower_rates();
+  return test_report("sequence_test");
+}
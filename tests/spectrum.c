@@ -0,0 +1,58 @@
+#include "spectrum.h"
+#include <math.h>
+#include <stdlib.h>
+
+/* Spectrum.c: power spectrum for the host tests
+ *
+ * A plain iterative radix 2 FFT. The tests pick their test tones on bin
+ * centres, so no window is applied.
+ */
+
+#define PI 3.14159265358979323846
+
+void spectrum(const double* samples, double* power, int n)
+{
+  double* re = malloc(n * sizeof(double));
+  double* im = malloc(n * sizeof(double));
+  int i, j, bit, len, k;
+
+  for (i = 0, j = 0; i < n; i++) {
+    re[j] = samples[i];
+    im[j] = 0;
+    // bit reversed index for the next i
+    for (bit = n >> 1; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j |= bit;
+  }
+
+  for (len = 2; len <= n; len <<= 1) {
+    double angle = -2 * PI / len;
+    for (i = 0; i < n; i += len) {
+      for (k = 0; k < len / 2; k++) {
+        double wr = cos(angle * k), wi = sin(angle * k);
+        int a = i + k, b = i + k + len / 2;
+        double tr = re[b] * wr - im[b] * wi;
+        double ti = re[b] * wi + im[b] * wr;
+        re[b] = re[a] - tr;
+        im[b] = im[a] - ti;
+        re[a] += tr;
+        im[a] += ti;
+      }
+    }
+  }
+
+  for (i = 0; i <= n / 2; i++) {
+    power[i] = re[i] * re[i] + im[i] * im[i];
+  }
+  free(re);
+  free(im);
+}
+
+double spectrum_db(double power, double reference)
+{
+  if (power <= 0) {
+    return -300;
+  }
+  return 10 * log10(power / reference);
+}
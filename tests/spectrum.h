@@ -0,0 +1,9 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+// power of each bin 0 - n/2 of a real block, n must be a power of 2
+void spectrum(const double* samples, double* power, int n);
+// power in dB relative to reference
+double spectrum_db(double power, double reference);
+
+#endif
@@ -0,0 +1,282 @@
+#include <stdint.h>
+#include "sync_core.h"
+#include "test.h"
+
+/* Sync_test.c: a leader and a follower board against each other
+ *
+ * Time runs in units of a millionth of the leader's sample period. The
+ * follower's own clock is OWN_PPM faster, about what the DCO is off by.
+ * While it follows, the follower ticks on the leader's clock edges, right
+ * after the leader, and reads the pulse line the leader just set, as the
+ * sample ISRs do. On its own clock it ticks on its own schedule. A
+ * scheduler task polls sync_core_fallback() every POLL_MS and moves the
+ * follower over to its own clock, as sync_poll() does.
+ */
+
+#define TEST_RATE 27027  // SAMPLE_RATE
+#define LEADER_PERIOD 1000000
+#define OWN_PPM 1000
+#define OWN_PERIOD (LEADER_PERIOD - LEADER_PERIOD / 1000000 * OWN_PPM)
+#define UNITS_PER_MS ((uint64_t)TEST_RATE * LEADER_PERIOD / 1000)
+#define POLL_MS 20      // the sync task's period
+#define SYNC_DELAY 128  // RENDER_SYNC_DELAY
+#define RESET_AHEAD 40  // queue fill when the leader marks a reset
+#define NEVER UINT64_MAX
+
+typedef struct board {
+  sync_core core;
+  uint64_t next;        // time of the next tick on its own clock, or NEVER
+  uint32_t tick;        // sample ticks so far
+  uint64_t reset_time;  // when the last phase reset plays
+} board;
+
+static board leader, follower;
+static uint64_t now;
+static uint64_t next_ms;
+static uint32_t ms;
+static int line;          // pulse line level
+static int line_broken;   // the follower reads the line low
+static int following;     // the follower ticks on the leader's clock
+static int clock_broken;  // the follower gets no clock edges
+static uint32_t reset_mark;  // leader tick marked for a phase reset, or 0
+static uint32_t heartbeats;  // pulses the leader sent
+static int events;           // SYNC_FOLLOW_ flags seen
+static uint64_t fallback_time;
+
+static void follower_tick(uint64_t period)
+{
+  uint32_t age;
+  int happened;
+
+  follower.tick++;
+  happened = sync_core_follow(&follower.core, line_broken ? 0 : line, &age);
+  if (happened & SYNC_FOLLOW_RESET) {
+    follower.reset_time = now + (SYNC_DELAY - age) * period;
+  }
+  events |= happened;
+}
+
+static void leader_tick(void)
+{
+  int due, level;
+
+  leader.tick++;
+  due = leader.tick == reset_mark;
+  level = sync_core_lead(&leader.core, due, !due && reset_mark > leader.tick);
+  if (due) {
+    leader.reset_time = now + SYNC_DELAY * (uint64_t)LEADER_PERIOD;
+    reset_mark = 0;
+  }
+  if (level && !line) {
+    heartbeats++;
+  }
+  line = level;
+  leader.next += LEADER_PERIOD;
+
+  if (following && !clock_broken) {
+    follower_tick(LEADER_PERIOD);
+  }
+}
+
+static void poll(void)
+{
+  ms++;
+  next_ms += UNITS_PER_MS;
+  if (ms % POLL_MS == 0 && following &&
+      sync_core_fallback(&follower.core, ms)) {
+    following = 0;
+    follower.next = now + OWN_PERIOD;
+    fallback_time = now;
+  }
+}
+
+// run both boards until time
+static void run(uint64_t until)
+{
+  while (1) {
+    now = leader.next;
+    if (!following && follower.next < now) {
+      now = follower.next;
+    }
+    if (next_ms < now) {
+      now = next_ms;
+    }
+    if (now > until) {
+      now = until;
+      return;
+    }
+
+    if (now == next_ms) {
+      poll();
+    }
+    else if (now == leader.next) {
+      leader_tick();
+    }
+    else {
+      follower_tick(OWN_PERIOD);
+      follower.next += OWN_PERIOD;
+    }
+  }
+}
+
+static uint64_t ticks_to_time(uint32_t ticks)
+{
+  return (uint64_t)ticks * LEADER_PERIOD;
+}
+
+// the leader starts on its own, the follower joins join_at ticks later
+static void start(uint32_t join_at)
+{
+  now = 0;
+  ms = 0;
+  next_ms = UNITS_PER_MS;
+  line = 0;
+  line_broken = 0;
+  clock_broken = 0;
+  following = 0;
+  reset_mark = 0;
+  fallback_time = 0;
+  sync_core_init(&leader.core, 0);
+  leader.tick = 0;
+  leader.next = LEADER_PERIOD;
+  follower.tick = 0;
+  follower.next = NEVER;
+  follower.reset_time = 0;
+
+  run(ticks_to_time(join_at) + 1);
+  sync_core_init(&follower.core, ms);
+  following = 1;
+  heartbeats = 0;
+  events = 0;
+}
+
+// a follower that joins half way through an interval locks within
+// SYNC_LOCK_PULSES heartbeats after the first it sees
+static void test_lock(void)
+{
+  static const uint32_t joins[] = {1, 300, SYNC_PULSE_INTERVAL - 1, 5000};
+  uint32_t limit = (SYNC_LOCK_PULSES + 1) * SYNC_PULSE_INTERVAL;
+  uint32_t locked_after, t;
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    start(joins[i]);
+    locked_after = 0;
+    for (t = 0; t < 2 * limit && !(events & SYNC_FOLLOW_LOCKED); t++) {
+      run(now + LEADER_PERIOD);
+      locked_after = heartbeats;
+    }
+    CHECK(events & SYNC_FOLLOW_LOCKED, "joining at %u, no lock in %u ticks",
+          (unsigned)joins[i], 2 * (unsigned)limit);
+    CHECK(locked_after <= SYNC_LOCK_PULSES + 1,
+          "joining at %u, locked after %u heartbeats, wanted %d",
+          (unsigned)joins[i], (unsigned)locked_after, SYNC_LOCK_PULSES + 1);
+    CHECK(!(events & (SYNC_FOLLOW_UNLOCKED | SYNC_FOLLOW_LOST)),
+          "joining at %u, events 0x%x", (unsigned)joins[i], events);
+  }
+}
+
+// both boards play a phase reset at the same moment and stay locked,
+// also when the reset holds a heartbeat back
+static void test_reset(void)
+{
+  static const uint32_t marks[] = {300, SYNC_PULSE_INTERVAL - 10};
+  uint32_t ahead;
+  int i;
+
+  start(300);
+  run(now + ticks_to_time(10 * SYNC_PULSE_INTERVAL));
+  CHECK(follower.core.locked, "not locked before the resets");
+  for (i = 0; i < 2; i++) {
+    // mark when the leader is this far into an interval
+    ahead = (marks[i] + SYNC_PULSE_INTERVAL - leader.core.since) %
+            SYNC_PULSE_INTERVAL;
+    run(now + ticks_to_time(ahead));
+    reset_mark = leader.tick + RESET_AHEAD;
+    events = 0;
+    run(now + ticks_to_time(3 * SYNC_PULSE_INTERVAL));
+    CHECK(events & SYNC_FOLLOW_RESET, "reset %d not seen", i);
+    CHECK(follower.reset_time == leader.reset_time,
+          "reset %d at %.3f ticks, the leader's at %.3f", i,
+          (double)follower.reset_time / LEADER_PERIOD,
+          (double)leader.reset_time / LEADER_PERIOD);
+    CHECK(follower.core.locked && !(events & SYNC_FOLLOW_UNLOCKED),
+          "reset %d lost the lock, events 0x%x", i, events);
+  }
+}
+
+// on its own clock a board never sees the heartbeats on time
+static void test_own_clock(void)
+{
+  start(300);
+  following = 0;
+  follower.next = now + OWN_PERIOD;
+  run(now + ticks_to_time(50 * SYNC_PULSE_INTERVAL));
+  CHECK(!(events & SYNC_FOLLOW_LOCKED), "locked %d ppm off", OWN_PPM);
+  CHECK(!(events & SYNC_FOLLOW_LOST), "lost the pulses, events 0x%x",
+        events);
+}
+
+// with the line broken the follower goes back to its own clock and drifts
+// off the leader by OWN_PPM
+static void test_pulse_lost(void)
+{
+  uint64_t broken_at;
+  uint32_t limit_ms = (SYNC_LOSS_PULSES + 1) * SYNC_PULSE_INTERVAL * 1000 /
+                      TEST_RATE + POLL_MS;
+  uint32_t leader_ticks, follower_ticks, drift, wanted;
+
+  start(300);
+  run(now + ticks_to_time(10 * SYNC_PULSE_INTERVAL));
+  line_broken = 1;
+  broken_at = now;
+  run(now + 2 * limit_ms * UNITS_PER_MS);
+  CHECK(events & SYNC_FOLLOW_LOST, "pulse loss not seen");
+  CHECK(!follower.core.locked, "still locked");
+  CHECK(!following && fallback_time - broken_at <= limit_ms * UNITS_PER_MS,
+        "no fallback within %u ms", (unsigned)limit_ms);
+
+  // free running, ahead of the leader by OWN_PPM
+  leader_ticks = leader.tick;
+  follower_ticks = follower.tick;
+  run(now + ticks_to_time(1000000));
+  leader_ticks = leader.tick - leader_ticks;
+  follower_ticks = follower.tick - follower_ticks;
+  drift = follower_ticks - leader_ticks;
+  wanted = (uint32_t)((uint64_t)leader_ticks *
+                      (LEADER_PERIOD - OWN_PERIOD) / OWN_PERIOD);
+  CHECK(drift + 1 >= wanted && drift <= wanted + 1,
+        "drifted %u ticks in %u, wanted %u", (unsigned)drift,
+        (unsigned)leader_ticks, (unsigned)wanted);
+}
+
+// without the leader's clock the sample ticks stop, the scheduler notices
+static void test_clock_lost(void)
+{
+  uint64_t broken_at;
+  uint32_t ticks, after_ms;
+
+  start(300);
+  run(now + ticks_to_time(10 * SYNC_PULSE_INTERVAL));
+  clock_broken = 1;
+  broken_at = now;
+  run(now + 200 * UNITS_PER_MS);
+  after_ms = (uint32_t)((fallback_time - broken_at) / UNITS_PER_MS);
+  CHECK(!following, "no fallback with the clock gone");
+  CHECK(after_ms <= SYNC_LOSS_MS + POLL_MS, "fallback after %u ms, wanted %d",
+        (unsigned)after_ms, SYNC_LOSS_MS + POLL_MS);
+  ticks = follower.tick;
+  run(now + ticks_to_time(1000));
+  CHECK(follower.tick - ticks >= 1000, "%u ticks on its own clock",
+        (unsigned)(follower.tick - ticks));
+}
+
+int main(void)
+{
+  test_lock();
+  test_reset();
+  test_own_clock();
+  test_pulse_lost();
+  test_clock_lost();
+  return test_report("sync_test");
+}
@@ -0,0 +1,440 @@
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "spectrum.h"
+#include "synth.h"
+#include "test.h"
+#include "wavetable.h"
+
+/* Synth_test.c: host checks of the oscillator kernels in synth.c
+ *
+ * Aliasing: a square and a sawtooth are rendered at the generator's sample
+ * rate with the naive and the PolyBLEP kernel. The test tone sits on bin
+ * ALIAS_BIN of an ALIAS_POINTS point FFT, and as the bin is odd and the
+ * block a power of 2, folded harmonics never land on a true one. Every bin
+ * that is not a harmonic below Nyquist is aliasing.
+ *
+ * Presets: the original firmware counted samples in TA0_0_IRQHandler for
+ * its square and sawtooth, with get_points_per_cycle() samples per cycle at
+ * the 100 - 500 Hz presets. Those waves repeat after a whole number of
+ * samples, so their aliases fall onto the harmonics instead of between them
+ * and are measured against the Fourier series of the wave, over one period,
+ * with the edges half way between samples where they alias least. The
+ * phase accumulator waves repeat after a fraction of a sample, so every
+ * harmonic below Nyquist is fitted and removed from a windowed block and
+ * what is left is aliasing. PolyBLEP must beat the original at every preset.
+ * The naive kernel, used below BLEP_MIN_INC, must alias within
+ * NAIVE_MARGIN_DB at 50 Hz of what PolyBLEP does at 1234 Hz.
+ *
+ * Sine: both precisions of synth_sine() are compared with sin() at every
+ * SINE_STEP-th phase. The 12 bit kernel drops the low 15 bits of the phase
+ * anyway, so the step misses nothing there.
+ *
+ * The original firmware's sine, Bhaskara's approximation on whole degrees
+ * in sine_approx(), is the reference both must beat.
+ *
+ * "synth_test bench" gives the largest error and the host cycles per sample
+ * of the two sine kernels, of sine_approx() and of the table path the
+ * renderer uses for additive synthesis, a 256 point table read through
+ * wavetable_lookup() with linear interpolation.
+ */
+
+#define ALIAS_POINTS 4096
+#define ALIAS_BIN 187  // 1234 Hz at 27027 Hz
+// aliases must be this much weaker than with the naive kernel, in dB. The
+// two sample residual does least for the aliases folded close to Nyquist:
+// about 14 dB less aliasing in total, but only 8 dB in the top half.
+#define ALIAS_GAIN_MIN_DB 12.0
+#define ALIAS_TOP_GAIN_MIN_DB 6.0
+
+#define PRESETS 5
+#define PRESET_POINTS 16384
+#define PRESET_RATE 27027.0  // SAMPLE_RATE
+// least improvement over the original waves at the presets, in dB
+#define PRESET_GAIN_MIN_DB 4.0
+#define NAIVE_TEST_HZ 50.0
+#define NAIVE_LIMIT_HZ 1234.0
+#define NAIVE_MARGIN_DB 1.5
+
+#define SINE_STEP 256
+// largest error allowed against sin() scaled to Q15 and clipped like the
+// kernel, in LSBs
+#define SINE_12BIT_MAX_LSB 5.5  // 1.5e-4 of full scale
+#define SINE_16BIT_MAX_LSB 0.6  // rounding to Q15 only
+
+#define BENCH_CALLS 20000000
+#define BENCH_TABLE_BITS 8
+
+typedef struct alias_figures {
+  double total_db;  // all aliases against the fundamental
+  double top_db;    // strongest alias in the upper half of the band
+} alias_figures;
+
+// the naive kernels: the same waves without the PolyBLEP residual
+static float naive_square(uint32_t phase, float duty_cycle)
+{
+  return (phase * PHASE_SCALE < duty_cycle) ? 1.0f : 0.0f;
+}
+
+static float naive_sawtooth(uint32_t phase)
+{
+  return phase * PHASE_SCALE;
+}
+
+static int is_harmonic(int bin)
+{
+  return bin % ALIAS_BIN == 0;
+}
+
+// render one wave (0 square, 1 sawtooth) and measure its aliasing
+static alias_figures measure_aliasing(int wave, int blep)
+{
+  static double samples[ALIAS_POINTS];
+  static double power[ALIAS_POINTS / 2 + 1];
+  uint32_t inc = (uint32_t)(((uint64_t)ALIAS_BIN << 32) / ALIAS_POINTS);
+  uint32_t phase = 0;
+  double fundamental, total = 0, top = 0;
+  alias_figures figures;
+  int i;
+
+  for (i = 0; i < ALIAS_POINTS; i++) {
+    if (wave == 0) {
+      samples[i] = blep ? synth_square(phase, inc, 0.5f)
+                        : naive_square(phase, 0.5f);
+    }
+    else {
+      samples[i] = blep ? synth_sawtooth(phase, inc) : naive_sawtooth(phase);
+    }
+    phase += inc;
+  }
+  spectrum(samples, power, ALIAS_POINTS);
+
+  fundamental = power[ALIAS_BIN];
+  for (i = 1; i <= ALIAS_POINTS / 2; i++) {
+    if (is_harmonic(i)) {
+      continue;
+    }
+    total += power[i];
+    if (i >= ALIAS_POINTS / 4 && power[i] > top) {
+      top = power[i];
+    }
+  }
+  figures.total_db = spectrum_db(total, fundamental);
+  figures.top_db = spectrum_db(top, fundamental);
+  return figures;
+}
+
+static void test_aliasing(void)
+{
+  static const char* names[] = {"square", "sawtooth"};
+  alias_figures naive, blep;
+  int wave;
+
+  for (wave = 0; wave < 2; wave++) {
+    naive = measure_aliasing(wave, 0);
+    blep = measure_aliasing(wave, 1);
+    printf("%s aliasing: naive %.1f dB (top %.1f dB), "
+           "polyblep %.1f dB (top %.1f dB)\n",
+           names[wave], naive.total_db, naive.top_db, blep.total_db,
+           blep.top_db);
+    CHECK(naive.total_db - blep.total_db >= ALIAS_GAIN_MIN_DB,
+          "%s: polyblep removes only %.1f dB of aliasing", names[wave],
+          naive.total_db - blep.total_db);
+    CHECK(naive.top_db - blep.top_db >= ALIAS_TOP_GAIN_MIN_DB,
+          "%s: polyblep removes only %.1f dB near Nyquist", names[wave],
+          naive.top_db - blep.top_db);
+  }
+}
+
+// the preset frequencies and get_points_per_cycle() of the original firmware
+static const int preset_hz[PRESETS] = {100, 200, 300, 400, 500};
+static const int preset_points[PRESETS] = {270, 135, 90, 68, 54};
+
+/* original_wave
+fill y with one period of the original firmware's square (wave 0, 50% duty)
+or sawtooth (1) for points samples per cycle, scaled to 0.0 - 1.0. Returns
+the period in samples and sets duty to the high fraction of the square.
+*/
+static int original_wave(int wave, int points, double* y, double* duty)
+{
+  int int_counter = 0, square_mode = 1;
+  int on_count = points * 0.5f;
+  int saw_step = 2047 / points;  // AMPLITUDE / points
+  int dac_level = 2048;          // DC_BIAS
+  int period, n;
+
+  if (wave == 0) {
+    period = points + 1;
+    for (n = 0; n < period; n++) {
+      if (int_counter > points) {
+        int_counter = 0;
+        square_mode = 1;
+      }
+      else if (int_counter > on_count) {
+        square_mode = 0;
+      }
+      y[n] = square_mode;
+      int_counter += 1;
+    }
+    *duty = (on_count + 1.0) / period;
+  }
+  else {
+    period = 2047 / saw_step + 1;
+    for (n = 0; n < period; n++) {
+      if (dac_level > 4095) {
+        dac_level = 2048;
+      }
+      y[n] = (dac_level - 2048) / (double)(saw_step * period);
+      dac_level += saw_step;
+    }
+    *duty = 0;
+  }
+  return period;
+}
+
+// returns the band-limited square (wave 0) or sawtooth (1) at phase t, in
+// cycles, made of the harmonics below half of period samples per cycle
+static double band_limited(int wave, double t, double duty, double period)
+{
+  double value = wave == 0 ? duty : 0.5;
+  int k;
+
+  for (k = 1; k < period / 2; k++) {
+    if (wave == 0) {
+      value += 2 / (M_PI * k) * sin(M_PI * k * duty) *
+               cos(2 * M_PI * k * (t - duty / 2));
+    }
+    else {
+      value -= sin(2 * M_PI * k * t) / (M_PI * k);
+    }
+  }
+  return value;
+}
+
+// returns the power of the fundamental of the square or sawtooth
+static double fundamental_power(int wave, double duty)
+{
+  double amplitude = wave == 0 ? 2 / M_PI * sin(M_PI * duty) : 1 / M_PI;
+
+  return amplitude * amplitude / 2;
+}
+
+// returns the aliasing of the original wave at points per cycle, in dB
+static double original_alias_db(int wave, int points)
+{
+  static double y[PRESET_POINTS];
+  double duty, error = 0, x;
+  int period, n;
+
+  period = original_wave(wave, points, y, &duty);
+  for (n = 0; n < period; n++) {
+    x = y[n] - band_limited(wave, (n + 0.5) / period, duty, period);
+    error += x * x;
+  }
+  return spectrum_db(error / period, fundamental_power(wave, duty));
+}
+
+// returns the aliasing of synth_square() or synth_sawtooth() at frequency,
+// in dB
+static double kernel_alias_db(int wave, double frequency)
+{
+  static double y[PRESET_POINTS], window[PRESET_POINTS];
+  uint32_t inc = (uint32_t)(frequency / PRESET_RATE * 4294967296.0 + 0.5);
+  uint32_t phase = 0;
+  double w, re, im, window_sum = 0, error = 0, x;
+  int k, n;
+
+  frequency = inc * PRESET_RATE / 4294967296.0;
+  for (n = 0; n < PRESET_POINTS; n++) {
+    y[n] = wave == 0 ? synth_square(phase, inc, 0.5f)
+                     : synth_sawtooth(phase, inc);
+    phase += inc;
+    x = 2 * M_PI * n / PRESET_POINTS;
+    window[n] = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x) -
+                0.01168 * cos(3 * x);
+    window_sum += window[n];
+  }
+
+  // DC and every harmonic, measured through the window and taken out
+  for (k = 0; k * frequency < PRESET_RATE / 2; k++) {
+    w = 2 * M_PI * k * frequency / PRESET_RATE;
+    re = im = 0;
+    for (n = 0; n < PRESET_POINTS; n++) {
+      re += window[n] * y[n] * cos(w * n);
+      im += window[n] * y[n] * sin(w * n);
+    }
+    re *= (k ? 2 : 1) / window_sum;
+    im *= (k ? 2 : 1) / window_sum;
+    for (n = 0; n < PRESET_POINTS; n++) {
+      y[n] -= re * cos(w * n) + im * sin(w * n);
+    }
+  }
+  for (n = 0; n < PRESET_POINTS; n++) {
+    error += window[n] * y[n] * y[n];
+  }
+  return spectrum_db(error / window_sum, fundamental_power(wave, 0.5));
+}
+
+static void test_presets(void)
+{
+  static const char* names[] = {"square", "sawtooth"};
+  double original, kernel, naive, limit;
+  int wave, i;
+
+  for (wave = 0; wave < 2; wave++) {
+    for (i = 0; i < PRESETS; i++) {
+      original = original_alias_db(wave, preset_points[i]);
+      kernel = kernel_alias_db(wave, preset_hz[i]);
+      printf("%s %d Hz aliasing: original %.1f dB, polyblep %.1f dB\n",
+             names[wave], preset_hz[i], original, kernel);
+      CHECK(original - kernel >= PRESET_GAIN_MIN_DB,
+            "%s %d Hz: polyblep %.1f dB, the original %.1f dB", names[wave],
+            preset_hz[i], kernel, original);
+    }
+
+    naive = kernel_alias_db(wave, NAIVE_TEST_HZ);
+    limit = kernel_alias_db(wave, NAIVE_LIMIT_HZ);
+    printf("%s aliasing: naive at %.0f Hz %.1f dB, polyblep at %.0f Hz "
+           "%.1f dB\n",
+           names[wave], NAIVE_TEST_HZ, naive, NAIVE_LIMIT_HZ, limit);
+    CHECK(naive <= limit + NAIVE_MARGIN_DB,
+          "%s: naive kernel at %.0f Hz %.1f dB, polyblep at %.0f Hz %.1f dB",
+          names[wave], NAIVE_TEST_HZ, naive, NAIVE_LIMIT_HZ, limit);
+  }
+}
+
+/* sine_approx
+the original firmware's sine: Bhaskara's approximation of sin(degrees),
+0 - 360, kept as it was
+*/
+static float sine_approx(int degrees)
+{
+  int sign = 1;
+  if (degrees > 180) {
+    sign = -1;
+    degrees -= 180;
+  }
+  int numerator = (degrees << 2) * (180 - degrees);
+  float denominator = 40500 - (degrees * (180 - degrees));
+  return numerator / denominator * sign;
+}
+
+// returns the largest error of sine_approx() over its whole degrees, in Q15
+// LSBs
+static double approx_max_error(void)
+{
+  double worst = 0, error;
+  int degrees;
+
+  for (degrees = 0; degrees <= 360; degrees++) {
+    error = 32768.0 * (sine_approx(degrees) - sin(degrees * M_PI / 180));
+    if (fabs(error) > worst) {
+      worst = fabs(error);
+    }
+  }
+  return worst;
+}
+
+// returns the largest error of synth_sine() over all phases, in Q15 LSBs
+static double sine_max_error(int precision)
+{
+  double worst = 0, wanted, error;
+  uint64_t phase;
+
+  for (phase = 0; phase < (1ULL << 32); phase += SINE_STEP) {
+    // Q15 scale, clipped to +-SINE_MAX like the kernel
+    wanted = 32768.0 * sin(2 * M_PI * phase / 4294967296.0);
+    wanted = fmin(fmax(wanted, -SINE_MAX), SINE_MAX);
+    error = synth_sine((uint32_t)phase, precision) - wanted;
+    if (fabs(error) > worst) {
+      worst = fabs(error);
+    }
+  }
+  return worst;
+}
+
+static void test_sine(void)
+{
+  double error12 = sine_max_error(SINE_12BIT);
+  double error16 = sine_max_error(SINE_16BIT);
+  double original = approx_max_error();
+
+  printf("sine max error: 12 bit %.2f LSB (%.1e), 16 bit %.2f LSB (%.1e), "
+         "original %.2f LSB (%.1e)\n",
+         error12, error12 / SINE_MAX, error16, error16 / SINE_MAX, original,
+         original / SINE_MAX);
+  CHECK(error12 < original, "12 bit sine is %.2f LSB off, the original %.2f",
+        error12, original);
+  CHECK(error12 <= SINE_12BIT_MAX_LSB, "12 bit sine is %.2f LSB off",
+        error12);
+  CHECK(error16 <= SINE_16BIT_MAX_LSB, "16 bit sine is %.2f LSB off",
+        error16);
+  CHECK(synth_sine(0x40000000UL, SINE_16BIT) == SINE_MAX,
+        "16 bit sine does not reach full scale");
+  CHECK(synth_cosine(0, SINE_12BIT) == synth_sine(0x40000000UL, SINE_12BIT),
+        "cosine is not the sine a quarter cycle on");
+}
+
+// returns host cycles per sample of one sine source, 0 and 1 the kernels,
+// 2 the table, 3 sine_approx() stepping whole degrees as the original did
+static double bench_sine(int source, const int16_t* table)
+{
+  volatile int32_t sink = 0;
+  uint32_t phase = 0, inc = 0x01234567UL;
+  int degrees = 0;
+  uint64_t start = test_cycles();
+  long i;
+
+  for (i = 0; i < BENCH_CALLS; i++) {
+    if (source == 0) {
+      sink += synth_sine(phase, SINE_12BIT);
+    }
+    else if (source == 1) {
+      sink += synth_sine(phase, SINE_16BIT);
+    }
+    else if (source == 2) {
+      sink += wavetable_lookup(table, BENCH_TABLE_BITS, phase, INTERP_LINEAR);
+    }
+    else {
+      sink += (int32_t)(SINE_MAX * sine_approx(degrees));
+      degrees += 7;
+      if (degrees > 360) {
+        degrees -= 360;
+      }
+    }
+    phase += inc;
+  }
+  return (double)(test_cycles() - start) / BENCH_CALLS;
+}
+
+static void bench(void)
+{
+  static int16_t table[1 << BENCH_TABLE_BITS];
+  double error;
+  int i;
+
+  for (i = 0; i < (1 << BENCH_TABLE_BITS); i++) {
+    table[i] = (int16_t)lrint(SINE_MAX * sin(2 * M_PI * i /
+                                              (1 << BENCH_TABLE_BITS)));
+  }
+  printf("sine, max error in Q15 LSB and host cycles per sample:\n");
+  error = sine_max_error(SINE_12BIT);
+  printf("  polynomial 12 bit  %7.2f  %.2f\n", error, bench_sine(0, table));
+  error = sine_max_error(SINE_16BIT);
+  printf("  polynomial 16 bit  %7.2f  %.2f\n", error, bench_sine(1, table));
+  printf("  table, linear         -     %.2f\n", bench_sine(2, table));
+  error = approx_max_error();
+  printf("  original Bhaskara  %7.2f  %.2f\n", error, bench_sine(3, table));
+}
+
+int main(int argc, char** argv)
+{
+  if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+    bench();
+    return 0;
+  }
+  test_aliasing();
+  test_presets();
+  test_sine();
+  return test_report("synth_test");
+}
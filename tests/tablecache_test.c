@@ -0,0 +1,145 @@
+#include <stdint.h>
+#include <string.h>
+#include "additive.h"
+#include "diag.h"
+#include "tablecache.h"
+#include "test.h"
+
+/* Tablecache_test.c: LRU eviction and the cache counters
+ *
+ * The cache is first driven directly, with a key per number n that differs
+ * only in the count, to check which entry each claim hands out. Then the
+ * additive synthesis runs its builds through it and diag.table_hits and
+ * table_misses must count what was found and what was built. PendSV is run
+ * by hand after each change, which runs the whole DEFER_ADDITIVE build.
+ */
+
+void PendSV_Handler(void);
+
+static table_key make(int n)
+{
+  table_key key;
+
+  memset(&key, 0, sizeof(key));
+  key.count = (uint8_t)n;
+  return key;
+}
+
+// claim an entry, fill it with n and commit it under key n
+static int16_t* add(int n, const int16_t* keep)
+{
+  table_key key = make(n);
+  int16_t* table = table_cache_claim(keep);
+
+  table[0] = (int16_t)n;
+  table_cache_commit(table, &key);
+  return table;
+}
+
+static int found(int n)
+{
+  table_key key = make(n);
+  const int16_t* table = table_cache_find(&key);
+
+  return table && table[0] == n;
+}
+
+static void test_lru(void)
+{
+  int16_t* tables[TABLE_CACHE_ENTRIES + 1];
+  table_key key;
+  int16_t* table;
+  int i;
+
+  table_cache_init();
+  for (i = 1; i <= TABLE_CACHE_ENTRIES; i++) {
+    tables[i] = add(i, 0);
+    CHECK(found(i), "table %d not found after its commit", i);
+  }
+  // free entries are handed out first, every table has its own
+  for (i = 2; i <= TABLE_CACHE_ENTRIES; i++) {
+    CHECK(tables[i] != tables[i - 1], "tables %d and %d share an entry",
+          i - 1, i);
+  }
+
+  // all were used in order, found(1) just now made 2 the oldest
+  found(1);
+  table = add(TABLE_CACHE_ENTRIES + 1, 0);
+  CHECK(table == tables[2], "the entry of 2 was not the one evicted");
+  CHECK(!found(2), "table 2 still found after its eviction");
+  CHECK(found(1), "table 1 was evicted");
+
+  // 3 is now the oldest but it is playing, so 4 goes
+  table = add(TABLE_CACHE_ENTRIES + 2, tables[3]);
+  CHECK(table == tables[4], "the played table or the wrong one was taken");
+  CHECK(found(3) && !found(4), "3 found %d, 4 found %d", found(3), found(4));
+
+  // a claimed entry is not found until it is committed
+  table = table_cache_claim(0);
+  CHECK(table == tables[5], "the entry of 5 was not the one claimed");
+  CHECK(!found(5), "a claimed entry is still found under its old key");
+  key = make(TABLE_CACHE_ENTRIES + 3);
+  CHECK(!table_cache_find(&key), "found before its commit");
+  table_cache_commit(table, &key);
+  CHECK(table_cache_find(&key) == table, "the committed entry not found");
+}
+
+// settle the table build the last change started
+static void build(void)
+{
+  PendSV_Handler();
+  additive_cycle_boundary();
+}
+
+static void test_counters(void)
+{
+  const int16_t* first;
+  int n;
+
+  additive_init();
+  diag_reset();
+  first = additive_table();
+
+  // new settings are built, settings seen before are found
+  additive_set_count(2);
+  build();
+  CHECK(diag.table_misses == 1 && diag.table_hits == 0,
+        "count 2: %u misses %u hits, wanted 1 and 0",
+        (unsigned)diag.table_misses, (unsigned)diag.table_hits);
+  CHECK(additive_table() != first, "the count 2 table was not swapped in");
+  additive_set_count(1);
+  build();
+  CHECK(diag.table_misses == 1 && diag.table_hits == 1,
+        "back to 1: %u misses %u hits, wanted 1 and 1",
+        (unsigned)diag.table_misses, (unsigned)diag.table_hits);
+  CHECK(additive_table() == first, "the cached count 1 table not played");
+
+  // fill the cache, 2 is the oldest then but still there
+  for (n = 3; n < 3 + TABLE_CACHE_ENTRIES - 2; n++) {
+    additive_set_count(n);
+    build();
+  }
+  diag_reset();
+  additive_set_count(2);
+  build();
+  CHECK(diag.table_hits == 1 && diag.table_misses == 0,
+        "count 2 after a full cache: %u misses %u hits, wanted a hit",
+        (unsigned)diag.table_misses, (unsigned)diag.table_hits);
+
+  // one more build evicts the oldest, the table for 1
+  additive_set_count(3 + TABLE_CACHE_ENTRIES - 2);
+  build();
+  diag_reset();
+  additive_set_count(1);
+  build();
+  CHECK(diag.table_misses == 1 && diag.table_hits == 0,
+        "count 1 after its eviction: %u misses %u hits, wanted a miss",
+        (unsigned)diag.table_misses, (unsigned)diag.table_hits);
+}
+
+int main(void)
+{
+  test_lru();
+  test_counters();
+  return test_report("tablecache_test");
+}
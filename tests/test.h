@@ -0,0 +1,54 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#if !defined(__x86_64__) && !defined(__i386__)
+#include <time.h>
+#endif
+
+/* Test.h: minimal checks for the host tests
+ *
+ * CHECK() reports a failed condition with its location and a printf style
+ * message and carries on, so one run shows every failure. test_report()
+ * prints the summary and gives the exit status for main().
+ *
+ * test_cycles() is the host's cycle count for the benchmarks, the time stamp
+ * counter on x86 and nanoseconds elsewhere.
+ */
+
+static int test_failures = 0;
+
+#define CHECK(cond, ...)                           \
+  do {                                             \
+    if (!(cond)) {                                 \
+      printf("%s:%d: failed: ", __FILE__, __LINE__); \
+      printf(__VA_ARGS__);                         \
+      printf("\n");                                \
+      test_failures++;                             \
+    }                                              \
+  } while (0)
+
+static inline uint64_t test_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+#endif
+}
+
+static inline int test_report(const char* name)
+{
+  if (test_failures) {
+    printf("%s: %d check(s) failed\n", name, test_failures);
+    return 1;
+  }
+  printf("%s: ok\n", name);
+  return 0;
+}
+
+#endif
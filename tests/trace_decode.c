@@ -0,0 +1,136 @@
+#include "trace_decode.h"
+#include <string.h>
+#include "render.h"
+#include "sync.h"
+#include "sync_core.h"
+
+/* Trace_decode.c: the firmware's event trace on the host
+ *
+ * A dump is trace_buffer as the debugger saves it, TRACE_SIZE records of
+ * TRACE_RECORD_BYTES, with trace_head next to it. The records are read
+ * byte by byte, so the host's byte order does not matter, and put in the
+ * order they were traced, oldest first from the slot after the newest.
+ *
+ * Times are worked out modulo 2^32 cycles, so the timeline runs on over a
+ * wrap of the cycle counter, every 179 s at 24 MHz. A record stamped before
+ * the one ahead of it is marked "out of order": trace() fills its slot
+ * with interrupts masked, so this does not happen unless the trace is
+ * broken. TRACE_CONFIG frequencies above 65535 Hz, PULSE only, are cut to
+ * the 16 bits of the record's arg.
+ */
+
+static const char* const event_names[] = {
+  "?",         "ISR_OVERRUN", "KEY",       "LCD_UPDATE", "CONFIG",
+  "SPI_STALL", "FAULT",       "UNDERRUN",  "GOVERNOR",   "STACK_LOW",
+  "SYNC",
+};
+#define EVENTS ((int)(sizeof(event_names) / sizeof(event_names[0])))
+
+static const char* const wave_names[] = {"square", "sawtooth", "sine",
+                                         "additive", "pulse"};
+static const char* const sync_names[] = {"off", "leader", "follower"};
+
+int trace_decode(const unsigned char* dump, uint32_t head,
+                 trace_record* records, uint32_t* lost)
+{
+  uint32_t count = head < TRACE_SIZE ? head : TRACE_SIZE;
+  const unsigned char* in;
+  uint32_t i;
+
+  *lost = head - count;
+  for (i = 0; i < count; i++) {
+    in = dump + ((head - count + i) & (TRACE_SIZE - 1)) * TRACE_RECORD_BYTES;
+    records[i].timestamp = in[0] | (uint32_t)in[1] << 8 |
+                           (uint32_t)in[2] << 16 | (uint32_t)in[3] << 24;
+    records[i].event = in[4];
+    records[i].aux = in[5];
+    records[i].arg = in[6] | in[7] << 8;
+  }
+  return count;
+}
+
+// the arguments of record as text
+static void arguments(const trace_record* record, char* text, int size)
+{
+  unsigned aux = record->aux, arg = record->arg;
+
+  text[0] = '\0';
+  switch (record->event) {
+    case TRACE_ISR_OVERRUN:
+      snprintf(text, size, "TA0R %u", arg);
+      break;
+    case TRACE_KEY:
+      snprintf(text, size, "'%c' %s", aux, arg ? "pressed" : "released");
+      break;
+    case TRACE_CONFIG:
+      snprintf(text, size, "%s %u Hz", aux <= PULSE ? wave_names[aux] : "?",
+               arg);
+      break;
+    case TRACE_SPI_STALL:
+      snprintf(text, size, "%u polls", arg);
+      break;
+    case TRACE_FAULT:
+      snprintf(text, size, "exception %u", aux);
+      break;
+    case TRACE_GOVERNOR:
+      snprintf(text, size, "level %u, period %u", aux, arg);
+      break;
+    case TRACE_STACK_LOW:
+      if (aux) {
+        snprintf(text, size, "overflow");
+      }
+      else {
+        snprintf(text, size, "%u bytes free", arg);
+      }
+      break;
+    case TRACE_SYNC:
+      snprintf(text, size, "%s%s%s%s%s%s",
+               aux <= SYNC_FOLLOWER ? sync_names[aux] : "?",
+               arg ? "" : " set", arg & SYNC_FOLLOW_RESET ? " reset" : "",
+               arg & SYNC_FOLLOW_LOCKED ? " locked" : "",
+               arg & SYNC_FOLLOW_UNLOCKED ? " unlocked" : "",
+               arg & SYNC_FOLLOW_LOST ? " lost" : "");
+      break;
+    default:
+      break;
+  }
+}
+
+void trace_line(const trace_record* record, uint32_t first, uint32_t previous,
+                char* line, int size)
+{
+  char text[TRACE_LINE_SIZE];
+  int32_t gap = (int32_t)(record->timestamp - previous);
+  char name[16];
+  int length;
+
+  arguments(record, text, sizeof(text));
+  if (record->event < EVENTS) {
+    snprintf(name, sizeof(name), "%s", event_names[record->event]);
+  }
+  else {
+    snprintf(name, sizeof(name), "event %u", record->event);
+  }
+  snprintf(line, size, "%12.3f us %+11.3f us  %-11s %s%s",
+           (record->timestamp - first) / TRACE_CLOCK_MHZ,
+           gap / TRACE_CLOCK_MHZ, name, text, gap < 0 ? " out of order" : "");
+  // no padding after an event without arguments
+  length = strlen(line);
+  while (length > 0 && line[length - 1] == ' ') {
+    line[--length] = '\0';
+  }
+}
+
+void trace_timeline(FILE* out, const trace_record* records, int count,
+                    uint32_t lost)
+{
+  char line[TRACE_LINE_SIZE];
+  int i;
+
+  fprintf(out, "%d records, %u lost before them\n", count, (unsigned)lost);
+  for (i = 0; i < count; i++) {
+    trace_line(&records[i], records[0].timestamp,
+               records[i > 0 ? i - 1 : 0].timestamp, line, sizeof(line));
+    fprintf(out, "%s\n", line);
+  }
+}
@@ -0,0 +1,28 @@
+#ifndef TRACE_DECODE_H
+#define TRACE_DECODE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include "trace.h"
+
+// bytes of a trace_record on the target, little endian
+#define TRACE_RECORD_BYTES 8
+// bytes of trace_buffer saved from the target
+#define TRACE_DUMP_BYTES (TRACE_SIZE * TRACE_RECORD_BYTES)
+// the timestamps count MCLK cycles, MHZ_24 once set_DCO() ran
+#define TRACE_CLOCK_MHZ 24.0
+#define TRACE_LINE_SIZE 96
+
+// puts the records of a trace_buffer dump in records oldest first, head is
+// trace_head saved with it. Returns how many, lost gets the number of
+// records overwritten before the dump.
+int trace_decode(const unsigned char* dump, uint32_t head,
+                 trace_record* records, uint32_t* lost);
+// one line of the timeline: microseconds since first and since previous,
+// the event and its arguments
+void trace_line(const trace_record* record, uint32_t first, uint32_t previous,
+                char* line, int size);
+void trace_timeline(FILE* out, const trace_record* records, int count,
+                    uint32_t lost);
+
+#endif
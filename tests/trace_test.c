@@ -0,0 +1,191 @@
+#include <string.h>
+#include "hw.h"
+#include "trace.h"
+#include "trace_decode.h"
+#include "test.h"
+
+/* Trace_test.c: trace records in time order, and their timeline
+ *
+ * Known record streams are laid out as the target keeps them, little
+ * endian in trace_buffer's slots, and decoded: the records must come out
+ * oldest first with the overwritten ones counted, and the timeline lines
+ * must read as given, over a wrap of the cycle counter too.
+ *
+ * trace() itself runs against the host's DWT and PRIMASK. hw_unmask_hook
+ * takes an interrupt the moment trace() unmasks, which traces as the
+ * sample ISR does and takes ISR_CYCLES: the interrupted record must still
+ * be whole and stamped before the interrupt's.
+ */
+
+#define CYCLES_PER_US 24
+#define ISR_CYCLES 500
+
+static unsigned char dump[TRACE_DUMP_BYTES];
+static trace_record records[TRACE_SIZE];
+
+// lay record out in slot as the target keeps it
+static void put_record(int slot, uint32_t timestamp, int event, int aux,
+                       int arg)
+{
+  unsigned char* out = dump + slot * TRACE_RECORD_BYTES;
+
+  out[0] = timestamp & 0xFF;
+  out[1] = timestamp >> 8 & 0xFF;
+  out[2] = timestamp >> 16 & 0xFF;
+  out[3] = timestamp >> 24;
+  out[4] = event;
+  out[5] = aux;
+  out[6] = arg & 0xFF;
+  out[7] = arg >> 8;
+}
+
+// trace_buffer as the debugger would save it
+static void save_buffer(void)
+{
+  int i;
+
+  for (i = 0; i < TRACE_SIZE; i++) {
+    put_record(i, trace_buffer[i].timestamp, trace_buffer[i].event,
+               trace_buffer[i].aux, trace_buffer[i].arg);
+  }
+}
+
+static void check_line(int index, const char* wanted)
+{
+  char line[TRACE_LINE_SIZE];
+
+  trace_line(&records[index], records[0].timestamp,
+             records[index > 0 ? index - 1 : 0].timestamp, line,
+             sizeof(line));
+  CHECK(strcmp(line, wanted) == 0, "record %d:\n  \"%s\", wanted\n  \"%s\"",
+        index, line, wanted);
+}
+
+// one of each event, every arguments case, before the buffer filled up
+static void test_timeline(void)
+{
+  uint32_t lost;
+  int count;
+
+  memset(dump, 0, sizeof(dump));
+  put_record(0, 2400, TRACE_KEY, '5', 1);
+  put_record(1, 2400 + 12, TRACE_CONFIG, 2, 1000);
+  put_record(2, 4800, TRACE_LCD_UPDATE, 0, 0);
+  put_record(3, 24000, TRACE_UNDERRUN, 0, 0);
+  put_record(4, 24000 + 888, TRACE_ISR_OVERRUN, 0, 37);
+  put_record(5, 48000, TRACE_SPI_STALL, 0, 40);
+  put_record(6, 48240, TRACE_GOVERNOR, 1, 1184);
+  put_record(7, 72000, TRACE_STACK_LOW, 0, 96);
+  put_record(8, 72024, TRACE_STACK_LOW, 1, 0);
+  put_record(9, 96000, TRACE_SYNC, 2, 0);
+  put_record(10, 96048, TRACE_SYNC, 2, 3);
+  put_record(11, 120000, TRACE_SYNC, 0, 8);
+  put_record(12, 120024, TRACE_KEY, '5', 0);
+  put_record(13, 120000, 99, 0, 0);  // stamped before the one ahead
+  put_record(14, 144000, TRACE_FAULT, 3, 0);
+
+  count = trace_decode(dump, 15, records, &lost);
+  CHECK(count == 15 && lost == 0, "%d records, %u lost", count,
+        (unsigned)lost);
+  check_line(0, "       0.000 us      +0.000 us  KEY         '5' pressed");
+  check_line(1, "       0.500 us      +0.500 us  CONFIG      sine 1000 Hz");
+  check_line(2, "     100.000 us     +99.500 us  LCD_UPDATE");
+  check_line(3, "     900.000 us    +800.000 us  UNDERRUN");
+  check_line(4, "     937.000 us     +37.000 us  ISR_OVERRUN TA0R 37");
+  check_line(5, "    1900.000 us    +963.000 us  SPI_STALL   40 polls");
+  check_line(6, "    1910.000 us     +10.000 us  GOVERNOR    level 1, "
+                "period 1184");
+  check_line(7, "    2900.000 us    +990.000 us  STACK_LOW   96 bytes free");
+  check_line(8, "    2901.000 us      +1.000 us  STACK_LOW   overflow");
+  check_line(9, "    3900.000 us    +999.000 us  SYNC        follower set");
+  check_line(10, "    3902.000 us      +2.000 us  SYNC        follower reset "
+                 "locked");
+  check_line(11, "    4900.000 us    +998.000 us  SYNC        off lost");
+  check_line(12, "    4901.000 us      +1.000 us  KEY         '5' released");
+  check_line(13, "    4900.000 us      -1.000 us  event 99     out of order");
+  check_line(14, "    5900.000 us   +1000.000 us  FAULT       exception 3");
+}
+
+// a full buffer that went round 3 records past its end, while the cycle
+// counter wrapped
+static void test_wrap(void)
+{
+  uint32_t start = 0xFFFFFFFFu - 20 * CYCLES_PER_US, lost;
+  uint32_t index;
+  int count, i, in_order = 1;
+
+  for (index = 3; index < TRACE_SIZE + 3; index++) {
+    put_record(index & (TRACE_SIZE - 1), start + index * CYCLES_PER_US,
+               TRACE_UNDERRUN, 0, index);
+  }
+  count = trace_decode(dump, TRACE_SIZE + 3, records, &lost);
+  CHECK(count == TRACE_SIZE && lost == 3, "%d records, %u lost", count,
+        (unsigned)lost);
+  for (i = 0; i < count; i++) {
+    in_order &= records[i].arg == i + 3;
+  }
+  CHECK(in_order, "records out of order, the oldest is %u",
+        (unsigned)records[0].arg);
+  check_line(1, "       1.000 us      +1.000 us  UNDERRUN");
+  check_line(TRACE_SIZE - 1, "     127.000 us      +1.000 us  UNDERRUN");
+}
+
+// the sample ISR, taken when trace() unmasks
+static void interrupt(void)
+{
+  hw_unmask_hook = 0;
+  DWT->CYCCNT += ISR_CYCLES / 2;
+  trace(TRACE_UNDERRUN, 0, 0);
+  DWT->CYCCNT += ISR_CYCLES / 2;
+}
+
+// an interrupt that traces as soon as the main loop's trace() unmasks
+static void test_interrupted(void)
+{
+  trace_record record;
+  uint32_t lost;
+  int count, i, reads = 0, in_order = 1, same = 1;
+
+  trace_init();
+  for (i = 0; i < 2 * TRACE_SIZE; i++) {
+    DWT->CYCCNT += 1000;
+    if (i % 3 == 0) {
+      hw_unmask_hook = interrupt;
+    }
+    trace(TRACE_KEY, '1', 1);
+  }
+  save_buffer();
+  count = trace_decode(dump, trace_head, records, &lost);
+  CHECK(count == TRACE_SIZE, "%d records", count);
+  for (i = 1; i < count; i++) {
+    in_order &= (int32_t)(records[i].timestamp - records[i - 1].timestamp) >
+                0;
+  }
+  CHECK(in_order, "records out of timestamp order");
+  i = 0;
+  while (i < count && records[i].event != TRACE_UNDERRUN) {
+    i++;
+  }
+  CHECK(i > 0 && i < count && records[i - 1].event == TRACE_KEY &&
+            records[i].timestamp - records[i - 1].timestamp ==
+                ISR_CYCLES / 2,
+        "the interrupt's record is not %d cycles after the key's",
+        ISR_CYCLES / 2);
+
+  // trace_read() gives the same, the oldest were overwritten
+  while (trace_read(&record)) {
+    same &= reads < count &&
+            memcmp(&record, &records[reads], sizeof(record)) == 0;
+    reads++;
+  }
+  CHECK(same && reads == count, "%d records read, %d decoded", reads,
+        count);
+}
+
+int main(void)
+{
+  test_timeline();
+  test_wrap();
+  test_interrupted();
+  return test_report("trace_test");
+}
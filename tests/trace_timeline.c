@@ -0,0 +1,37 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "trace_decode.h"
+
+/* Trace_timeline.c: prints the firmware's event trace as a timeline
+ *
+ * usage: trace_timeline <dump> <trace_head>
+ *
+ * Save trace_buffer from the debugger's memory browser as raw binary,
+ * TRACE_DUMP_BYTES from &trace_buffer, and give trace_head as the
+ * expressions view shows it, decimal or 0x hex.
+ */
+
+int main(int argc, char** argv)
+{
+  static unsigned char dump[TRACE_DUMP_BYTES];
+  static trace_record records[TRACE_SIZE];
+  uint32_t head, lost;
+  FILE* file;
+  int count;
+
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <trace_buffer dump> <trace_head>\n", argv[0]);
+    return 2;
+  }
+  file = fopen(argv[1], "rb");
+  if (!file || fread(dump, 1, sizeof(dump), file) != sizeof(dump)) {
+    fprintf(stderr, "%s: can not read %d bytes of trace_buffer\n", argv[1],
+            TRACE_DUMP_BYTES);
+    return 1;
+  }
+  fclose(file);
+  head = strtoul(argv[2], 0, 0);
+  count = trace_decode(dump, head, records, &lost);
+  trace_timeline(stdout, records, count, lost);
+  return 0;
+}
@@ -0,0 +1,177 @@
+#include "vcd.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Vcd.c: value change dumps of pins for the host tests
+ *
+ * The files open in any waveform viewer, e.g. GTKWave. Signals are wires
+ * of one module, named by the test, with the one character identifiers
+ * 'A' onwards. A change is only written when the value differs, and time
+ * never goes back: a change stamped earlier than the last is written at
+ * the last time. vcd_read() takes back what vcd_close() left, and dumps
+ * of other tools with one character identifiers and no x or z in vectors.
+ */
+
+#define TOKEN_SIZE 64
+#define FIRST_ID 'A'
+
+static void write_value(vcd_file* vcd, int signal)
+{
+  uint32_t value = vcd->values[signal];
+  int bit;
+
+  if (vcd->widths[signal] == 1) {
+    fprintf(vcd->file, "%u%c\n", (unsigned)(value & 1), FIRST_ID + signal);
+    return;
+  }
+  fputc('b', vcd->file);
+  for (bit = vcd->widths[signal] - 1; bit >= 0; bit--) {
+    fputc('0' + (value >> bit & 1), vcd->file);
+  }
+  fprintf(vcd->file, " %c\n", FIRST_ID + signal);
+}
+
+// the definitions end with the initial values at time 0
+static void start(vcd_file* vcd)
+{
+  int i;
+
+  fprintf(vcd->file, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+  for (i = 0; i < vcd->signals; i++) {
+    write_value(vcd, i);
+  }
+  fprintf(vcd->file, "$end\n");
+  vcd->started = 1;
+}
+
+int vcd_open(vcd_file* vcd, const char* path, const char* timescale)
+{
+  memset(vcd, 0, sizeof(*vcd));
+  vcd->file = fopen(path, "w");
+  if (!vcd->file) {
+    return 0;
+  }
+  fprintf(vcd->file, "$timescale %s $end\n$scope module host $end\n",
+          timescale);
+  return 1;
+}
+
+int vcd_signal(vcd_file* vcd, const char* name, int width, uint32_t initial)
+{
+  int signal = vcd->signals++;
+
+  vcd->widths[signal] = width;
+  vcd->values[signal] = width < 32 ? initial & ((1u << width) - 1) : initial;
+  fprintf(vcd->file, "$var wire %d %c %s $end\n", width, FIRST_ID + signal,
+          name);
+  return signal;
+}
+
+void vcd_change(vcd_file* vcd, uint64_t time, int signal, uint32_t value)
+{
+  if (vcd->widths[signal] < 32) {
+    value &= (1u << vcd->widths[signal]) - 1;
+  }
+  if (!vcd->started) {
+    start(vcd);
+  }
+  if (value == vcd->values[signal]) {
+    return;
+  }
+  if (time > vcd->time) {
+    vcd->time = time;
+    fprintf(vcd->file, "#%llu\n", (unsigned long long)time);
+  }
+  vcd->values[signal] = value;
+  write_value(vcd, signal);
+}
+
+int vcd_close(vcd_file* vcd)
+{
+  if (!vcd->started) {
+    start(vcd);
+  }
+  return fclose(vcd->file) == 0;
+}
+
+// skips a $ section up to its $end
+static int skip_section(FILE* file)
+{
+  char token[TOKEN_SIZE];
+
+  while (fscanf(file, "%63s", token) == 1) {
+    if (strcmp(token, "$end") == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int vcd_read(const char* path, const char* const* names, int count,
+             vcd_reader reader, void* context)
+{
+  char token[TOKEN_SIZE], id[TOKEN_SIZE], name[TOKEN_SIZE];
+  int signal_of[128];  // by identifier character, -1 if not asked for
+  int found = 0, width, i;
+  uint64_t time = 0;
+  uint32_t value;
+  FILE* file = fopen(path, "r");
+
+  if (!file) {
+    return 0;
+  }
+  for (i = 0; i < 128; i++) {
+    signal_of[i] = -1;
+  }
+
+  // the definitions
+  while (fscanf(file, "%63s", token) == 1 &&
+         strcmp(token, "$enddefinitions") != 0) {
+    if (strcmp(token, "$var") == 0) {
+      if (fscanf(file, "%*s %d %63s %63s", &width, id, name) != 3 ||
+          strlen(id) != 1) {
+        break;
+      }
+      for (i = 0; i < count; i++) {
+        if (strcmp(name, names[i]) == 0 && signal_of[(int)id[0]] < 0) {
+          signal_of[(int)id[0]] = i;
+          found++;
+        }
+      }
+    }
+    if (token[0] == '$' && strcmp(token, "$end") != 0 &&
+        !skip_section(file)) {
+      break;
+    }
+  }
+  if (found != count || !skip_section(file)) {
+    fclose(file);
+    return 0;
+  }
+
+  // the changes
+  while (fscanf(file, "%63s", token) == 1) {
+    if (token[0] == '#') {
+      time = strtoull(token + 1, 0, 10);
+      continue;
+    }
+    if (token[0] == '$') {
+      continue;  // $dumpvars and its $end
+    }
+    if (token[0] == 'b' || token[0] == 'B') {
+      value = strtoul(token + 1, 0, 2);
+      if (fscanf(file, "%63s", id) != 1) {
+        break;
+      }
+    }
+    else {
+      value = token[0] == '1';
+      strcpy(id, token + 1);
+    }
+    if (strlen(id) == 1 && id[0] > 0 && signal_of[(int)id[0]] >= 0) {
+      reader(context, time, signal_of[(int)id[0]], value);
+    }
+  }
+  fclose(file);
+  return 1;
+}
@@ -0,0 +1,33 @@
+#ifndef VCD_H
+#define VCD_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define VCD_SIGNALS 16
+
+typedef struct vcd_file {
+  FILE* file;
+  int signals;
+  int widths[VCD_SIGNALS];
+  uint32_t values[VCD_SIGNALS];
+  uint64_t time;  // of the last change written
+  int started;    // header and initial values written
+} vcd_file;
+
+// called with each value of a signal read back, the initial ones at time 0
+typedef void (*vcd_reader)(void* context, uint64_t time, int signal,
+                           uint32_t value);
+
+// start a value change dump, timescale as in the file, e.g. "1ps"
+int vcd_open(vcd_file* vcd, const char* path, const char* timescale);
+// returns the number of a new signal, all are declared before any change
+int vcd_signal(vcd_file* vcd, const char* name, int width, uint32_t initial);
+void vcd_change(vcd_file* vcd, uint64_t time, int signal, uint32_t value);
+int vcd_close(vcd_file* vcd);
+// read the values of the signals named back from a dump, numbered as in
+// names, returns 0 if the file can not be read or a name is missing
+int vcd_read(const char* path, const char* const* names, int count,
+             vcd_reader reader, void* context);
+
+#endif
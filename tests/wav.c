@@ -0,0 +1,110 @@
+#include "wav.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Wav.c: 16 bit mono PCM WAV files for the host tests
+ *
+ * The canonical 44 byte header, a "fmt " chunk and the "data" chunk, all
+ * little endian whatever the host is. Reading accepts only what
+ * wav_write() writes.
+ */
+
+#define HEADER_SIZE 44
+#define FORMAT_PCM 1
+
+static void put16(unsigned char* out, uint32_t value)
+{
+  out[0] = value & 0xFF;
+  out[1] = value >> 8 & 0xFF;
+}
+
+static void put32(unsigned char* out, uint32_t value)
+{
+  put16(out, value & 0xFFFF);
+  put16(out + 2, value >> 16);
+}
+
+static uint32_t get16(const unsigned char* in)
+{
+  return in[0] | (uint32_t)in[1] << 8;
+}
+
+static uint32_t get32(const unsigned char* in)
+{
+  return get16(in) | get16(in + 2) << 16;
+}
+
+int wav_write(const char* path, const int16_t* samples, int count,
+              uint32_t sample_rate)
+{
+  unsigned char header[HEADER_SIZE], sample[2];
+  FILE* file = fopen(path, "wb");
+  int i, ok;
+
+  if (!file) {
+    return 0;
+  }
+  memcpy(header, "RIFF", 4);
+  put32(header + 4, HEADER_SIZE - 8 + 2 * count);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  put32(header + 16, 16);  // fmt chunk size
+  put16(header + 20, FORMAT_PCM);
+  put16(header + 22, 1);  // channels
+  put32(header + 24, sample_rate);
+  put32(header + 28, 2 * sample_rate);  // bytes per second
+  put16(header + 32, 2);                // bytes per frame
+  put16(header + 34, 16);               // bits per sample
+  memcpy(header + 36, "data", 4);
+  put32(header + 40, 2 * count);
+
+  ok = fwrite(header, HEADER_SIZE, 1, file) == 1;
+  for (i = 0; ok && i < count; i++) {
+    put16(sample, (uint16_t)samples[i]);
+    ok = fwrite(sample, 2, 1, file) == 1;
+  }
+  return fclose(file) == 0 && ok;
+}
+
+int wav_read(const char* path, int16_t* samples, int max,
+             uint32_t* sample_rate)
+{
+  unsigned char header[HEADER_SIZE], sample[2];
+  FILE* file = fopen(path, "rb");
+  uint32_t bytes;
+  long size;
+  int count, i;
+
+  if (!file) {
+    return -1;
+  }
+  if (fread(header, HEADER_SIZE, 1, file) != 1 ||
+      fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0) {
+    fclose(file);
+    return -1;
+  }
+  bytes = get32(header + 40);
+  if (memcmp(header, "RIFF", 4) != 0 ||
+      memcmp(header + 8, "WAVEfmt ", 8) != 0 ||
+      memcmp(header + 36, "data", 4) != 0 || get32(header + 16) != 16 ||
+      get16(header + 20) != FORMAT_PCM || get16(header + 22) != 1 ||
+      get16(header + 32) != 2 || get16(header + 34) != 16 ||
+      get32(header + 28) != 2 * get32(header + 24) ||
+      get32(header + 4) != HEADER_SIZE - 8 + bytes ||
+      (uint32_t)size != HEADER_SIZE + bytes) {
+    fclose(file);
+    return -1;
+  }
+
+  *sample_rate = get32(header + 24);
+  count = bytes / 2;
+  fseek(file, HEADER_SIZE, SEEK_SET);
+  for (i = 0; i < count && i < max; i++) {
+    if (fread(sample, 2, 1, file) != 1) {
+      fclose(file);
+      return -1;
+    }
+    samples[i] = (int16_t)get16(sample);
+  }
+  fclose(file);
+  return count;
+}
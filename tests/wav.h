@@ -0,0 +1,14 @@
+#ifndef WAV_H
+#define WAV_H
+
+#include <stdint.h>
+
+// write count 16 bit mono samples as a PCM WAV file, returns 0 on failure
+int wav_write(const char* path, const int16_t* samples, int count,
+              uint32_t sample_rate);
+// read up to max samples of a 16 bit mono PCM WAV file, returns how many
+// the file holds or -1 if it is not one
+int wav_read(const char* path, int16_t* samples, int max,
+             uint32_t* sample_rate);
+
+#endif
@@ -0,0 +1,114 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "spectrum.h"
+#include "test.h"
+#include "wavetable.h"
+
+/* Wavetable_test.c: spurious free dynamic range of the table lookup
+ *
+ * A full scale Q15 sine table of each size is played through
+ * wavetable_lookup() in every interpolation mode. The tone sits on bin
+ * SFDR_BIN of an SFDR_POINTS point FFT. The bin is odd, so the phase steps
+ * across the table entries at every fraction and the interpolation errors
+ * are not hidden. The block holds whole cycles, so no window is needed.
+ * SFDR is the fundamental against the strongest other bin.
+ *
+ * Each limit is a few dB under the figure this code measured. Nearest gains
+ * 6 dB per doubling of the table and linear 12 dB. Cubic and large linear
+ * tables end up at the floor of the Q15 values.
+ *
+ * Next to each SFDR the host cycles per wavetable_lookup() are printed, the
+ * price of each mode. They are not checked, the host is not the target.
+ */
+
+#define SFDR_POINTS 16384
+#define SFDR_BIN 187
+#define SFDR_SIZES 3
+#define TIMING_CALLS 1000000
+
+static const int table_bits[SFDR_SIZES] = {6, 8, 10};
+// least SFDR in dB for [size][mode], nearest / linear / cubic
+static const double sfdr_min_db[SFDR_SIZES][3] = {
+  {33, 69, 99},    // 64 points
+  {45, 93, 104},   // 256 points
+  {57, 105, 105},  // 1024 points
+};
+static const char* mode_names[3] = {"nearest", "linear", "cubic"};
+
+static int16_t table[1 << 10];
+
+// fill table with one cycle of a full scale sine of 2^bits points
+static void make_table(int bits)
+{
+  int size = 1 << bits;
+  int i;
+
+  for (i = 0; i < size; i++) {
+    table[i] = (int16_t)lrint(32767 * sin(2 * M_PI * i / size));
+  }
+}
+
+// returns the SFDR of the table played with mode, in dB
+static double measure_sfdr(int bits, interp_mode mode)
+{
+  static double samples[SFDR_POINTS];
+  static double power[SFDR_POINTS / 2 + 1];
+  uint32_t inc = (uint32_t)(((uint64_t)SFDR_BIN << 32) / SFDR_POINTS);
+  uint32_t phase = 0;
+  double spur = 0;
+  int i;
+
+  for (i = 0; i < SFDR_POINTS; i++) {
+    samples[i] = wavetable_lookup(table, bits, phase, mode);
+    phase += inc;
+  }
+  spectrum(samples, power, SFDR_POINTS);
+  for (i = 1; i <= SFDR_POINTS / 2; i++) {
+    if (i != SFDR_BIN && power[i] > spur) {
+      spur = power[i];
+    }
+  }
+  return -spectrum_db(spur, power[SFDR_BIN]);
+}
+
+// returns host cycles per lookup of the table played with mode
+static double time_lookup(int bits, interp_mode mode)
+{
+  volatile int32_t sink = 0;
+  uint32_t phase = 0, inc = 0x01234567UL;
+  uint64_t start = test_cycles();
+  long i;
+
+  for (i = 0; i < TIMING_CALLS; i++) {
+    sink += wavetable_lookup(table, bits, phase, mode);
+    phase += inc;
+  }
+  return (double)(test_cycles() - start) / TIMING_CALLS;
+}
+
+static void test_sfdr(void)
+{
+  double sfdr;
+  int size, mode;
+
+  for (size = 0; size < SFDR_SIZES; size++) {
+    make_table(table_bits[size]);
+    for (mode = INTERP_NEAREST; mode <= INTERP_CUBIC; mode++) {
+      sfdr = measure_sfdr(table_bits[size], (interp_mode)mode);
+      printf("%4d points, %-7s SFDR %5.1f dB, %4.1f cycles per lookup\n",
+             1 << table_bits[size], mode_names[mode], sfdr,
+             time_lookup(table_bits[size], (interp_mode)mode));
+      CHECK(sfdr >= sfdr_min_db[size][mode],
+            "%d point table, %s: %.1f dB SFDR, wanted %.0f dB",
+            1 << table_bits[size], mode_names[mode], sfdr,
+            sfdr_min_db[size][mode]);
+    }
+  }
+}
+
+int main(void)
+{
+  test_sfdr();
+  return test_report("wavetable_test");
+}
@@ -0,0 +1,96 @@
+#include "trace.h"
+#include "msp.h"
+
+/* Trace.c: RAM event trace
+ *
+ * Keeps the last TRACE_SIZE timestamped events in a ring buffer so there is a
+ * record of what happened before an output glitch or a fault. Records are
+ * written by the sample ISR and the main loop and read either with
+ * trace_read() or directly by the debugger through trace_buffer and
+ * trace_head. The buffer overwrites the oldest records when full.
+ *
+ * trace_head counts every record ever written, so the newest record is at
+ * trace_buffer[(trace_head - 1) % TRACE_SIZE] and the number of lost records
+ * can be worked out from how far the head has moved. tests/trace_timeline
+ * prints a copy of the two saved from the debugger as a timeline.
+ */
+
+trace_record trace_buffer[TRACE_SIZE];
+volatile uint32_t trace_head = 0;
+
+static uint32_t trace_tail = 0;   // next record for trace_read()
+static volatile int frozen = 0;  // set after a fault to keep the history
+
+/* trace_init:
+enable the DWT cycle counter used for timestamps and empty the buffer
+*/
+void trace_init(void)
+{
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  trace_head = 0;
+  trace_tail = 0;
+  frozen = 0;
+}
+
+/* trace
+add one record, from any context. The slot is claimed and filled with
+interrupts masked, a handful of cycles: a record is whole before an
+interrupt can trace, and the timestamps go up with the slots.
+*/
+void trace(trace_event event, uint8_t aux, uint16_t arg)
+{
+  uint32_t primask;
+  trace_record* record;
+
+  if (frozen) {
+    return;
+  }
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  record = &trace_buffer[trace_head & (TRACE_SIZE - 1)];
+  record->timestamp = DWT->CYCCNT;
+  record->event = event;
+  record->aux = aux;
+  record->arg = arg;
+  trace_head++;
+  __set_PRIMASK(primask);
+}
+
+/* trace_read
+copy the oldest unread record into record. Returns 1 if a record was read or
+0 if the buffer is empty. Records that were overwritten before being read are
+skipped. Only one context may read, the copy is made with interrupts masked
+so a record traced meanwhile can not overwrite it half way.
+*/
+int trace_read(trace_record* record)
+{
+  uint32_t primask, head;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  head = trace_head;
+  if (trace_tail == head) {
+    __set_PRIMASK(primask);
+    return 0;
+  }
+  if (head - trace_tail > TRACE_SIZE) {
+    trace_tail = head - TRACE_SIZE;
+  }
+  *record = trace_buffer[trace_tail & (TRACE_SIZE - 1)];
+  trace_tail++;
+  __set_PRIMASK(primask);
+  return 1;
+}
+
+/* trace_fault
+record the active exception and stop tracing so the history leading up to
+the fault stays in RAM for the debugger. Called from Default_Handler.
+*/
+void trace_fault(void)
+{
+  trace(TRACE_FAULT, __get_IPSR() & 0xFF, 0);
+  frozen = 1;
+}
@@ -0,0 +1,38 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// number of records kept, must be a power of 2
+#define TRACE_SIZE 128
+
+typedef enum trace_event {
+  TRACE_ISR_OVERRUN = 1,  // arg: timer count when the overrun was seen
+  TRACE_KEY,              // aux: key char, arg: 1 pressed, 0 released
+  TRACE_LCD_UPDATE,       // no arguments
+  TRACE_CONFIG,           // aux: wave type, arg: frequency
+  TRACE_SPI_STALL,        // arg: TXIFG/RXIFG polls spent waiting
+  TRACE_FAULT,            // aux: active exception number
+  TRACE_UNDERRUN,         // sample queue was empty at a sample tick
+  TRACE_GOVERNOR,         // aux: governor level, arg: new sample period
+  TRACE_STACK_LOW,        // aux: 0 low, arg: bytes free; aux: 1 overflow
+  TRACE_SYNC,             // aux: sync mode, arg: 0 set, else SYNC_FOLLOW_
+                          // flags, LOCKED, UNLOCKED or LOST
+} trace_event;
+
+typedef struct trace_record {
+  uint32_t timestamp;  // DWT cycle count (MCLK cycles)
+  uint8_t event;
+  uint8_t aux;
+  uint16_t arg;
+} trace_record;
+
+extern trace_record trace_buffer[TRACE_SIZE];
+extern volatile uint32_t trace_head;
+
+void trace_init(void);
+void trace(trace_event event, uint8_t aux, uint16_t arg);
+int trace_read(trace_record* record);
+void trace_fault(void);
+
+#endif
@@ -0,0 +1,64 @@
+#include "uart.h"
+#include "irq.h"
+#include "msp.h"
+
+/* Uart.c: host link serial port
+ *
+ * Received bytes are handed to a receiver function straight from the
+ * interrupt, which runs at IRQ_PRIO_COMM so a busy link can not delay the
+ * sample clock. Sending polls the transmit flag and is only done from the
+ * main loop.
+ */
+
+static uart_receiver receive = 0;
+
+/* uart_init
+set up EUSCI_A0 as an 8N1 UART at 115200 baud. Must be called again if
+SMCLK changes, the divider is computed for 24 MHz.
+*/
+void uart_init(uart_receiver receiver)
+{
+  receive = receiver;
+
+  UART_PORT->SEL0 |= UART_RX | UART_TX;
+  UART_PORT->SEL1 &= ~(UART_RX | UART_TX);
+
+  EUSCI_A0->CTLW0 = EUSCI_A_CTLW0_SWRST;  // hold in reset while configuring
+  EUSCI_A0->CTLW0 |= EUSCI_A_CTLW0_SSEL__SMCLK;
+  EUSCI_A0->BRW = UART_BRW;
+  EUSCI_A0->MCTLW = (UART_BRS << EUSCI_A_MCTLW_BRS_OFS) |
+                    (UART_BRF << EUSCI_A_MCTLW_BRF_OFS) | EUSCI_A_MCTLW_OS16;
+  EUSCI_A0->CTLW0 &= ~EUSCI_A_CTLW0_SWRST;
+
+  EUSCI_A0->IE |= EUSCI_A_IE_RXIE;
+  irq_enable(EUSCIA0_IRQn, IRQ_PRIO_COMM);
+}
+
+// send one byte, waits for the transmit buffer
+void uart_putc(uint8_t byte)
+{
+  while (!(EUSCI_A0->IFG & EUSCI_A_IFG_TXIFG))
+    ;
+  EUSCI_A0->TXBUF = byte;
+}
+
+void uart_write(const uint8_t* data, int length)
+{
+  int i;
+
+  for (i = 0; i < length; i++) {
+    uart_putc(data[i]);
+  }
+}
+
+void EUSCIA0_IRQHandler(void)
+{
+  uint8_t byte;
+
+  if (EUSCI_A0->IFG & EUSCI_A_IFG_RXIFG) {
+    byte = EUSCI_A0->RXBUF;  // reading clears the flag
+    if (receive) {
+      receive(byte);
+    }
+  }
+}
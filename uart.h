@@ -0,0 +1,23 @@
+#ifndef UART_H
+#define UART_H
+
+#include <stdint.h>
+
+// host link on the LaunchPad back channel: EUSCI_A0, P1.2 RX and P1.3 TX
+#define UART_PORT P1
+#define UART_RX BIT2
+#define UART_TX BIT3
+
+// 115200 baud from SMCLK at 24 MHz, 16x oversampling
+#define UART_BRW 13
+#define UART_BRF 0
+#define UART_BRS 0x25
+
+// called from the receive interrupt for every byte
+typedef void (*uart_receiver)(uint8_t byte);
+
+void uart_init(uart_receiver receiver);
+void uart_putc(uint8_t byte);
+void uart_write(const uint8_t* data, int length);
+
+#endif
@@ -0,0 +1,54 @@
+#include "wavetable.h"
+
+/* Wavetable.c: single cycle table lookup
+ *
+ * The top bits of the 32 bit phase accumulator pick the table entry and the
+ * next 15 bits are the fraction between two entries. Nearest neighbour
+ * lookup drops the fraction, so its distortion depends on the table size.
+ * Linear and cubic interpolation use the fraction, so a small table gets
+ * close to the accuracy of a much larger one. Tables are Q15 and must hold
+ * one full cycle of 2^bits points; indexes wrap around the end.
+ */
+
+/* wavetable_lookup
+returns the Q15 table value at phase using the given interpolation
+*/
+int32_t wavetable_lookup(const int16_t* table, int bits, uint32_t phase,
+                         interp_mode mode)
+{
+  uint32_t mask = (1UL << bits) - 1;
+  uint32_t index = phase >> (32 - bits);
+  int32_t frac = (phase >> (17 - bits)) & 0x7FFF;  // Q15
+  int32_t ym1, y0, y1, y2, c1, c2, c3;
+  int64_t result;
+
+  switch (mode) {
+    case INTERP_LINEAR:
+      y0 = table[index];
+      y1 = table[(index + 1) & mask];
+      return y0 + (((y1 - y0) * frac) >> 15);
+    case INTERP_CUBIC:
+      ym1 = table[(index - 1) & mask];
+      y0 = table[index];
+      y1 = table[(index + 1) & mask];
+      y2 = table[(index + 2) & mask];
+      // Catmull-Rom coefficients, doubled to stay in integers
+      c1 = y1 - ym1;
+      c2 = 2 * ym1 - 5 * y0 + 4 * y1 - y2;
+      c3 = (y2 - ym1) + 3 * (y0 - y1);
+      result = ((int64_t)c3 * frac) >> 15;
+      result = ((result + c2) * frac) >> 15;
+      result = ((result + c1) * frac) >> 15;
+      result = y0 + (result >> 1);
+      if (result > 32767) {
+        return 32767;
+      }
+      if (result < -32768) {
+        return -32768;
+      }
+      return (int32_t)result;
+    case INTERP_NEAREST:
+    default:
+      return table[index];
+  }
+}
@@ -0,0 +1,15 @@
+#ifndef WAVETABLE_H
+#define WAVETABLE_H
+
+#include <stdint.h>
+
+typedef enum interp_mode {
+  INTERP_NEAREST,  // one table read
+  INTERP_LINEAR,   // two reads, one multiply
+  INTERP_CUBIC,    // four reads, 4 point Hermite (Catmull-Rom)
+} interp_mode;
+
+int32_t wavetable_lookup(const int16_t* table, int bits, uint32_t phase,
+                         interp_mode mode);
+
+#endif